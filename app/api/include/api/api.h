@@ -1,9 +1,184 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace oscpkt {
+class Message;
+struct UdpSocket;
+} // oscpkt
+
 namespace SonicPi {
 namespace API {
 
-bool Start();
+// A headless client for the Sonic Pi server. It knows how to find free
+// ports, launch the Ruby server, wait for it to boot and talk the same
+// OSC protocol as the Qt GUI - but needs neither Qt nor a GUI thread, so
+// it can drive Sonic Pi from test harnesses and lightweight frontends.
+
+struct LogMessage
+{
+    int type;
+    std::string text;
+};
+
+// /log/multi_message - the output of a single run, e.g. a synth trigger
+// along with its args
+struct MultiLog
+{
+    int jobId;
+    std::string threadName;
+    std::string runtime;
+    std::vector<LogMessage> messages;
+};
+
+// /log/info
+struct InfoMessage
+{
+    int style;
+    std::string text;
+};
+
+// /incoming/osc - a cue, either from a running job or an external source
+struct CueInfo
+{
+    std::string time;
+    int id;
+    std::string address;
+    std::string arguments;
+};
+
+// /error
+struct RuntimeError
+{
+    int jobId;
+    std::string description;
+    std::string backtrace;
+    int line;
+};
+
+// /syntax_error - line is -1 when the error couldn't be pinned to a line
+struct SyntaxError
+{
+    int jobId;
+    std::string description;
+    std::string errorLine;
+    int line;
+    std::string lineNumber;
+};
+
+// All callbacks are invoked on the client's receive thread, in the order
+// the server sent the messages. Unset callbacks are skipped. Anything the
+// client doesn't decode itself (buffer updates, MIDI ports, version info)
+// is passed through to unhandled.
+struct Callbacks
+{
+    std::function<void(const MultiLog&)> log;
+    std::function<void(const InfoMessage&)> info;
+    std::function<void(const CueInfo&)> cue;
+    std::function<void(const RuntimeError&)> runtimeError;
+    std::function<void(const SyntaxError&)> syntaxError;
+    std::function<void()> allJobsCompleted;
+    std::function<void(const std::string&)> bootError;
+    std::function<void()> exited;
+    std::function<void(const oscpkt::Message&)> unhandled;
+};
+
+struct BootOptions
+{
+    // Root of the Sonic Pi install - the directory containing app/ and etc/
+    std::string rootPath;
+
+    // Defaults to the bundled Ruby if there is one, otherwise ruby on the PATH
+    std::string rubyPath;
+
+    // Defaults to $SONIC_PI_HOME, falling back to the user's home directory.
+    // Server output is logged to <homePath>/.sonic-pi/log
+    std::string homePath;
+
+    int timeoutMs = 60000;
+};
+
+// Allocates ports in the same way as app/server/ruby/bin/port-discovery.rb,
+// keyed by the same names
+std::map<std::string, int> DiscoverPorts();
+bool PortAvailable(int port);
+
+class Client
+{
+public:
+    explicit Client(const Callbacks& callbacks);
+    ~Client();
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    // Discovers ports, launches the server and pings it until it reports
+    // that it has booted. Resolves to false if the server couldn't be
+    // started, reported a boot error, died or didn't answer in time.
+    // Call Shutdown() before booting the same client again.
+    std::future<bool> Boot(const BootOptions& options);
+    bool IsBooted() const;
+
+    bool RunCode(const std::string& code);
+    bool SaveAndRunBuffer(const std::string& bufferId, const std::string& code);
+    bool StopAll();
+
+    // For anything not wrapped above. The message should start with this
+    // client's id, as the server expects.
+    bool Send(const oscpkt::Message& msg);
+
+    // Asks the server to exit and waits for it to do so, killing it if it
+    // hasn't gone within the timeout. Returns true if it exited cleanly.
+    bool Shutdown(int timeoutMs = 10000);
+
+    const std::string& ClientId() const;
+    std::map<std::string, int> Ports() const;
+
+private:
+    enum class State
+    {
+        Stopped,
+        Booting,
+        Booted,
+        Failed,
+        Exited
+    };
+
+    bool BootServer(const BootOptions& options);
+    void ReceiveLoop();
+    void Dispatch(const char* data, size_t size);
+    void SetState(State state);
+    void StopThreads();
+
+    Callbacks m_callbacks;
+    std::string m_clientId;
+
+    std::map<std::string, int> m_ports;
+    std::unique_ptr<oscpkt::UdpSocket> m_listenSocket;
+    std::unique_ptr<oscpkt::UdpSocket> m_sendSocket;
+    mutable std::mutex m_sendMutex;
+
+    struct Process;
+    std::unique_ptr<Process> m_server;
+
+    State m_state = State::Stopped;
+    mutable std::mutex m_stateMutex;
+    std::condition_variable m_stateChanged;
+
+    std::atomic<bool> m_stopping;
+    std::thread m_receiveThread;
+    std::thread m_bootThread;
+    std::promise<bool> m_booted;
+};
 
-} // SonicPi
 } // API
+} // SonicPi
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "tlsf.h"
+}
+
+namespace SonicPi {
+namespace Memory {
+
+// A fixed-size TLSF pool for threads that mustn't touch the global heap.
+// All the memory is taken up front; after that Allocate and Deallocate
+// are O(1) and never call into the system allocator. When the pool is
+// exhausted Allocate returns nullptr rather than growing.
+//
+// TLSF itself isn't thread safe, so access is serialised with a
+// spinlock. Critical sections are a handful of instructions, which is
+// cheaper and more predictable than a mutex on the realtime threads.
+//
+// Needs external/TLSF-2.4.6/src/tlsf.c compiled in; SonicPiAPI does that.
+class Arena
+{
+public:
+    explicit Arena(size_t bytes)
+        : m_memory(static_cast<char*>(std::calloc(bytes, 1)))
+        , m_capacity(bytes)
+    {
+        if (!m_memory || init_memory_pool(bytes, m_memory) == size_t(-1))
+        {
+            std::free(m_memory);
+            throw std::bad_alloc();
+        }
+    }
+
+    ~Arena()
+    {
+        destroy_memory_pool(m_memory);
+        std::free(m_memory);
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* Allocate(size_t bytes)
+    {
+        Lock();
+        void* ptr = malloc_ex(bytes, m_memory);
+        Unlock();
+        return ptr;
+    }
+
+    void Deallocate(void* ptr)
+    {
+        if (!ptr)
+        {
+            return;
+        }
+        Lock();
+        free_ex(ptr, m_memory);
+        Unlock();
+    }
+
+    size_t Capacity() const { return m_capacity; }
+
+    // Bytes handed out, including TLSF's block headers. Only tracked when
+    // tlsf.c is built with TLSF_STATISTIC, otherwise 0.
+    size_t Used()
+    {
+        Lock();
+        size_t used = get_used_size(m_memory);
+        Unlock();
+        return used;
+    }
+
+private:
+    void Lock()
+    {
+        while (m_lock.test_and_set(std::memory_order_acquire))
+        {
+        }
+    }
+
+    void Unlock() { m_lock.clear(std::memory_order_release); }
+
+    char* m_memory;
+    size_t m_capacity;
+    std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
+};
+
+// STL allocator over an Arena, e.g. ArenaVector<float> v(ArenaAllocator<float>(arena)).
+// Allocators compare equal when they share an arena, so containers can be
+// moved between each other without copying. Throws std::bad_alloc when
+// the arena is full, like std::allocator does when the heap is.
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena& arena) noexcept
+        : m_arena(&arena)
+    {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+        : m_arena(other.GetArena())
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        void* ptr = m_arena->Allocate(n * sizeof(T));
+        if (!ptr)
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t) noexcept { m_arena->Deallocate(ptr); }
+
+    Arena* GetArena() const noexcept { return m_arena; }
+
+private:
+    Arena* m_arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept { return a.GetArena() == b.GetArena(); }
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept { return a.GetArena() != b.GetArena(); }
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+// Marks the current thread as realtime for the lifetime of the guard.
+// It only has an effect when built with SP_RT_ALLOC_CHECK, where
+// SP_RT_ALLOC_CHECK_IMPLEMENT replaces the global operator new/delete
+// with versions that abort on a realtime thread. That catches heap use
+// in the STL, Qt and our own code. Plain malloc calls from C libraries
+// aren't caught.
+//
+// Guards nest, and AllowAllocations suspends the check for things the
+// realtime threads are allowed to do slowly, like reporting an error.
+inline int& RealtimeDepth()
+{
+    static thread_local int depth = 0;
+    return depth;
+}
+
+class RealtimeScope
+{
+public:
+    RealtimeScope() { RealtimeDepth()++; }
+    ~RealtimeScope() { RealtimeDepth()--; }
+    RealtimeScope(const RealtimeScope&) = delete;
+    RealtimeScope& operator=(const RealtimeScope&) = delete;
+};
+
+class AllowAllocations
+{
+public:
+    AllowAllocations() : m_saved(RealtimeDepth()) { RealtimeDepth() = 0; }
+    ~AllowAllocations() { RealtimeDepth() = m_saved; }
+    AllowAllocations(const AllowAllocations&) = delete;
+    AllowAllocations& operator=(const AllowAllocations&) = delete;
+
+private:
+    int m_saved;
+};
+
+inline void CheckNotRealtime(const char* what)
+{
+    if (RealtimeDepth() > 0)
+    {
+        std::fprintf(stderr, "[RT] - %s on a realtime thread\n", what);
+        std::abort();
+    }
+}
+
+} // Memory
+} // SonicPi
+
+// Define once per binary (it replaces the global operators), in a
+// translation unit that includes this header.
+#ifdef SP_RT_ALLOC_CHECK
+#define SP_RT_ALLOC_CHECK_IMPLEMENT                                                              \
+    void* operator new(size_t size)                                                              \
+    {                                                                                            \
+        SonicPi::Memory::CheckNotRealtime("operator new");                                       \
+        if (void* ptr = std::malloc(size ? size : 1))                                            \
+            return ptr;                                                                          \
+        throw std::bad_alloc();                                                                  \
+    }                                                                                            \
+    void* operator new[](size_t size) { return operator new(size); }                             \
+    void* operator new(size_t size, const std::nothrow_t&) noexcept                             \
+    {                                                                                            \
+        SonicPi::Memory::CheckNotRealtime("operator new");                                       \
+        return std::malloc(size ? size : 1);                                                     \
+    }                                                                                            \
+    void* operator new[](size_t size, const std::nothrow_t& nt) noexcept { return operator new(size, nt); } \
+    void operator delete(void* ptr) noexcept                                                     \
+    {                                                                                            \
+        if (ptr)                                                                                 \
+            SonicPi::Memory::CheckNotRealtime("operator delete");                                \
+        std::free(ptr);                                                                          \
+    }                                                                                            \
+    void operator delete[](void* ptr) noexcept { operator delete(ptr); }                         \
+    void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }                   \
+    void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }                 \
+    void operator delete(void* ptr, const std::nothrow_t&) noexcept { operator delete(ptr); }    \
+    void operator delete[](void* ptr, const std::nothrow_t&) noexcept { operator delete(ptr); }
+#else
+#define SP_RT_ALLOC_CHECK_IMPLEMENT
+#endif
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SonicPi {
+namespace Metrics {
+
+// Always-on counters, gauges and histograms for spotting backlogs in a
+// running system. Updating one is a relaxed atomic op or two and nothing
+// is formatted or sent anywhere until someone asks for a Snapshot, so
+// they can stay in release builds and on the realtime threads.
+//
+// Header only so that sp_midi, which is built outside the GUI's CMake
+// project, can share it.
+
+class Counter
+{
+public:
+    void Add(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Get() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_value { 0 };
+};
+
+class Gauge
+{
+public:
+    void Set(int64_t v) { m_value.store(v, std::memory_order_relaxed); }
+    void Add(int64_t n) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    int64_t Get() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> m_value { 0 };
+};
+
+// Counts values into buckets whose upper bounds are fixed when the
+// histogram is registered, plus an overflow bucket. Quantiles are
+// reported as the upper bound of the bucket they fall in.
+class Histogram
+{
+public:
+    static const size_t MaxBuckets = 16;
+
+    explicit Histogram(const std::vector<double>& bounds)
+    {
+        m_numBounds = std::min(bounds.size(), MaxBuckets - 1);
+        std::copy(bounds.begin(), bounds.begin() + m_numBounds, m_bounds);
+    }
+
+    // Bounds for latencies in milliseconds
+    static std::vector<double> LatencyMsBounds()
+    {
+        return { 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 25.0, 50.0, 100.0, 250.0, 1000.0 };
+    }
+
+    void Record(double v)
+    {
+        size_t i = 0;
+        while (i < m_numBounds && v > m_bounds[i])
+        {
+            i++;
+        }
+        m_counts[i].fetch_add(1, std::memory_order_relaxed);
+
+        // Only one writer per histogram in practice, so these rarely spin
+        double sum = m_sum.load(std::memory_order_relaxed);
+        while (!m_sum.compare_exchange_weak(sum, sum + v, std::memory_order_relaxed))
+        {
+        }
+        double max = m_max.load(std::memory_order_relaxed);
+        while (v > max && !m_max.compare_exchange_weak(max, v, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t Count() const
+    {
+        uint64_t n = 0;
+        for (size_t i = 0; i <= m_numBounds; i++)
+        {
+            n += m_counts[i].load(std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    double Mean() const
+    {
+        uint64_t n = Count();
+        return n ? m_sum.load(std::memory_order_relaxed) / n : 0.0;
+    }
+
+    double Max() const { return m_max.load(std::memory_order_relaxed); }
+
+    double Quantile(double q) const
+    {
+        uint64_t n = Count();
+        if (n == 0)
+        {
+            return 0.0;
+        }
+        uint64_t target = uint64_t(q * n);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < m_numBounds; i++)
+        {
+            seen += m_counts[i].load(std::memory_order_relaxed);
+            if (seen > target)
+            {
+                return m_bounds[i];
+            }
+        }
+        // Overflow bucket - the best we can say is the largest value seen
+        return Max();
+    }
+
+private:
+    double m_bounds[MaxBuckets - 1];
+    size_t m_numBounds;
+    std::atomic<uint64_t> m_counts[MaxBuckets] = {};
+    std::atomic<double> m_sum { 0.0 };
+    std::atomic<double> m_max { 0.0 };
+};
+
+struct Sample
+{
+    std::string name;
+    double value;
+};
+
+// Owns every metric in the process, keyed by name. Registering is
+// locked and expected to happen once per call site (keep the returned
+// reference in a static); the metrics themselves never move.
+class Registry
+{
+public:
+    // Never destroyed, so threads still running at exit can keep counting
+    static Registry& Global()
+    {
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+
+    Counter& GetCounter(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& c = m_counters[name];
+        if (!c)
+        {
+            c.reset(new Counter);
+        }
+        return *c;
+    }
+
+    Gauge& GetGauge(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& g = m_gauges[name];
+        if (!g)
+        {
+            g.reset(new Gauge);
+        }
+        return *g;
+    }
+
+    // The bounds of the first registration win
+    Histogram& GetHistogram(const std::string& name, const std::vector<double>& bounds)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& h = m_histograms[name];
+        if (!h)
+        {
+            h.reset(new Histogram(bounds));
+        }
+        return *h;
+    }
+
+    // Flattens everything into name/value pairs, sorted by name.
+    // Histograms become <name>.count, .mean, .p50, .p99 and .max.
+    std::vector<Sample> Snapshot() const
+    {
+        std::vector<Sample> samples;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& c : m_counters)
+        {
+            samples.push_back({ c.first, double(c.second->Get()) });
+        }
+        for (auto& g : m_gauges)
+        {
+            samples.push_back({ g.first, double(g.second->Get()) });
+        }
+        for (auto& h : m_histograms)
+        {
+            samples.push_back({ h.first + ".count", double(h.second->Count()) });
+            samples.push_back({ h.first + ".mean", h.second->Mean() });
+            samples.push_back({ h.first + ".p50", h.second->Quantile(0.5) });
+            samples.push_back({ h.first + ".p99", h.second->Quantile(0.99) });
+            samples.push_back({ h.first + ".max", h.second->Max() });
+        }
+        std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.name < b.name; });
+        return samples;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::map<std::string, std::unique_ptr<Counter>> m_counters;
+    std::map<std::string, std::unique_ptr<Gauge>> m_gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> m_histograms;
+};
+
+inline Counter& GetCounter(const std::string& name) { return Registry::Global().GetCounter(name); }
+inline Gauge& GetGauge(const std::string& name) { return Registry::Global().GetGauge(name); }
+inline Histogram& GetHistogram(const std::string& name, const std::vector<double>& bounds) { return Registry::Global().GetHistogram(name, bounds); }
+
+} // Metrics
+} // SonicPi
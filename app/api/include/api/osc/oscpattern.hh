@@ -0,0 +1,220 @@
+/*
+  Compiled OSC address patterns for oscpkt.
+
+  oscpkt::fullPatternMatch interprets the pattern string character by
+  character on every call, re-scanning bracket ranges and brace lists
+  each time. CompiledPattern parses a pattern once into a short list of
+  ops (literal runs, '?', '[...]', '*', '//', '{...}') and matches
+  against that, with exactly the same results as internalPatternMatch.
+  Patterns made only of literal characters are matched with a single
+  compare.
+
+  PatternCache hands out compiled patterns keyed by their source string
+  so that repeated addresses are only compiled once.
+*/
+
+#ifndef OSCPKT_PATTERN_HH
+#define OSCPKT_PATTERN_HH
+
+#include <bitset>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace oscpkt {
+
+class CompiledPattern {
+public:
+  explicit CompiledPattern(const std::string &pattern) : literal(true) { compile(pattern.c_str()); }
+
+  /** true if the whole of 'path' is matched by the whole pattern */
+  bool fullMatch(const char *path) const {
+    if (literal) return ops.empty() ? *path == 0 : strcmp(ops[0].text.c_str(), path) == 0;
+    return matchFrom(0, path) == FULL;
+  }
+  bool fullMatch(const std::string &path) const {
+    if (literal) return ops.empty() ? path.empty() : ops[0].text == path;
+    return matchFrom(0, path.c_str()) == FULL;
+  }
+
+  /** true if 'path' is matched by the first characters of the pattern */
+  bool partialMatch(const char *path) const {
+    if (literal) {
+      if (ops.empty()) return *path == 0;
+      size_t n = strlen(path);
+      return n <= ops[0].text.size() && ops[0].text.compare(0, n, path) == 0;
+    }
+    return matchFrom(0, path) != FAIL;
+  }
+  bool partialMatch(const std::string &path) const { return partialMatch(path.c_str()); }
+
+  /** true if the pattern contains no wildcards and only matches itself */
+  bool isLiteral() const { return literal; }
+
+private:
+  enum OpType { LITERAL, ANY_CHAR, CHAR_CLASS, STAR, SUPER_WILDCARD, ALTERNATIVES, STUCK, BROKEN };
+
+  // Match results, ordered so that the best of several candidates is the max.
+  // PARTIAL is internalPatternMatch returning a pointer short of the end of
+  // the pattern, FULL is it returning the end of the pattern.
+  enum Result { FAIL = 0, PARTIAL = 1, FULL = 2 };
+
+  struct Op {
+    OpType type;
+    std::string text;                      // LITERAL
+    std::bitset<256> chars;                // CHAR_CLASS
+    std::vector<std::string> alternatives; // ALTERNATIVES
+  };
+
+  std::vector<Op> ops;
+  bool literal;
+
+  void pushLiteral(char c) {
+    if (ops.empty() || ops.back().type != LITERAL) { ops.push_back(Op()); ops.back().type = LITERAL; }
+    ops.back().text += c;
+  }
+
+  void pushOp(OpType type) {
+    ops.push_back(Op()); ops.back().type = type;
+    literal = false;
+  }
+
+  void compile(const char *p) {
+    while (*p) {
+      if (*p == '?') { pushOp(ANY_CHAR); ++p; }
+      else if (*p == '[') {
+        // ranges compare plain (possibly signed) chars, as internalPatternMatch does
+        const char *q = p + 1;
+        bool reverse = false;
+        if (*q == '!') { reverse = true; ++q; }
+        std::bitset<256> in_range;
+        for (; *q && *q != ']'; ++q) {
+          char c0 = *q, c1 = c0;
+          if (q[1] == '-' && q[2]) { q += 2; c1 = *q; }
+          for (int c = 1; c < 256; ++c) {
+            char ch = (char)c;
+            if (ch >= c0 && ch <= c1) in_range.set(c);
+          }
+        }
+        if (*q != ']') { pushOp(STUCK); return; }
+        pushOp(CHAR_CLASS);
+        ops.back().chars = reverse ? ~in_range : in_range;
+        ops.back().chars.reset(0);
+        p = q + 1;
+      } else if (*p == '*') {
+        while (*p == '*') ++p;
+        pushOp(STAR);
+      } else if (*p == '/' && p[1] == '/') {
+        while (p[1] == '/') ++p;
+        pushOp(SUPER_WILDCARD);
+        // the remaining '/' is matched as a literal by the following op
+        pushLiteral('/');
+        ++p;
+      } else if (*p == '{') {
+        const char *end = strchr(p, '}');
+        if (!end) { pushOp(BROKEN); return; }
+        pushOp(ALTERNATIVES);
+        const char *q;
+        do {
+          ++p;
+          q = strchr(p, ',');
+          if (q == 0 || q > end) q = end;
+          ops.back().alternatives.push_back(std::string(p, q));
+          p = q;
+        } while (q != end);
+        p = end + 1;
+      } else { pushLiteral(*p); ++p; }
+    }
+  }
+
+  Result matchFrom(size_t i, const char *path) const {
+    for (; i < ops.size(); ++i) {
+      const Op &op = ops[i];
+      switch (op.type) {
+      case LITERAL:
+        for (size_t k = 0; k < op.text.size(); ++k, ++path) {
+          if (op.text[k] != *path) return *path == 0 ? PARTIAL : FAIL;
+        }
+        break;
+      case ANY_CHAR:
+        if (*path == 0) return PARTIAL;
+        ++path;
+        break;
+      case CHAR_CLASS:
+        if (*path == 0) return PARTIAL;
+        if (!op.chars.test((unsigned char)*path)) return PARTIAL;
+        ++path;
+        break;
+      case STAR: {
+        Result best = FAIL;
+        while (true) {
+          Result r = matchFrom(i + 1, path);
+          if (r > best) best = r;
+          if (*path == 0 || *path == '/') break;
+          ++path;
+        }
+        return best;
+      }
+      case SUPER_WILDCARD: {
+        Result best = FAIL;
+        while (true) {
+          Result r = matchFrom(i + 1, path);
+          if (r > best) best = r;
+          if (*path == 0 || (path = strchr(path + 1, '/')) == 0) break;
+        }
+        return best;
+      }
+      case ALTERNATIVES: {
+        bool match = false;
+        for (size_t k = 0; k < op.alternatives.size() && !match; ++k) {
+          const std::string &alt = op.alternatives[k];
+          if (strncmp(alt.c_str(), path, alt.size()) == 0) { path += alt.size(); match = true; }
+        }
+        if (!match) return PARTIAL;
+        break;
+      }
+      case STUCK:
+        return PARTIAL;
+      case BROKEN:
+        return FAIL;
+      }
+    }
+    return *path == 0 ? FULL : FAIL;
+  }
+};
+
+/** A bounded cache of compiled patterns keyed by pattern string. Not
+    thread safe: use one per thread (see threadPatternCache()). */
+class PatternCache {
+public:
+  explicit PatternCache(size_t max_entries = 256) : max_entries(max_entries) {}
+
+  std::shared_ptr<const CompiledPattern> get(const std::string &pattern) {
+    auto it = patterns.find(pattern);
+    if (it != patterns.end()) return it->second;
+    // addresses are usually drawn from a small fixed set, so when that
+    // assumption breaks just start again rather than tracking recency
+    if (patterns.size() >= max_entries) patterns.clear();
+    auto compiled = std::make_shared<const CompiledPattern>(pattern);
+    patterns.emplace(pattern, compiled);
+    return compiled;
+  }
+
+  size_t size() const { return patterns.size(); }
+  void clear() { patterns.clear(); }
+
+private:
+  std::unordered_map<std::string, std::shared_ptr<const CompiledPattern> > patterns;
+  size_t max_entries;
+};
+
+inline PatternCache &threadPatternCache() {
+  static thread_local PatternCache cache;
+  return cache;
+}
+
+} // namespace oscpkt
+
+#endif // OSCPKT_PATTERN_HH
@@ -25,6 +25,10 @@
     - oscpkt::PacketReader  : read the bundles/messages embedded in an OSC packet
     - oscpkt::PacketWriter  : write bundles/messages into an OSC packet
 
+  And for reading without copying (added for Sonic Pi):
+    - oscpkt::MessageView      : read an OSC message in place
+    - oscpkt::PacketViewReader : PacketReader for MessageViews
+
   And optionaly:
     - oscpkt::UdpSocket     : read/write OSC packets over UDP.
 
@@ -72,6 +76,9 @@ typedef unsigned __int64 uint64_t;
 #include <string>
 #include <vector>
 #include <list>
+#include <memory>
+
+#include "oscpattern.hh"
 
 #if defined(OSCPKT_OSTREAM_OUTPUT) || defined(OSCPKT_TEST)
 #include <iostream>
@@ -223,6 +230,12 @@ class Message {
   std::vector<std::pair<size_t, size_t> > arguments; // array of pairs (pos,size), pos being an index into the 'storage' array.
   Storage storage; // the arguments data is stored here
   ErrorCode err;
+  mutable std::shared_ptr<const CompiledPattern> compiled_address; // built on first match()
+
+  const CompiledPattern &compiledAddress() const {
+    if (!compiled_address) compiled_address = threadPatternCache().get(address);
+    return *compiled_address;
+  }
 public:  
   /** ArgReader is used for popping arguments from a Message, holds a
       pointer to the original Message, and maintains a local error code */
@@ -321,7 +334,7 @@ public:
 
   Message() { clear(); }
   Message(const std::string &s, TimeTag tt = TimeTag::immediate()) : time_tag(tt), address(s), err(OK_NO_ERROR) {}
-  Message(const void *ptr, size_t sz, TimeTag tt = TimeTag::immediate()) { buildFromRawData(ptr, sz); time_tag = tt; }
+  Message(const void *ptr, size_t sz, TimeTag tt = TimeTag::immediate()) { buildFromRawData(ptr, sz, tt); }
 
   bool isOk() const { return err == OK_NO_ERROR; }
   ErrorCode getErr() const { return err; }
@@ -352,18 +365,19 @@ public:
       @endcode
   */
   ArgReader match(const std::string &test) const {
-    return ArgReader(*this, fullPatternMatch(address.c_str(), test.c_str()) ? OK_NO_ERROR : PATTERN_MISMATCH);
+    return ArgReader(*this, compiledAddress().fullMatch(test) ? OK_NO_ERROR : PATTERN_MISMATCH);
   }
   /** return true if the 'test' path matched by the first characters of addressPattern().
       For ex. ("/foo/bar").partialMatch("/foo/") is true */
   ArgReader partialMatch(const std::string &test) const {
-    return ArgReader(*this, partialPatternMatch(address.c_str(), test.c_str()) ? OK_NO_ERROR : PATTERN_MISMATCH);
+    return ArgReader(*this, compiledAddress().partialMatch(test) ? OK_NO_ERROR : PATTERN_MISMATCH);
   }
   ArgReader arg() const { return ArgReader(*this, OK_NO_ERROR); }
 
   /** build the osc message for raw data (the message will keep a copy of that data) */
-  void buildFromRawData(const void *ptr, size_t sz) {
+  void buildFromRawData(const void *ptr, size_t sz, TimeTag tt = TimeTag::immediate()) {
     clear();
+    time_tag = tt;
     storage.assign((const char*)ptr, (const char*)ptr + sz);
     const char *address_beg = storage.begin();
     const char *address_end = (const char*)memchr(address_beg, 0, storage.end()-address_beg);
@@ -419,7 +433,7 @@ public:
 
   /** reset the message to a clean state */
   void clear() { 
-    address.clear(); type_tags.clear(); storage.clear(); arguments.clear(); 
+    address.clear(); type_tags.clear(); storage.clear(); arguments.clear(); compiled_address.reset();
     err = OK_NO_ERROR; time_tag = TimeTag::immediate();
   }
 
@@ -501,6 +515,239 @@ private:
 #endif
 };
 
+/**
+   A non-owning reference to a run of chars, in the spirit of C++17's
+   std::string_view. Views of OSC string arguments are followed by a
+   0 in the packet, so data() can also be used as a C string.
+*/
+class StringView {
+  const char *ptr;
+  size_t len;
+public:
+  StringView() : ptr(""), len(0) {}
+  StringView(const char *p, size_t n) : ptr(p), len(n) {}
+  const char *data() const { return ptr; }
+  size_t size() const { return len; }
+  bool empty() const { return len == 0; }
+  const char *begin() const { return ptr; }
+  const char *end() const { return ptr + len; }
+  char operator[](size_t i) const { return ptr[i]; }
+  std::string str() const { return std::string(ptr, len); }
+  bool operator==(const char *s) const { return strlen(s) == len && memcmp(ptr, s, len) == 0; }
+  bool operator!=(const char *s) const { return !(*this == s); }
+};
+
+/**
+   Read-only view of an OSC message held in someone else's buffer.
+
+   This is the reading half of Message without any of the copies: the
+   address, type tags, strings and blobs are StringViews straight into
+   the packet, which must outlive the view. Arguments are validated
+   once in init() and then walked in place by ArgReader. Get these from
+   a PacketViewReader.
+
+   @code
+   oscpkt::StringView s; int32_t i;
+   if (msg->match("/log/info").popInt32(i).popStr(s).isOkNoMoreArgs()) { ... }
+   @endcode
+*/
+class MessageView {
+  TimeTag time_tag;
+  const char *beg, *end;
+  StringView address;
+  StringView type_tags;
+  const char *args_beg;
+  ErrorCode err;
+  bool literal_address; // no wildcards, so match() is a plain compare
+  mutable std::shared_ptr<const CompiledPattern> compiled_address;
+
+public:
+  /** same interface as Message::ArgReader, with strings and blobs popped as views */
+  class ArgReader {
+    const MessageView *msg;
+    ErrorCode err;
+    size_t arg_idx;  // arg index of the next arg that will be popped out.
+    const char *pos; // and where its data starts
+  public:
+    ArgReader(const MessageView &m, ErrorCode e = OK_NO_ERROR) : msg(&m), err(m.getErr()), arg_idx(0), pos(m.args_beg) {
+      if (e != OK_NO_ERROR && err == OK_NO_ERROR) err=e;
+    }
+    bool isBool() { return currentTypeTag() == TYPE_TAG_TRUE || currentTypeTag() == TYPE_TAG_FALSE; }
+    bool isInt32() { return currentTypeTag() == TYPE_TAG_INT32; }
+    bool isInt64() { return currentTypeTag() == TYPE_TAG_INT64; }
+    bool isFloat() { return currentTypeTag() == TYPE_TAG_FLOAT; }
+    bool isDouble() { return currentTypeTag() == TYPE_TAG_DOUBLE; }
+    bool isStr() { return currentTypeTag() == TYPE_TAG_STRING; }
+    bool isBlob() { return currentTypeTag() == TYPE_TAG_BLOB; }
+
+    size_t nbArgRemaining() const { return msg->type_tags.size() - arg_idx; }
+    bool isOk() const { return err == OK_NO_ERROR; }
+    operator bool() const { return isOk(); }
+    bool isOkNoMoreArgs() const { return err == OK_NO_ERROR && nbArgRemaining() == 0; }
+    ErrorCode getErr() const { return err; }
+
+    ArgReader &popInt32(int32_t &i) { return popPod<int32_t>(TYPE_TAG_INT32, i); }
+    ArgReader &popInt64(int64_t &i) { return popPod<int64_t>(TYPE_TAG_INT64, i); }
+    ArgReader &popFloat(float &f) { return popPod<float>(TYPE_TAG_FLOAT, f); }
+    ArgReader &popDouble(double &d) { return popPod<double>(TYPE_TAG_DOUBLE, d); }
+    /** retrieve a string argument as a view into the packet */
+    ArgReader &popStr(StringView &s) {
+      if (precheck(TYPE_TAG_STRING)) {
+        size_t len = strlen(pos);
+        s = StringView(pos, len);
+        advance(len + 1);
+      }
+      return *this;
+    }
+    /** retrieve a string argument as a copy, for callers that need to own it */
+    ArgReader &popStr(std::string &s) {
+      StringView v;
+      if (popStr(v)) s.assign(v.data(), v.size());
+      return *this;
+    }
+    /** retrieve a binary blob as a view into the packet */
+    ArgReader &popBlob(StringView &b) {
+      if (precheck(TYPE_TAG_BLOB)) {
+        size_t len = bytes2pod<uint32_t>(pos);
+        b = StringView(pos + 4, len);
+        advance(len + 4);
+      }
+      return *this;
+    }
+    ArgReader &popBlob(std::vector<char> &b) {
+      StringView v;
+      if (popBlob(v)) b.assign(v.begin(), v.end());
+      return *this;
+    }
+    ArgReader &popBool(bool &b) {
+      b = false;
+      if (arg_idx >= msg->type_tags.size()) OSCPKT_SET_ERR(NOT_ENOUGH_ARG);
+      else if (currentTypeTag() == TYPE_TAG_TRUE) b = true;
+      else if (currentTypeTag() == TYPE_TAG_FALSE) b = false;
+      else OSCPKT_SET_ERR(TYPE_MISMATCH);
+      ++arg_idx;
+      return *this;
+    }
+    /** skip whatever comes next */
+    ArgReader &pop() {
+      if (arg_idx >= msg->type_tags.size()) OSCPKT_SET_ERR(NOT_ENOUGH_ARG);
+      else if (!err) advance(MessageView::argSize(msg->type_tags[arg_idx], pos));
+      return *this;
+    }
+  private:
+    void advance(size_t sz) { pos += ceil4(sz); ++arg_idx; }
+    int currentTypeTag() {
+      if (!err && arg_idx < msg->type_tags.size()) return msg->type_tags[arg_idx];
+      else OSCPKT_SET_ERR(NOT_ENOUGH_ARG);
+      return -1;
+    }
+    template <typename POD> ArgReader &popPod(int tag, POD &v) {
+      if (precheck(tag)) {
+        v = bytes2pod<POD>(pos);
+        advance(sizeof(POD));
+      } else v = POD(0);
+      return *this;
+    }
+    bool precheck(int tag) {
+      if (arg_idx >= msg->type_tags.size()) OSCPKT_SET_ERR(NOT_ENOUGH_ARG);
+      else if (!err && currentTypeTag() != tag) OSCPKT_SET_ERR(TYPE_MISMATCH);
+      return err == OK_NO_ERROR;
+    }
+  };
+
+  MessageView() : beg(0), end(0), args_beg(0), err(OK_NO_ERROR), literal_address(true) {}
+  MessageView(const void *ptr, size_t sz, TimeTag tt = TimeTag::immediate()) { init(ptr, sz, tt); }
+
+  /** point the view at a new message, validating its layout */
+  void init(const void *ptr, size_t sz, TimeTag tt = TimeTag::immediate()) {
+    time_tag = tt; err = OK_NO_ERROR;
+    beg = (const char*)ptr; end = beg + sz;
+    address = StringView(); type_tags = StringView(); args_beg = end;
+    literal_address = true; compiled_address.reset();
+
+    const char *address_end = (const char*)memchr(beg, 0, sz);
+    if (!address_end || !isPaddingCorrect(address_end+1) || beg[0] != '/') {
+      OSCPKT_SET_ERR(MALFORMED_ADDRESS_PATTERN); return;
+    }
+    address = StringView(beg, address_end - beg);
+    for (const char *c = beg; c < address_end; ++c) {
+      if (*c == '?' || *c == '*' || *c == '[' || *c == '{' || (*c == '/' && c[1] == '/')) { literal_address = false; break; }
+    }
+
+    const char *type_tags_beg = align(address_end+1);
+    const char *type_tags_end = (const char*)memchr(type_tags_beg, 0, end-type_tags_beg);
+    if (!type_tags_end || !isPaddingCorrect(type_tags_end+1) || type_tags_beg[0] != ',') {
+      OSCPKT_SET_ERR(MALFORMED_TYPE_TAGS); return;
+    }
+    type_tags = StringView(type_tags_beg+1, type_tags_end - type_tags_beg - 1);
+
+    args_beg = align(type_tags_end+1);
+    const char *arg = args_beg;
+    for (size_t iarg = 0; iarg < type_tags.size(); ++iarg) {
+      if (type_tags[iarg] == TYPE_TAG_BLOB && (end - arg < 4 || bytes2pod<uint32_t>(arg) > size_t(end - arg) - 4)) { OSCPKT_SET_ERR(MALFORMED_ARGUMENTS); return; }
+      if (type_tags[iarg] == TYPE_TAG_STRING && !memchr(arg, 0, end-arg)) { OSCPKT_SET_ERR(MALFORMED_ARGUMENTS); return; }
+      size_t len = argSize(type_tags[iarg], arg);
+      if (len == size_t(-1)) { OSCPKT_SET_ERR(UNHANDLED_TYPE_TAGS); return; }
+      if (size_t(end - arg) < len || !isPaddingCorrect(arg+len)) { OSCPKT_SET_ERR(MALFORMED_ARGUMENTS); return; }
+      arg = align(arg+len);
+    }
+    if (arg != end) OSCPKT_SET_ERR(MALFORMED_ARGUMENTS);
+  }
+
+  bool isOk() const { return err == OK_NO_ERROR; }
+  ErrorCode getErr() const { return err; }
+  const StringView &typeTags() const { return type_tags; }
+  const StringView &addressPattern() const { return address; }
+  TimeTag timeTag() const { return time_tag; }
+
+  ArgReader match(const char *test) const {
+    bool ok;
+    if (literal_address) ok = address == test;
+    else ok = compiledAddress().fullMatch(test);
+    return ArgReader(*this, ok ? OK_NO_ERROR : PATTERN_MISMATCH);
+  }
+  ArgReader match(const std::string &test) const { return match(test.c_str()); }
+  ArgReader partialMatch(const char *test) const {
+    bool ok;
+    if (literal_address) { size_t n = strlen(test); ok = n <= address.size() && memcmp(address.data(), test, n) == 0; }
+    else ok = compiledAddress().partialMatch(test);
+    return ArgReader(*this, ok ? OK_NO_ERROR : PATTERN_MISMATCH);
+  }
+  ArgReader partialMatch(const std::string &test) const { return partialMatch(test.c_str()); }
+  ArgReader arg() const { return ArgReader(*this, OK_NO_ERROR); }
+
+private:
+  const CompiledPattern &compiledAddress() const {
+    if (!compiled_address) compiled_address = threadPatternCache().get(address.str());
+    return *compiled_address;
+  }
+
+  // the buffer need not be 4-byte aligned, so pad relative to its start
+  const char *align(const char *p) const { return beg + ceil4(size_t(p - beg)); }
+  bool isPaddingCorrect(const char *p) const {
+    const char *q = align(p);
+    if (q > end) return false;
+    for (; p < q; ++p) if (*p != 0) return false;
+    return true;
+  }
+
+  /* the number of bytes occupied by an argument, or -1 for an unknown type.
+     strings and blobs must already be known to fit */
+  static size_t argSize(int type, const char *p) {
+    switch (type) {
+      case TYPE_TAG_TRUE:
+      case TYPE_TAG_FALSE: return 0;
+      case TYPE_TAG_INT32:
+      case TYPE_TAG_FLOAT: return 4;
+      case TYPE_TAG_INT64:
+      case TYPE_TAG_DOUBLE: return 8;
+      case TYPE_TAG_STRING: return strlen(p)+1;
+      case TYPE_TAG_BLOB: return 4+size_t(bytes2pod<uint32_t>(p));
+      default: return size_t(-1);
+    }
+  }
+};
+
 /**
    parse an OSC packet and extracts the embedded OSC messages. 
 */
@@ -511,24 +758,26 @@ public:
   PacketReader(const void *ptr, size_t sz) { init(ptr, sz); }
 
   void init(const void *ptr, size_t sz) {
-    err = OK_NO_ERROR; messages.clear();
+    err = OK_NO_ERROR; nb_messages = 0; it_messages = 0;
     if ((sz%4) == 0) { 
       parse((const char*)ptr, (const char *)ptr+sz, TimeTag::immediate());
     } else OSCPKT_SET_ERR(INVALID_PACKET_SIZE);
-    it_messages = messages.begin();
   }
   
-  /** extract the next osc message from the packet. return 0 when all messages have been read, or in case of error. */
+  /** extract the next osc message from the packet. return 0 when all messages have been read, or in case of error. 
+      The message is only valid until the next call to init(). */
   Message *popMessage() {
-    if (!err && !messages.empty() && it_messages != messages.end()) return &*it_messages++;
+    if (!err && it_messages < nb_messages) return &messages[it_messages++];
     else return 0;
   }
   bool isOk() const { return err == OK_NO_ERROR; }
   ErrorCode getErr() const { return err; }
 
 private:
-  std::list<Message> messages;
-  std::list<Message>::iterator it_messages;
+  // Messages are kept between packets and rebuilt in place, so once a
+  // reader has seen a packet of a given shape it stops allocating.
+  std::vector<Message> messages;
+  size_t nb_messages = 0, it_messages = 0;
   ErrorCode err;
   
   void parse(const char *beg, const char *end, TimeTag time_tag) {
@@ -554,8 +803,69 @@ private:
         OSCPKT_SET_ERR(INVALID_BUNDLE);
       }
     } else {
-      messages.push_back(Message(beg, end-beg, time_tag));
-      if (!messages.back().isOk()) OSCPKT_SET_ERR(messages.back().getErr());
+      if (nb_messages == messages.size()) messages.push_back(Message());
+      Message &msg = messages[nb_messages++];
+      msg.buildFromRawData(beg, end-beg, time_tag);
+      if (!msg.isOk()) OSCPKT_SET_ERR(msg.getErr());
+    }
+  }
+};
+
+/**
+   PacketReader for MessageViews: the messages reference the packet
+   passed to init() rather than copying it, so the packet has to stay
+   alive and unchanged while they are read. The reader keeps its
+   storage between packets.
+*/
+class PacketViewReader {
+public:
+  PacketViewReader() { err = OK_NO_ERROR; }
+  PacketViewReader(const void *ptr, size_t sz) { init(ptr, sz); }
+
+  void init(const void *ptr, size_t sz) {
+    err = OK_NO_ERROR; nb_messages = 0; it_messages = 0;
+    if ((sz%4) == 0) {
+      parse((const char*)ptr, (const char *)ptr+sz, TimeTag::immediate());
+    } else OSCPKT_SET_ERR(INVALID_PACKET_SIZE);
+  }
+
+  /** extract the next osc message from the packet. return 0 when all messages have been read, or in case of error. */
+  const MessageView *popMessage() {
+    if (!err && it_messages < nb_messages) return &messages[it_messages++];
+    else return 0;
+  }
+  bool isOk() const { return err == OK_NO_ERROR; }
+  ErrorCode getErr() const { return err; }
+
+private:
+  std::vector<MessageView> messages;
+  size_t nb_messages = 0, it_messages = 0;
+  ErrorCode err;
+
+  void parse(const char *beg, const char *end, TimeTag time_tag) {
+    if (beg == end) return;
+    if (*beg == '#') {
+      if (end - beg >= 20
+          && memcmp(beg, "#bundle\0", 8) == 0) {
+        TimeTag time_tag2(bytes2pod<uint64_t>(beg+8));
+        const char *pos = beg + 16;
+        do {
+          uint32_t sz = bytes2pod<uint32_t>(pos); pos += 4;
+          if ((sz&3) != 0 || sz > size_t(end - pos)) {
+            OSCPKT_SET_ERR(INVALID_BUNDLE);
+          } else {
+            parse(pos, pos+sz, time_tag2);
+            pos += sz;
+          }
+        } while (!err && pos != end);
+      } else {
+        OSCPKT_SET_ERR(INVALID_BUNDLE);
+      }
+    } else {
+      if (nb_messages == messages.size()) messages.push_back(MessageView());
+      MessageView &msg = messages[nb_messages++];
+      msg.init(beg, end-beg, time_tag);
+      if (!msg.isOk()) OSCPKT_SET_ERR(msg.getErr());
     }
   }
 };
@@ -55,6 +55,7 @@
 #include <cassert>
 #include <string>
 #include <vector>
+#include <memory>
 #include <iostream>
 
 namespace oscpkt {
@@ -223,47 +224,14 @@ struct UdpSocket {
     buffer.resize(1024*128); 
     
     /* check if something is available */
-    if (timeout_ms >= 0) {
-      struct timeval tv; memset(&tv, 0, sizeof tv);
-      tv.tv_sec=timeout_ms/1000;
-      tv.tv_usec=(timeout_ms%1000) * 1000;
-      
-      //gettimeofday(&tv, 0); //tv.tv_usec += timeout_ms*1000;
-
-      fd_set readset;
-      FD_ZERO(&readset);
-      FD_SET(handle, &readset);
-      //int ret = select( handle+1, &readset, 0, 0, &tv );
-      int ret = select( handle+1, &readset, 0, 0, &tv );
-      if (ret <= 0) { // error, or timeout
-        return false;
-      }
-    }
+    if (!waitForPacket(timeout_ms)) return false;
 
     /* now we should be able to read without blocking.. */
     socklen_t len = (socklen_t)remote_addr.maxLen();
     int nread = (int)recvfrom(handle, &buffer[0], (int)buffer.size(), 0,
                               &remote_addr.addr(), &len);
     if (nread < 0) {       
-      // maybe here we should differentiate EAGAIN/EINTR/EWOULDBLOCK from real errors
-#ifdef WIN32
-      if (WSAGetLastError() != WSAEINTR && WSAGetLastError() != WSAEWOULDBLOCK && 
-          WSAGetLastError() != WSAECONNRESET && WSAGetLastError() != WSAECONNREFUSED) {
-        char s[512]; 
-#ifdef _MSC_VER
-        _snprintf_s(s,512,512, "system error #%d", WSAGetLastError());
-#else
-        snprintf(s,512, "system error #%d", WSAGetLastError());
-#endif
-        setErr(s);
-      }
-#else
-      if (errno != EAGAIN && errno != EINTR && errno != EWOULDBLOCK &&
-          errno != ECONNRESET && errno != ECONNREFUSED) {
-        setErr(strerror(errno));
-      }
-#endif
-      if (!isOk()) close();
+      receiveFailed();
       return false;
     }
     if (nread > (int)buffer.size()) {
@@ -276,6 +244,68 @@ struct UdpSocket {
     return true;
   }
 
+  /** Preallocated slots for receiving several datagrams at once with
+      receiveNextPackets(). Keep one around and reuse it - the slab is
+      only allocated once, and pages of it are only touched as
+      datagrams are written into them. */
+  struct PacketBatch {
+    enum { MAX_PACKETS = 32, MAX_PACKET_SIZE = 65536 };
+    PacketBatch() : slab(new char[MAX_PACKETS * MAX_PACKET_SIZE]), count(0) {}
+
+    /** number of slots filled by the last receive. A truncated
+        datagram leaves its slot with a size of 0. */
+    int packetCount() const { return count; }
+    const char *packetData(int i) const { return slab.get() + (size_t)i * MAX_PACKET_SIZE; }
+    size_t packetSize(int i) const { return sizes[i]; }
+
+    std::unique_ptr<char[]> slab;
+    size_t sizes[MAX_PACKETS];
+    int count;
+  };
+
+  /** wait for datagrams to arrive, then receive as many as are queued
+      (up to PacketBatch::MAX_PACKETS) in one go. On Linux this is a
+      single recvmmsg call, elsewhere one datagram is received per
+      call. Return false in case of failure, or timeout. */
+  bool receiveNextPackets(PacketBatch &batch, int timeout_ms = -1) {
+    batch.count = 0;
+    if (!isOk() || handle == -1) { setErr("not opened.."); return false; }
+    if (!waitForPacket(timeout_ms)) return false;
+
+#if defined(__linux__)
+    struct mmsghdr msgs[PacketBatch::MAX_PACKETS];
+    struct iovec iovs[PacketBatch::MAX_PACKETS];
+    memset(msgs, 0, sizeof msgs);
+    for (int i = 0; i < PacketBatch::MAX_PACKETS; ++i) {
+      iovs[i].iov_base = batch.slab.get() + (size_t)i * PacketBatch::MAX_PACKET_SIZE;
+      iovs[i].iov_len = PacketBatch::MAX_PACKET_SIZE;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    /* block for the first datagram only, then take whatever else is queued */
+    int nread = recvmmsg(handle, msgs, PacketBatch::MAX_PACKETS, MSG_WAITFORONE, 0);
+    if (nread < 0) {
+      receiveFailed();
+      return false;
+    }
+    for (int i = 0; i < nread; ++i) {
+      batch.sizes[i] = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : msgs[i].msg_len;
+    }
+    batch.count = nread;
+#else
+    socklen_t len = (socklen_t)remote_addr.maxLen();
+    int nread = (int)recvfrom(handle, batch.slab.get(), PacketBatch::MAX_PACKET_SIZE, 0,
+                              &remote_addr.addr(), &len);
+    if (nread < 0) {
+      receiveFailed();
+      return false;
+    }
+    batch.sizes[0] = nread > PacketBatch::MAX_PACKET_SIZE ? 0 : nread;
+    batch.count = 1;
+#endif
+    return true;
+  }
+
   void *packetData() { return buffer.empty() ? 0 : &buffer[0]; }
   size_t packetSize() { return buffer.size(); }
   SockAddr &packetOrigin() { return remote_addr; }
@@ -312,6 +342,50 @@ struct UdpSocket {
   }
 
 private:
+  /* wait for the socket to become readable. Return false on error or
+     timeout, or immediately true when timeout_ms is -1 */
+  bool waitForPacket(int timeout_ms) {
+    if (timeout_ms >= 0) {
+      struct timeval tv; memset(&tv, 0, sizeof tv);
+      tv.tv_sec=timeout_ms/1000;
+      tv.tv_usec=(timeout_ms%1000) * 1000;
+      
+      //gettimeofday(&tv, 0); //tv.tv_usec += timeout_ms*1000;
+
+      fd_set readset;
+      FD_ZERO(&readset);
+      FD_SET(handle, &readset);
+      //int ret = select( handle+1, &readset, 0, 0, &tv );
+      int ret = select( handle+1, &readset, 0, 0, &tv );
+      if (ret <= 0) { // error, or timeout
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void receiveFailed() {
+    // maybe here we should differentiate EAGAIN/EINTR/EWOULDBLOCK from real errors
+#ifdef WIN32
+    if (WSAGetLastError() != WSAEINTR && WSAGetLastError() != WSAEWOULDBLOCK && 
+        WSAGetLastError() != WSAECONNRESET && WSAGetLastError() != WSAECONNREFUSED) {
+      char s[512]; 
+#ifdef _MSC_VER
+      _snprintf_s(s,512,512, "system error #%d", WSAGetLastError());
+#else
+      snprintf(s,512, "system error #%d", WSAGetLastError());
+#endif
+      setErr(s);
+    }
+#else
+    if (errno != EAGAIN && errno != EINTR && errno != EWOULDBLOCK &&
+        errno != ECONNRESET && errno != ECONNREFUSED) {
+      setErr(strerror(errno));
+    }
+#endif
+    if (!isOk()) close();
+  }
+
   bool openSocket(const std::string &hostname, int port, int options) {
     char port_string[64]; 
 #ifdef _MSC_VER
@@ -1,9 +1,699 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "api/api.h"
+#include "api/osc/oscpkt.hh"
+#include "api/osc/udp.hh"
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
 namespace SonicPi {
 namespace API {
 
-bool Start()
+namespace {
+
+const int PingIntervalMs = 250;
+const int ReceiveTimeoutMs = 30;
+
+bool FileExists(const std::string& path)
+{
+#if defined(_WIN32)
+    return GetFileAttributesA(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+#endif
+}
+
+void MakeDir(const std::string& path)
+{
+#if defined(_WIN32)
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+std::string HomePath()
+{
+    const char* home = std::getenv("SONIC_PI_HOME");
+    if (!home || !*home)
+    {
+#if defined(_WIN32)
+        home = std::getenv("USERPROFILE");
+#else
+        home = std::getenv("HOME");
+#endif
+    }
+    return home ? home : ".";
+}
+
+std::string GenerateClientId()
+{
+    std::random_device rd;
+    std::mt19937_64 gen(rd());
+    std::ostringstream id;
+    id << std::hex << gen();
+    return "api-" + id.str();
+}
+
+} // namespace
+
+// The server and its log files, with just enough process control to
+// launch it and make sure it's gone when we shut down.
+struct Client::Process
+{
+#if defined(_WIN32)
+    HANDLE handle = NULL;
+
+    ~Process()
+    {
+        if (handle)
+        {
+            CloseHandle(handle);
+        }
+    }
+
+    bool Start(const std::string& program, const std::vector<std::string>& args, const std::string& outLog, const std::string& errLog)
+    {
+        std::string cmd = "\"" + program + "\"";
+        for (auto& arg : args)
+        {
+            cmd += " \"" + arg + "\"";
+        }
+
+        SECURITY_ATTRIBUTES sa = { sizeof(sa), NULL, TRUE };
+        HANDLE out = CreateFileA(outLog.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &sa, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        HANDLE err = CreateFileA(errLog.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &sa, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+        STARTUPINFOA si = {};
+        si.cb = sizeof(si);
+        si.dwFlags = STARTF_USESTDHANDLES;
+        si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+        si.hStdOutput = out;
+        si.hStdError = err;
+
+        PROCESS_INFORMATION pi = {};
+        BOOL ok = CreateProcessA(NULL, &cmd[0], NULL, NULL, TRUE, CREATE_NO_WINDOW | ABOVE_NORMAL_PRIORITY_CLASS, NULL, NULL, &si, &pi);
+
+        if (out != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(out);
+        }
+        if (err != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(err);
+        }
+        if (!ok)
+        {
+            return false;
+        }
+        CloseHandle(pi.hThread);
+        handle = pi.hProcess;
+        return true;
+    }
+
+    long long Pid() const
+    {
+        return handle ? (long long)GetProcessId(handle) : 0;
+    }
+
+    bool IsRunning()
+    {
+        return handle && WaitForSingleObject(handle, 0) == WAIT_TIMEOUT;
+    }
+
+    void Terminate()
+    {
+        if (handle)
+        {
+            TerminateProcess(handle, 1);
+        }
+    }
+
+    void Kill()
+    {
+        Terminate();
+    }
+#else
+    pid_t pid = 0;
+    bool reaped = false;
+
+    bool Start(const std::string& program, const std::vector<std::string>& args, const std::string& outLog, const std::string& errLog)
+    {
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(program.c_str()));
+        for (auto& arg : args)
+        {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        if (!outLog.empty())
+        {
+            posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, outLog.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        if (!errLog.empty())
+        {
+            posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, errLog.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        int err = posix_spawnp(&pid, program.c_str(), &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if (err != 0)
+        {
+            pid = 0;
+            return false;
+        }
+        return true;
+    }
+
+    long long Pid() const
+    {
+        return pid;
+    }
+
+    bool IsRunning()
+    {
+        if (pid <= 0 || reaped)
+        {
+            return false;
+        }
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == 0)
+        {
+            return true;
+        }
+        reaped = true;
+        return false;
+    }
+
+    void Terminate()
+    {
+        if (IsRunning())
+        {
+            kill(pid, SIGTERM);
+        }
+    }
+
+    void Kill()
+    {
+        if (IsRunning())
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            reaped = true;
+        }
+    }
+#endif
+
+    bool WaitForExit(int timeoutMs)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (IsRunning())
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return true;
+    }
+};
+
+bool PortAvailable(int port)
+{
+    if (port < 1024)
+    {
+        return false;
+    }
+    oscpkt::UdpSocket sock;
+    sock.bindTo(port);
+    bool available = sock.isOk();
+    sock.close();
+    return available;
+}
+
+std::map<std::string, int> DiscoverPorts()
+{
+    int lastFreePort = 51234;
+
+    auto findFreePort = [&lastFreePort]() {
+        while (++lastFreePort <= 65535)
+        {
+            if (PortAvailable(lastFreePort))
+            {
+                return lastFreePort;
+            }
+        }
+        return -1;
+    };
+
+    std::map<std::string, int> ports;
+    ports["server-listen-to-gui"] = findFreePort();
+    ports["gui-send-to-server"] = ports["server-listen-to-gui"];
+    ports["gui-listen-to-server"] = findFreePort();
+    ports["server-send-to-gui"] = ports["gui-listen-to-server"];
+    ports["scsynth"] = findFreePort();
+    ports["scsynth-send"] = ports["scsynth"];
+    ports["server-osc-cues"] = PortAvailable(4560) ? 4560 : findFreePort();
+    ports["erlang-router"] = findFreePort();
+    ports["websocket"] = findFreePort();
+    return ports;
+}
+
+Client::Client(const Callbacks& callbacks)
+    : m_callbacks(callbacks)
+    , m_clientId(GenerateClientId())
+    , m_stopping(false)
+{
+}
+
+Client::~Client()
+{
+    Shutdown();
+}
+
+std::future<bool> Client::Boot(const BootOptions& options)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        if (m_state != State::Stopped)
+        {
+            std::promise<bool> alreadyBooted;
+            alreadyBooted.set_value(false);
+            return alreadyBooted.get_future();
+        }
+        m_state = State::Booting;
+    }
+
+    m_booted = std::promise<bool>();
+    auto result = m_booted.get_future();
+    m_bootThread = std::thread([this, options]() {
+        bool ok = BootServer(options);
+        if (!ok)
+        {
+            SetState(State::Failed);
+        }
+        m_booted.set_value(ok);
+    });
+    return result;
+}
+
+bool Client::BootServer(const BootOptions& options)
 {
-    return true;
+    std::string rubyPath = options.rubyPath;
+    if (rubyPath.empty())
+    {
+#if defined(_WIN32)
+        rubyPath = options.rootPath + "/app/server/native/ruby/bin/ruby.exe";
+#else
+        rubyPath = options.rootPath + "/app/server/native/ruby/bin/ruby";
+#endif
+        if (!FileExists(rubyPath))
+        {
+            // fallback to user's locally installed ruby
+            rubyPath = "ruby";
+        }
+    }
+
+    std::string serverPath = options.rootPath + "/app/server/ruby/bin/sonic-pi-server.rb";
+    if (!FileExists(serverPath))
+    {
+        std::cerr << "[API] - Sonic Pi server not found at " << serverPath << std::endl;
+        return false;
+    }
+
+    std::string userPath = (options.homePath.empty() ? HomePath() : options.homePath) + "/.sonic-pi";
+    std::string logPath = userPath + "/log";
+    MakeDir(userPath);
+    MakeDir(logPath);
+
+    auto ports = DiscoverPorts();
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_ports = ports;
+    }
+
+    m_listenSocket.reset(new oscpkt::UdpSocket());
+    m_listenSocket->bindTo(ports["gui-listen-to-server"]);
+    if (!m_listenSocket->isOk())
+    {
+        std::cerr << "[API] - unable to listen on port " << ports["gui-listen-to-server"] << ": " << m_listenSocket->errorMessage() << std::endl;
+        return false;
+    }
+
+    m_sendSocket.reset(new oscpkt::UdpSocket());
+    m_sendSocket->connectTo("127.0.0.1", ports["gui-send-to-server"]);
+    if (!m_sendSocket->isOk())
+    {
+        std::cerr << "[API] - unable to connect to port " << ports["gui-send-to-server"] << ": " << m_sendSocket->errorMessage() << std::endl;
+        return false;
+    }
+
+    m_receiveThread = std::thread([this]() { ReceiveLoop(); });
+
+    std::vector<std::string> args = {
+        "--enable-frozen-string-literal", "-E", "utf-8",
+        serverPath, "-u",
+        std::to_string(ports["server-listen-to-gui"]),
+        std::to_string(ports["server-send-to-gui"]),
+        std::to_string(ports["scsynth"]),
+        std::to_string(ports["scsynth-send"]),
+        std::to_string(ports["server-osc-cues"]),
+        std::to_string(ports["erlang-router"]),
+        std::to_string(ports["websocket"])
+    };
+
+    m_server.reset(new Process());
+    if (!m_server->Start(rubyPath, args, logPath + "/server-output.log", logPath + "/server-errors.log"))
+    {
+        std::cerr << "[API] - the Sonic Pi server could not be started with " << rubyPath << std::endl;
+        return false;
+    }
+
+    // Register server pid for potential zombie clearing. This is only
+    // needed after a crash, so don't wait on it unless the boot is over.
+    Process registration;
+    registration.Start(rubyPath, { options.rootPath + "/app/server/ruby/bin/task-register.rb", std::to_string(m_server->Pid()) }, "", "");
+
+    // The server sends /booted as soon as it's ready. Keep pinging in case
+    // that went missing - the /ack reply counts just the same.
+    oscpkt::Message ping("/ping");
+    ping.pushStr(m_clientId);
+    ping.pushStr("APIClient/1/hello");
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.timeoutMs);
+    bool booted = false;
+    while (!m_stopping && std::chrono::steady_clock::now() < deadline && m_server->IsRunning())
+    {
+        Send(ping);
+
+        std::unique_lock<std::mutex> lock(m_stateMutex);
+        m_stateChanged.wait_for(lock, std::chrono::milliseconds(PingIntervalMs), [this]() { return m_state != State::Booting; });
+        if (m_state != State::Booting)
+        {
+            booted = m_state == State::Booted;
+            break;
+        }
+    }
+
+    registration.WaitForExit(options.timeoutMs);
+
+    if (!booted)
+    {
+        std::cerr << "[API] - could not connect to the Sonic Pi server" << std::endl;
+        m_server->Kill();
+    }
+    return booted;
+}
+
+bool Client::IsBooted() const
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    return m_state == State::Booted;
+}
+
+bool Client::RunCode(const std::string& code)
+{
+    oscpkt::Message msg("/run-code");
+    msg.pushStr(m_clientId);
+    msg.pushStr(code);
+    return Send(msg);
+}
+
+bool Client::SaveAndRunBuffer(const std::string& bufferId, const std::string& code)
+{
+    oscpkt::Message msg("/save-and-run-buffer");
+    msg.pushStr(m_clientId);
+    msg.pushStr(bufferId);
+    msg.pushStr(code);
+    msg.pushStr(bufferId);
+    return Send(msg);
+}
+
+bool Client::StopAll()
+{
+    oscpkt::Message msg("/stop-all-jobs");
+    msg.pushStr(m_clientId);
+    return Send(msg);
+}
+
+bool Client::Send(const oscpkt::Message& msg)
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    if (!m_sendSocket || !m_sendSocket->isOk())
+    {
+        return false;
+    }
+    oscpkt::PacketWriter pw;
+    pw.addMessage(msg);
+    return m_sendSocket->sendPacket(pw.packetData(), pw.packetSize());
+}
+
+bool Client::Shutdown(int timeoutMs)
+{
+    // Cancel a boot that's still in progress - the boot thread kills the
+    // server when it gives up
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        if (m_state == State::Booting)
+        {
+            m_stopping = true;
+        }
+    }
+    if (m_bootThread.joinable())
+    {
+        m_bootThread.join();
+    }
+
+    bool clean = false;
+    if (m_server && m_server->IsRunning())
+    {
+        oscpkt::Message msg("/exit");
+        msg.pushStr(m_clientId);
+        Send(msg);
+
+        // /exited is sent just before the server goes, so wait for the
+        // process itself rather than the message
+        clean = m_server->WaitForExit(timeoutMs);
+        if (!clean)
+        {
+            std::cerr << "[API] - server didn't exit, killing it" << std::endl;
+            m_server->Terminate();
+            if (!m_server->WaitForExit(1000))
+            {
+                m_server->Kill();
+            }
+        }
+    }
+
+    StopThreads();
+    SetState(State::Stopped);
+    return clean;
+}
+
+const std::string& Client::ClientId() const
+{
+    return m_clientId;
+}
+
+std::map<std::string, int> Client::Ports() const
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    return m_ports;
+}
+
+void Client::SetState(State state)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_state = state;
+    }
+    m_stateChanged.notify_all();
+}
+
+void Client::StopThreads()
+{
+    m_stopping = true;
+    if (m_bootThread.joinable())
+    {
+        m_bootThread.join();
+    }
+    if (m_receiveThread.joinable())
+    {
+        m_receiveThread.join();
+    }
+    m_listenSocket.reset();
+    {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        m_sendSocket.reset();
+    }
+    m_stopping = false;
+}
+
+void Client::ReceiveLoop()
+{
+    // Log bursts arrive as many small datagrams, so drain everything
+    // that's queued with each receive
+    oscpkt::UdpSocket::PacketBatch batch;
+    while (!m_stopping && m_listenSocket->isOk())
+    {
+        if (m_listenSocket->receiveNextPackets(batch, ReceiveTimeoutMs))
+        {
+            for (int i = 0; i < batch.packetCount(); i++)
+            {
+                if (batch.packetSize(i) > 0)
+                {
+                    Dispatch(batch.packetData(i), batch.packetSize(i));
+                }
+            }
+        }
+    }
+}
+
+void Client::Dispatch(const char* data, size_t size)
+{
+    oscpkt::PacketReader pr(data, size);
+    oscpkt::Message* msg;
+    while (pr.isOk() && (msg = pr.popMessage()) != 0)
+    {
+        if (msg->match("/log/multi_message"))
+        {
+            MultiLog ml;
+            int32_t count;
+            auto ar = msg->arg();
+            ar.popInt32(ml.jobId).popStr(ml.threadName).popStr(ml.runtime).popInt32(count);
+            for (int32_t i = 0; ar.isOk() && i < count; i++)
+            {
+                LogMessage message;
+                ar.popInt32(message.type).popStr(message.text);
+                ml.messages.push_back(message);
+            }
+            if (ar.isOkNoMoreArgs())
+            {
+                if (m_callbacks.log)
+                {
+                    m_callbacks.log(ml);
+                }
+                continue;
+            }
+        }
+        else if (msg->match("/incoming/osc"))
+        {
+            CueInfo cue;
+            if (msg->arg().popStr(cue.time).popInt32(cue.id).popStr(cue.address).popStr(cue.arguments).isOkNoMoreArgs())
+            {
+                if (m_callbacks.cue)
+                {
+                    m_callbacks.cue(cue);
+                }
+                continue;
+            }
+        }
+        else if (msg->match("/log/info"))
+        {
+            InfoMessage info;
+            if (msg->arg().popInt32(info.style).popStr(info.text).isOkNoMoreArgs())
+            {
+                if (m_callbacks.info)
+                {
+                    m_callbacks.info(info);
+                }
+                continue;
+            }
+        }
+        else if (msg->match("/error"))
+        {
+            RuntimeError err;
+            if (msg->arg().popInt32(err.jobId).popStr(err.description).popStr(err.backtrace).popInt32(err.line).isOkNoMoreArgs())
+            {
+                if (m_callbacks.runtimeError)
+                {
+                    m_callbacks.runtimeError(err);
+                }
+                continue;
+            }
+        }
+        else if (msg->match("/syntax_error"))
+        {
+            SyntaxError err;
+            if (msg->arg().popInt32(err.jobId).popStr(err.description).popStr(err.errorLine).popInt32(err.line).popStr(err.lineNumber).isOkNoMoreArgs())
+            {
+                if (m_callbacks.syntaxError)
+                {
+                    m_callbacks.syntaxError(err);
+                }
+                continue;
+            }
+        }
+        else if (msg->match("/runs/all-completed"))
+        {
+            if (msg->arg().isOkNoMoreArgs())
+            {
+                if (m_callbacks.allJobsCompleted)
+                {
+                    m_callbacks.allJobsCompleted();
+                }
+                continue;
+            }
+        }
+        else if (msg->match("/booted") || msg->match("/ack"))
+        {
+            std::unique_lock<std::mutex> lock(m_stateMutex);
+            if (m_state == State::Booting)
+            {
+                m_state = State::Booted;
+                lock.unlock();
+                m_stateChanged.notify_all();
+            }
+            continue;
+        }
+        else if (msg->match("/exited-with-boot-error"))
+        {
+            std::string error;
+            if (msg->arg().popStr(error).isOkNoMoreArgs())
+            {
+                std::cerr << "[API] - Sonic Pi server failed to start: " << error << std::endl;
+                SetState(State::Failed);
+                if (m_callbacks.bootError)
+                {
+                    m_callbacks.bootError(error);
+                }
+                continue;
+            }
+        }
+        else if (msg->match("/exited"))
+        {
+            SetState(State::Exited);
+            if (m_callbacks.exited)
+            {
+                m_callbacks.exited();
+            }
+            continue;
+        }
+
+        if (m_callbacks.unhandled)
+        {
+            m_callbacks.unhandled(*msg);
+        }
+    }
 }
 
 } // API
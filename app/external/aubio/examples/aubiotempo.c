@@ -0,0 +1,224 @@
+/*
+  Copyright (C) 2003-2013 Paul Brossier <piem@aubio.org>
+
+  This file is part of aubio.
+
+  aubio is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  aubio is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+  Beat grid analysis for Sonic Pi's sample tempo detection.
+
+  Reads the source once, tracking beats and collecting the tempo estimate
+  and confidence at each detected beat alongside the level of every block.
+  When the file has been consumed a summary is printed in the following
+  form:
+
+    <bpm> <confidence> <downbeat index>
+    <beat time>
+    <beat time>
+    ...
+
+  The bpm is the median of the per-beat tempo estimates, the confidence is
+  the mean of the per-beat confidences, and the downbeat index is the index
+  of the first beat in the bar phase (assuming 4 beats per bar) with the
+  highest mean level. Bar phases are taken from each beat's position on the
+  grid implied by the bpm so that dropped beats don't shift the phase.
+
+*/
+
+#include "utils.h"
+#define PROG_HAS_TEMPO 1
+#define PROG_HAS_ONSET 1
+#define PROG_HAS_SILENCE 1
+#include "parse_args.h"
+
+#define BEATS_PER_BAR 4
+
+aubio_tempo_t * tempo;
+fvec_t * tempo_out;
+
+uint_t num_beats = 0;
+uint_t max_beats = 0;
+uint_t * beat_times = NULL;
+smpl_t * beat_bpms = NULL;
+smpl_t * beat_confidences = NULL;
+
+uint_t num_levels = 0;
+uint_t max_levels = 0;
+smpl_t * block_levels = NULL;
+
+static int beats_grow (void)
+{
+  uint_t new_max = max_beats ? max_beats * 2 : 256;
+  uint_t * times = realloc (beat_times, new_max * sizeof(uint_t));
+  if (times == NULL) return 1;
+  beat_times = times;
+  smpl_t * bpms = realloc (beat_bpms, new_max * sizeof(smpl_t));
+  if (bpms == NULL) return 1;
+  beat_bpms = bpms;
+  smpl_t * confidences = realloc (beat_confidences, new_max * sizeof(smpl_t));
+  if (confidences == NULL) return 1;
+  beat_confidences = confidences;
+  max_beats = new_max;
+  return 0;
+}
+
+static int levels_grow (void)
+{
+  uint_t new_max = max_levels ? max_levels * 2 : 4096;
+  smpl_t * levels = realloc (block_levels, new_max * sizeof(smpl_t));
+  if (levels == NULL) return 1;
+  block_levels = levels;
+  max_levels = new_max;
+  return 0;
+}
+
+void process_block(fvec_t * ibuf, fvec_t *obuf) {
+  aubio_tempo_do (tempo, ibuf, tempo_out);
+  if (num_levels < max_levels || !levels_grow ()) {
+    block_levels[num_levels++] = aubio_level_lin (ibuf);
+  }
+  if (!fvec_get_sample (tempo_out, 0)) return;
+  if (silence_threshold != -90. && aubio_silence_detection(ibuf, silence_threshold)) return;
+  if (num_beats == max_beats && beats_grow ()) return;
+  beat_times[num_beats] = aubio_tempo_get_last (tempo);
+  beat_bpms[num_beats] = aubio_tempo_get_bpm (tempo);
+  beat_confidences[num_beats] = aubio_tempo_get_confidence (tempo);
+  num_beats++;
+}
+
+void process_print (void) {
+  // Results are only known once the whole file has been read, see
+  // print_summary.
+}
+
+static int compare_smpl (const void * a, const void * b)
+{
+  smpl_t x = *(const smpl_t *)a;
+  smpl_t y = *(const smpl_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Peak block level in the hop either side of the given position
+static smpl_t level_at (uint_t time_in_samples)
+{
+  uint_t block = time_in_samples / hop_size, i;
+  uint_t first = block > 0 ? block - 1 : 0;
+  smpl_t level = 0.;
+  for (i = first; i <= block + 1 && i < num_levels; i++) {
+    if (block_levels[i] > level) level = block_levels[i];
+  }
+  return level;
+}
+
+// Position within the bar of a beat, counted in grid periods from the first
+// beat. Falls back to the beat index when no tempo could be estimated.
+static uint_t grid_phase (uint_t time_in_samples, uint_t first_beat,
+    smpl_t period, uint_t index)
+{
+  if (period <= 0.) return index % BEATS_PER_BAR;
+  return (uint_t)floor((time_in_samples - first_beat) / period + .5) % BEATS_PER_BAR;
+}
+
+static void print_summary (void)
+{
+  smpl_t bpm = 0., confidence = 0.;
+  uint_t downbeat = 0, best_phase = 0, i, n = 0;
+  smpl_t phase_levels[BEATS_PER_BAR] = { 0. };
+  uint_t phase_counts[BEATS_PER_BAR] = { 0 };
+  smpl_t best_level = -1.;
+  smpl_t period = 0.;
+
+  if (num_beats > 0) {
+    // median of the non-zero tempo estimates, in place
+    for (i = 0; i < num_beats; i++) {
+      if (beat_bpms[i] > 0.) beat_bpms[n++] = beat_bpms[i];
+      confidence += beat_confidences[i];
+    }
+    confidence /= num_beats;
+    if (n > 0) {
+      qsort (beat_bpms, n, sizeof(smpl_t), compare_smpl);
+      bpm = (n % 2) ? beat_bpms[n / 2]
+        : 0.5 * (beat_bpms[n / 2 - 1] + beat_bpms[n / 2]);
+    }
+
+    if (bpm > 0.) period = 60. * samplerate / bpm;
+
+    for (i = 0; i < num_beats; i++) {
+      uint_t phase = grid_phase (beat_times[i], beat_times[0], period, i);
+      phase_levels[phase] += level_at (beat_times[i]);
+      phase_counts[phase]++;
+    }
+    for (i = 0; i < BEATS_PER_BAR; i++) {
+      smpl_t level;
+      if (phase_counts[i] == 0) continue;
+      level = phase_levels[i] / phase_counts[i];
+      if (level > best_level) {
+        best_level = level;
+        best_phase = i;
+      }
+    }
+    for (i = 0; i < num_beats; i++) {
+      if (grid_phase (beat_times[i], beat_times[0], period, i) == best_phase) {
+        downbeat = i;
+        break;
+      }
+    }
+  }
+
+  outmsg ("%f %f %d\n", bpm, confidence, downbeat);
+  for (i = 0; i < num_beats; i++) {
+    print_time (beat_times[i]);
+    outmsg ("\n");
+  }
+}
+
+int main(int argc, char **argv) {
+  int ret = 0;
+  // override general settings from utils.c
+  buffer_size = 1024;
+  hop_size = 512;
+
+  examples_common_init(argc,argv);
+
+  verbmsg ("using source: %s at %dHz\n", source_uri, samplerate);
+
+  verbmsg ("tempo method: %s, ", tempo_method);
+  verbmsg ("buffer_size: %d, ", buffer_size);
+  verbmsg ("hop_size: %d, ", hop_size);
+  verbmsg ("threshold: %f\n", onset_threshold);
+
+  tempo_out = new_fvec(2);
+  tempo = new_aubio_tempo(tempo_method, buffer_size, hop_size, samplerate);
+  if (tempo == NULL) { ret = 1; goto beach; }
+  if (onset_threshold != 0.) aubio_tempo_set_threshold (tempo, onset_threshold);
+
+  examples_common_process(process_block, process_print);
+
+  if (!quiet) print_summary ();
+
+  del_aubio_tempo(tempo);
+  del_fvec(tempo_out);
+  free (beat_times);
+  free (beat_bpms);
+  free (beat_confidences);
+  free (block_levels);
+
+beach:
+  examples_common_del();
+  return ret;
+}
@@ -12,6 +12,8 @@ cmake -DERLANG_INCLUDE_PATH=${ERLANG_INCLUDE_PATH} -G "Unix Makefiles" ..
 
 echo "Building sp_midi..."
 cmake --build . --target sp_midi
+echo "Building sp_osc..."
+cmake --build . --target sp_osc
 cmake --build . --target aubio
 
 cd "${SCRIPT_DIR}"
@@ -11,6 +11,8 @@ cmake -G "Unix Makefiles" -D ERLANG_INCLUDE_PATH="${SCRIPT_DIR}/../../prebuilt/m
 
 echo "Building sp_midi..."
 cmake  --build . --target sp_midi
+echo "Building sp_osc..."
+cmake --build . --target sp_osc
 echo "Building aubio onset..."
 cmake --build . --target aubio
 
@@ -27,6 +27,7 @@
 #include "midiin.h"
 #include "midisendprocessor.h"
 #include "midi_port_info.h"
+#include "profiler.h"
 
 extern std::atomic<bool> g_threadsShouldFinish;
 
@@ -52,12 +53,14 @@ public:
 
     void run()
     {
+        SP_SetThreadName("MIDI hotplug");
         std::vector<MidiPortInfo> lastAvailableInputPorts = MidiIn::getInputPortInfo();
         std::vector<MidiPortInfo> lastAvailableOutputPorts = MidiOut::getOutputPortInfo();
 
         while (!g_threadsShouldFinish){
 
             std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            SP_ZoneScopedN("HotPlugThread poll");
 
             auto newAvailableInputPorts = MidiIn::getInputPortInfo();
             // Was something added or removed?
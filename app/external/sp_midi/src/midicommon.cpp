@@ -42,7 +42,7 @@ string MidiCommon::getPortName() const
     return m_portName;
 }
 
-string MidiCommon::getNormalizedPortName() const
+const string& MidiCommon::getNormalizedPortName() const
 {
     return m_normalizedPortName;
 }
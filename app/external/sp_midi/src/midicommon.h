@@ -42,7 +42,7 @@ public:
     virtual ~MidiCommon();
 
     std::string getPortName() const;
-    std::string getNormalizedPortName() const;
+    const std::string& getNormalizedPortName() const;
     int getPortId() const;
 
     static int getRtMidiIdFromName(const std::string& portName);
@@ -25,6 +25,8 @@
 #include "midiin.h"
 #include "utils.h"
 #include "midi_port_info.h"
+#include "api/metrics.h"
+#include "api/arena.h"
 
 using namespace std;
 
@@ -83,13 +85,32 @@ void MidiIn::staticMidiCallback(double timeStamp, std::vector< unsigned char > *
 
 void MidiIn::midiCallback(double timeStamp, std::vector< unsigned char > *midiMessage)
 {
-    lock_guard<mutex> lock(m_cb_mutex);
-    m_logger.info("received MIDI message: ");
-    for (int i = 0; i < midiMessage->size(); i++) {
-        m_logger.info("   [{:02x}]", (*midiMessage)[i]);
+    SP_ZoneScopedN("MidiIn::midiCallback");
+    // RtMidi's time stamp is the time since the previous message on this port
+    SP_Plot("MIDI in interval (ms)", timeStamp * 1000.0);
+    static auto& received = SonicPi::Metrics::GetCounter("in.messages");
+    static auto& undelivered = SonicPi::Metrics::GetCounter("in.undelivered");
+    lock_guard<SP_LockableBase(mutex)> lock(m_cb_mutex);
+    SonicPi::Memory::RealtimeScope realtime;
+    received.Add();
+    {
+        // Logging is a debugging aid, not held to the MIDI thread's rules
+        SonicPi::Memory::AllowAllocations allow;
+        m_logger.info("received MIDI message: ");
+        for (int i = 0; i < midiMessage->size(); i++) {
+            m_logger.info("   [{:02x}]", (*midiMessage)[i]);
+        }
+    }
+    // And send the message to the erlang process. The port name is a
+    // reference to our own copy, but building the message env allocates
+    int delivered;
+    {
+        SonicPi::Memory::AllowAllocations allow;
+        delivered = send_midi_data_to_erlang(getNormalizedPortName().c_str(), midiMessage->data(), midiMessage->size());
+    }
+    if (!delivered) {
+        undelivered.Add();
     }
-    // And send the message to the erlang process
-    send_midi_data_to_erlang(getNormalizedPortName().c_str(), midiMessage->data(), midiMessage->size());
 }
 
 vector<MidiPortInfo> MidiIn::getInputPortInfo()
@@ -27,6 +27,7 @@
 #include <rtmidi/RtMidi.h>
 #include "midicommon.h"
 #include "midi_port_info.h"
+#include "profiler.h"
 
 // This class manages a MIDI input device as seen by JUCE
 class MidiIn : public MidiCommon {
@@ -43,7 +44,7 @@ public:
 protected:
 
     std::unique_ptr<RtMidiIn> m_midiIn;
-    std::mutex m_cb_mutex;
+    SP_Lockable(std::mutex, m_cb_mutex);
     static void staticMidiCallback(double timeStamp, std::vector< unsigned char > *message, void *userData);
     void midiCallback(double timeStamp, std::vector< unsigned char > *message);
 
@@ -23,6 +23,7 @@
 #include <iostream>
 #include "midiout.h"
 #include "utils.h"
+#include "api/arena.h"
 
 using namespace std;
 
@@ -53,13 +54,17 @@ MidiOut::~MidiOut()
     m_midiOut->closePort();
 }
 
-void MidiOut::send(const std::vector< unsigned char >* msg)
+void MidiOut::send(const unsigned char* msg, std::size_t size)
 {
-    m_logger.info("Sending MIDI to: {} ->", m_portName);
-    for (int i = 0; i < msg->size(); i++) {
-        m_logger.info("   [{:02x}]", (*msg)[i]);
+    {
+        // Logging is a debugging aid, not held to the send thread's rules
+        SonicPi::Memory::AllowAllocations allow;
+        m_logger.info("Sending MIDI to: {} ->", m_portName);
+        for (std::size_t i = 0; i < size; i++) {
+            m_logger.info("   [{:02x}]", msg[i]);
+        }
     }
-    m_midiOut->sendMessage(msg);
+    m_midiOut->sendMessage(msg, size);
 }
 
 vector<MidiPortInfo> MidiOut::getOutputPortInfo()
@@ -38,7 +38,7 @@ public:
 
     ~MidiOut();
 
-    void send(const std::vector< unsigned char >* msg);
+    void send(const unsigned char* msg, std::size_t size);
 
     static std::vector<std::string> getNormalizedOutputNames();
     static std::vector<MidiPortInfo> getOutputPortInfo();
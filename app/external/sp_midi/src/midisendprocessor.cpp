@@ -28,6 +28,14 @@
 using namespace std;
 using namespace moodycamel;
 
+// Plenty for the queue's blocks plus a backlog of several thousand
+// messages. Never destroyed, as the send thread may still be draining
+// the queue at exit.
+SonicPi::Memory::Arena& MidiSendProcessor::arena()
+{
+    static SonicPi::Memory::Arena* arena = new SonicPi::Memory::Arena(2 * 1024 * 1024);
+    return *arena;
+}
 
 void MidiSendProcessor::startThread()
 {
@@ -63,10 +71,25 @@ void print_time_stamp(char type);
 
 bool MidiSendProcessor::addMessage(const char* device_name, const unsigned char* c_message, std::size_t size)
 {
-    vector<unsigned char> midi_data;
-    midi_data.assign(c_message, c_message + size);
-    MidiDeviceAndMessage msg{ device_name, midi_data };
-    m_messages.enqueue(std::move(msg));
+    try {
+        MidiDeviceAndMessage msg;
+        msg.device_name.assign(device_name);
+        msg.midi.assign(c_message, c_message + size);
+        msg.enqueued = std::chrono::steady_clock::now();
+        if (!m_messages.enqueue(std::move(msg))) {
+            throw std::bad_alloc();
+        }
+    }
+    catch (const std::bad_alloc&) {
+        // The send thread has fallen a long way behind. Drop the message
+        // rather than fall back to the heap.
+        m_errors.Add();
+        m_logger.error("MIDI send queue is full, dropping message for {}", device_name);
+        return false;
+    }
+    m_queued.Add();
+    m_queueDepth.Set((int64_t)m_messages.size_approx());
+    m_arenaUsed.Set((int64_t)arena().Used());
     return true;
 }
 
@@ -77,18 +100,31 @@ void MidiSendProcessor::flushMessages()
     MidiDeviceAndMessage msg;
     while (m_messages.try_dequeue(msg)) {
         // Just discard the message
+        m_flushed.Add();
     }
+    m_queueDepth.Set(0);
     m_flushing = false;
 }
 
 
 void MidiSendProcessor::run()
 {
+    SP_SetThreadName("MIDI send");
     MidiDeviceAndMessage msg;
     while (!g_threadsShouldFinish){
         bool available = m_messages.wait_dequeue_timed(msg, std::chrono::milliseconds(500));
         if (available && !m_flushing){
+            SP_ZoneScopedN("MidiSendProcessor::processMessage");
+            SonicPi::Memory::RealtimeScope realtime;
+            int64_t depth = (int64_t)m_messages.size_approx();
+            double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - msg.enqueued).count();
+            SP_Plot("MIDI send queue depth", depth);
+            SP_Plot("MIDI send latency (ms)", latency);
+            m_queueDepth.Set(depth);
+            m_arenaUsed.Set((int64_t)arena().Used());
+            m_latency.Record(latency);
             processMessage(msg);
+            m_sent.Add();
         }
     }
 }
@@ -98,31 +134,35 @@ void MidiSendProcessor::processMessage(const MidiDeviceAndMessage& message_from_
 {
     try{
         //print_time_stamp('B');
-        send(message_from_c.device_name, &message_from_c.midi);
+        send(message_from_c.device_name, message_from_c.midi.data(), message_from_c.midi.size());
     }
     catch (const std::exception& e){
+        SonicPi::Memory::AllowAllocations allow;
+        m_errors.Add();
         m_logger.error("Exception thrown in MidiSendProcessor::ProcessMessage: {}!!!", e.what());
     }
 }
 
 
-void MidiSendProcessor::send(const string& outDevice, const std::vector< unsigned char >* msg)
+void MidiSendProcessor::send(const SonicPi::Memory::ArenaString& outDevice, const unsigned char* msg, std::size_t size)
 {
     if (outDevice == "*") {
         // send to every known midi device
         for (auto& output : m_outputs) {
-            output->send(msg);
+            output->send(msg, size);
         }
     } else {
         // send to the specified midi device
         // Look for it
         for (auto& output : m_outputs) {
-            if (output->getNormalizedPortName() == outDevice) {
-                output->send(msg);
+            if (output->getNormalizedPortName() == outDevice.c_str()) {
+                output->send(msg, size);
                 return;
             }
         }
-        m_logger.error("Could not find the specified MIDI device: {}", outDevice);
+        SonicPi::Memory::AllowAllocations allow;
+        m_errors.Add();
+        m_logger.error("Could not find the specified MIDI device: {}", outDevice.c_str());
     }
 }
 
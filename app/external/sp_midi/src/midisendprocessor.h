@@ -24,24 +24,45 @@
 #include <memory.h>
 #include <vector>
 #include <string>
+#include <chrono>
 #include <thread>
 #include <mutex>
 #include "blockingconcurrentqueue.h"
 #include "midiout.h"
 #include "monitorlogger.h"
+#include "profiler.h"
+#include "api/metrics.h"
+#include "api/arena.h"
 
 extern std::atomic<bool> g_threadsShouldFinish;
 
 class MidiSendProcessor
 {
 private:
-    typedef struct{
-        std::string device_name;
-        std::vector<unsigned char> midi;
-    } MidiDeviceAndMessage;
+    // Messages, and the queue blocks that hold them, live in a fixed
+    // arena so that neither the Erlang schedulers queuing them nor the
+    // send thread draining them go near the global heap
+    static SonicPi::Memory::Arena& arena();
+
+    struct MidiDeviceAndMessage {
+        MidiDeviceAndMessage()
+            : device_name(SonicPi::Memory::ArenaAllocator<char>(arena()))
+            , midi(SonicPi::Memory::ArenaAllocator<unsigned char>(arena()))
+        {
+        }
+
+        SonicPi::Memory::ArenaString device_name;
+        SonicPi::Memory::ArenaVector<unsigned char> midi;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    struct QueueTraits : public moodycamel::ConcurrentQueueDefaultTraits {
+        static void* malloc(size_t size) { return arena().Allocate(size); }
+        static void free(void* ptr) { arena().Deallocate(ptr); }
+    };
 
 public:
-    MidiSendProcessor() : m_flushing(false) {};
+    MidiSendProcessor() : m_messages(QueueCapacity), m_flushing(false) {};
     ~MidiSendProcessor();
 
     void startThread();
@@ -62,14 +83,24 @@ public:
     static const std::vector<std::string> getKnownOscMessages();
 
 private:
-    void send(const std::string& outDevice, const std::vector< unsigned char >* msg);
+    void send(const SonicPi::Memory::ArenaString& outDevice, const unsigned char* msg, std::size_t size);
 
     std::vector<std::unique_ptr<MidiOut> > m_outputs;
     MonitorLogger& m_logger{ MonitorLogger::getInstance() };
 
-    moodycamel::BlockingConcurrentQueue<MidiDeviceAndMessage> m_messages;
+    // Room for this many messages is set aside up front
+    static const std::size_t QueueCapacity = 256;
+    moodycamel::BlockingConcurrentQueue<MidiDeviceAndMessage, QueueTraits> m_messages;
 
     std::thread m_thread;
     std::atomic<bool> m_flushing;
+
+    SonicPi::Metrics::Counter& m_queued { SonicPi::Metrics::GetCounter("send.queued") };
+    SonicPi::Metrics::Counter& m_sent { SonicPi::Metrics::GetCounter("send.sent") };
+    SonicPi::Metrics::Counter& m_flushed { SonicPi::Metrics::GetCounter("send.flushed") };
+    SonicPi::Metrics::Counter& m_errors { SonicPi::Metrics::GetCounter("send.errors") };
+    SonicPi::Metrics::Gauge& m_queueDepth { SonicPi::Metrics::GetGauge("send.queue_depth") };
+    SonicPi::Metrics::Gauge& m_arenaUsed { SonicPi::Metrics::GetGauge("send.arena_used") };
+    SonicPi::Metrics::Histogram& m_latency { SonicPi::Metrics::GetHistogram("send.latency_ms", SonicPi::Metrics::Histogram::LatencyMsBounds()) };
     void run();
 };
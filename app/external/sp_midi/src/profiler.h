@@ -0,0 +1,44 @@
+// MIT License
+
+// Copyright (c) 2016-2021 Luis Lloret
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+// Tracy instrumentation, matching the GUI's profiler.h. Everything here
+// compiles away unless the build is configured with -DENABLE_TRACY=ON,
+// which defines TRACY_ENABLE.
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+// TracyPlot is overloaded for int64_t, float and double, so cast plain ints
+#define SP_Plot(a, b) TracyPlot(a, b)
+#define SP_Lockable(a, b) TracyLockable(a, b)
+#define SP_LockableBase(a) LockableBase(a)
+#define SP_ZoneScoped ZoneScoped
+#define SP_ZoneScopedN(a) ZoneScopedN(a)
+#define SP_SetThreadName(a) tracy::SetThreadName(a)
+#else
+#define SP_Plot(a, b)
+#define SP_Lockable(a, b) a b
+#define SP_LockableBase(a) a
+#define SP_ZoneScoped
+#define SP_ZoneScopedN(a)
+#define SP_SetThreadName(a)
+#endif
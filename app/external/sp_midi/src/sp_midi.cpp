@@ -24,6 +24,7 @@
 #include <chrono>
 #include <iostream>
 #include <atomic>
+#include <climits>
 #include "sp_midi.h"
 #include "hotplug_thread.h"
 #include "midiout.h"
@@ -33,6 +34,11 @@
 #include "utils.h"
 #include "monitorlogger.h"
 #include "midi_port_info.h"
+#include "api/metrics.h"
+#include "api/arena.h"
+
+// Traps heap use on the send thread when built with ENABLE_RT_ALLOC_CHECK
+SP_RT_ALLOC_CHECK_IMPLEMENT
 
 static int g_monitor_level = 6;
 
@@ -114,8 +120,9 @@ void output_time_stamps()
 
 int sp_midi_send(const char* device_name, const unsigned char* c_message, unsigned int size)
 {
-    midiSendProcessor->addMessage(device_name, c_message, size);
-
+    if (!midiSendProcessor->addMessage(device_name, c_message, size)) {
+        return -1;
+    }
     return 0;
 }
 
@@ -322,6 +329,26 @@ ERL_NIF_TERM sp_midi_get_current_time_microseconds_nif(ErlNifEnv* env, int argc,
     return enif_make_int64(env, sp_midi_get_current_time_microseconds());
 }
 
+// Returns a list of {Name, Value} tuples from the metrics registry. Whole
+// values that fit are returned as integers so that they go out as OSC
+// int32s rather than losing precision as floats.
+ERL_NIF_TERM sp_midi_metrics_nif(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+    auto samples = SonicPi::Metrics::Registry::Global().Snapshot();
+    vector<ERL_NIF_TERM> terms;
+    terms.reserve(samples.size());
+    for (const auto& sample : samples) {
+        ERL_NIF_TERM value;
+        if (sample.value >= INT_MIN && sample.value <= INT_MAX && sample.value == (double)(int)sample.value) {
+            value = enif_make_int(env, (int)sample.value);
+        } else {
+            value = enif_make_double(env, sample.value);
+        }
+        terms.push_back(enif_make_tuple2(env, enif_make_string(env, sample.name.c_str(), ERL_NIF_LATIN1), value));
+    }
+    return enif_make_list_from_array(env, terms.data(), (unsigned)terms.size());
+}
+
 int send_midi_data_to_erlang(const char *device_name, const unsigned char *data, size_t size)
 {
     ErlNifEnv *msg_env = enif_alloc_env();
@@ -352,7 +379,8 @@ static ErlNifFunc nif_funcs[] = {
     {"have_my_pid", 0, sp_midi_have_my_pid_nif},
     {"set_this_pid", 1, sp_midi_set_this_pid_nif},
     {"set_log_level", 1, sp_midi_set_log_level_nif},
-    {"get_current_time_microseconds", 0, sp_midi_get_current_time_microseconds_nif}
+    {"get_current_time_microseconds", 0, sp_midi_get_current_time_microseconds_nif},
+    {"midi_metrics", 0, sp_midi_metrics_nif}
 };
 
 ERL_NIF_INIT(sp_midi, nif_funcs, NULL, NULL, NULL, NULL);
@@ -133,6 +133,13 @@ extern "C" {
 
     DllExport ERL_NIF_TERM sp_midi_get_current_time_microseconds(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]);
 
+    /**
+     * Get a snapshot of the MIDI send/receive metrics (queue depth, send latency, message counts).
+     *
+     * It returns a list of {Name, Value} tuples to erlang.
+     */
+    DllExport ERL_NIF_TERM sp_midi_metrics_nif(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]);
+
     // Aux helper function
     ERL_NIF_TERM c_str_list_to_erlang(ErlNifEnv* env, int n, char** c_str_list);
 #ifdef __cplusplus
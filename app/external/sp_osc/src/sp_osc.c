@@ -0,0 +1,567 @@
+// --
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2021 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+// ++
+
+// OSC codec NIF for the Erlang cue/router server.
+//
+// decode/1 validates a packet and builds exactly the terms osc:decode/1
+// has always returned, in a single pass over the binary. Blobs and bundle
+// elements are handed back as sub-binaries of the packet, so nothing is
+// copied. readdress/3 and retime/2 rewrite the head of a packet with one
+// memcpy of the rest, rather than decoding and re-encoding every argument.
+//
+// Anything malformed raises badarg, which callers already catch.
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "erl_nif.h"
+
+// seconds between the NTP epoch (1900) and the unix epoch
+#define OSC_EPOCH 2208988800.0
+
+// enough for every packet we see in practice - longer messages and
+// argument lists fall back to enif_alloc
+#define STACK_ARGS 64
+#define MAX_PREFIX_ARGS 16
+
+static ERL_NIF_TERM atom_cmd;
+static ERL_NIF_TERM atom_bundle;
+static ERL_NIF_TERM atom_int64;
+static ERL_NIF_TERM atom_double;
+
+static uint32_t read_u32(const unsigned char* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint64_t read_u64(const unsigned char* p)
+{
+    return ((uint64_t)read_u32(p) << 32) | (uint64_t)read_u32(p + 4);
+}
+
+// Erlang's osc module has always treated 'h' as little endian
+static uint64_t read_u64_le(const unsigned char* p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--)
+    {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static void write_u32(unsigned char* p, uint32_t v)
+{
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static void write_u64_le(unsigned char* p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        p[i] = (unsigned char)(v >> (8 * i));
+    }
+}
+
+static size_t pad4(size_t n)
+{
+    return (n + 3) & ~(size_t)3;
+}
+
+// Finds the OSC string starting at pos. On success sets *len to the string
+// length (without the terminator) and returns the offset just past its
+// padding, or 0 if the string is unterminated or its padding is missing.
+static size_t osc_string(const unsigned char* data, size_t size, size_t pos, size_t* len)
+{
+    const unsigned char* nul;
+    size_t next;
+
+    if (pos >= size)
+    {
+        return 0;
+    }
+    nul = memchr(data + pos, 0, size - pos);
+    if (nul == NULL)
+    {
+        return 0;
+    }
+    *len = (size_t)(nul - (data + pos));
+    next = pos + pad4(*len + 1);
+    return next <= size ? next : 0;
+}
+
+static double decode_time(const unsigned char* p)
+{
+    return ((double)read_u32(p) - OSC_EPOCH) + (double)read_u32(p + 4) / 4294967296.0;
+}
+
+static void encode_time(unsigned char* p, double time)
+{
+    double t = time + OSC_EPOCH;
+    double whole = trunc(t);
+    write_u32(p, (uint32_t)(int64_t)whole);
+    write_u32(p + 4, (uint32_t)(int64_t)trunc((t - whole) * 4294967296.0));
+}
+
+static int is_bundle(const unsigned char* data, size_t size)
+{
+    return size >= 8 && memcmp(data, "#bundle", 8) == 0;
+}
+
+static ERL_NIF_TERM decode_bundle(ErlNifEnv* env, ERL_NIF_TERM packet, const unsigned char* data, size_t size)
+{
+    ERL_NIF_TERM elements;
+    size_t count = 0;
+    size_t pos;
+    ERL_NIF_TERM* terms;
+    ERL_NIF_TERM stack_terms[STACK_ARGS];
+
+    if (size < 16)
+    {
+        return enif_make_badarg(env);
+    }
+
+    // validate and count first, so the list can be built front to back
+    for (pos = 16; pos < size; count++)
+    {
+        uint32_t len;
+        if (size - pos < 4)
+        {
+            return enif_make_badarg(env);
+        }
+        len = read_u32(data + pos);
+        if (len > size - pos - 4)
+        {
+            return enif_make_badarg(env);
+        }
+        pos += 4 + len;
+    }
+
+    if (count == 0)
+    {
+        return enif_make_tuple3(env, atom_bundle, enif_make_double(env, decode_time(data + 8)), enif_make_list(env, 0));
+    }
+
+    terms = count <= STACK_ARGS ? stack_terms : enif_alloc(count * sizeof(ERL_NIF_TERM));
+    pos = 16;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t len = read_u32(data + pos);
+        terms[i] = enif_make_tuple2(env,
+                                    enif_make_uint(env, len),
+                                    enif_make_sub_binary(env, packet, pos + 4, len));
+        pos += 4 + len;
+    }
+    elements = enif_make_list_from_array(env, terms, (unsigned)count);
+    if (terms != stack_terms)
+    {
+        enif_free(terms);
+    }
+
+    return enif_make_tuple3(env, atom_bundle, enif_make_double(env, decode_time(data + 8)), elements);
+}
+
+static ERL_NIF_TERM decode_message(ErlNifEnv* env, ERL_NIF_TERM packet, const unsigned char* data, size_t size)
+{
+    size_t address_len, tags_len, pos, nargs;
+    size_t tags_pos;
+    ERL_NIF_TERM* terms;
+    ERL_NIF_TERM stack_terms[STACK_ARGS];
+    ERL_NIF_TERM result;
+    int ok = 1;
+
+    tags_pos = osc_string(data, size, 0, &address_len);
+    if (tags_pos == 0)
+    {
+        return enif_make_badarg(env);
+    }
+    pos = osc_string(data, size, tags_pos, &tags_len);
+    if (pos == 0 || tags_len == 0 || data[tags_pos] != ',')
+    {
+        return enif_make_badarg(env);
+    }
+
+    nargs = tags_len - 1;
+    terms = nargs < STACK_ARGS ? stack_terms : enif_alloc((nargs + 1) * sizeof(ERL_NIF_TERM));
+    terms[0] = enif_make_string_len(env, (const char*)data, address_len, ERL_NIF_LATIN1);
+
+    for (size_t i = 0; ok && i < nargs; i++)
+    {
+        const unsigned char tag = data[tags_pos + 1 + i];
+        ERL_NIF_TERM* arg = &terms[i + 1];
+
+        switch (tag)
+        {
+        case 'i':
+            if ((ok = size - pos >= 4))
+            {
+                *arg = enif_make_int(env, (int32_t)read_u32(data + pos));
+                pos += 4;
+            }
+            break;
+        case 'f':
+            if ((ok = size - pos >= 4))
+            {
+                uint32_t bits = read_u32(data + pos);
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                if ((ok = isfinite(f)))
+                {
+                    *arg = enif_make_double(env, f);
+                }
+                pos += 4;
+            }
+            break;
+        case 'd':
+            if ((ok = size - pos >= 8))
+            {
+                uint64_t bits = read_u64(data + pos);
+                double d;
+                memcpy(&d, &bits, sizeof(d));
+                if ((ok = isfinite(d)))
+                {
+                    *arg = enif_make_double(env, d);
+                }
+                pos += 8;
+            }
+            break;
+        case 'h':
+            if ((ok = size - pos >= 8))
+            {
+                *arg = enif_make_tuple2(env, atom_int64, enif_make_uint64(env, read_u64_le(data + pos)));
+                pos += 8;
+            }
+            break;
+        case 's':
+        {
+            size_t len;
+            size_t next = osc_string(data, size, pos, &len);
+            if ((ok = next != 0))
+            {
+                *arg = enif_make_string_len(env, (const char*)data + pos, len, ERL_NIF_LATIN1);
+                pos = next;
+            }
+            break;
+        }
+        case 'b':
+            if ((ok = size - pos >= 4))
+            {
+                uint32_t len = read_u32(data + pos);
+                if ((ok = len <= size - pos - 4 && pad4(len) <= size - pos - 4))
+                {
+                    *arg = enif_make_sub_binary(env, packet, pos + 4, len);
+                    pos += 4 + pad4(len);
+                }
+            }
+            break;
+        default:
+            ok = 0;
+            break;
+        }
+    }
+
+    if (ok)
+    {
+        result = enif_make_tuple2(env, atom_cmd, enif_make_list_from_array(env, terms, (unsigned)(nargs + 1)));
+    }
+    else
+    {
+        result = enif_make_badarg(env);
+    }
+    if (terms != stack_terms)
+    {
+        enif_free(terms);
+    }
+    return result;
+}
+
+static ERL_NIF_TERM decode_nif(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+    ErlNifBinary bin;
+
+    if (!enif_inspect_binary(env, argv[0], &bin))
+    {
+        return enif_make_badarg(env);
+    }
+    if (is_bundle(bin.data, bin.size))
+    {
+        return decode_bundle(env, argv[0], bin.data, bin.size);
+    }
+    return decode_message(env, argv[0], bin.data, bin.size);
+}
+
+// A single argument to prepend in readdress/3, encoded the same way as
+// osc:encode/1 would
+typedef struct
+{
+    char tag;
+    size_t size;
+    ErlNifBinary bin;
+    union
+    {
+        ErlNifSInt64 i;
+        double f;
+        ErlNifUInt64 h;
+    } v;
+} prefix_arg;
+
+static int get_prefix_arg(ErlNifEnv* env, ERL_NIF_TERM term, prefix_arg* arg)
+{
+    int arity;
+    const ERL_NIF_TERM* tuple;
+    unsigned atom_len;
+
+    if (enif_get_int64(env, term, &arg->v.i))
+    {
+        arg->tag = 'i';
+        arg->size = 4;
+        return 1;
+    }
+    if (enif_get_double(env, term, &arg->v.f))
+    {
+        arg->tag = 'f';
+        arg->size = 4;
+        return 1;
+    }
+    if (enif_is_list(env, term) && enif_inspect_iolist_as_binary(env, term, &arg->bin))
+    {
+        arg->tag = 's';
+        arg->size = pad4(arg->bin.size + 1);
+        return 1;
+    }
+    if (enif_get_atom_length(env, term, &atom_len, ERL_NIF_LATIN1))
+    {
+        char name[256];
+        if (atom_len >= sizeof(name) || !enif_get_atom(env, term, name, sizeof(name), ERL_NIF_LATIN1))
+        {
+            return 0;
+        }
+        if (!enif_alloc_binary(atom_len, &arg->bin))
+        {
+            return 0;
+        }
+        memcpy(arg->bin.data, name, atom_len);
+        arg->tag = 'S';
+        arg->size = pad4(atom_len + 1);
+        return 1;
+    }
+    if (enif_inspect_binary(env, term, &arg->bin))
+    {
+        arg->tag = 'b';
+        arg->size = 4 + pad4(arg->bin.size);
+        return 1;
+    }
+    if (enif_get_tuple(env, term, &arity, &tuple) && arity == 2)
+    {
+        if (enif_is_identical(tuple[0], atom_int64) && enif_get_uint64(env, tuple[1], &arg->v.h))
+        {
+            arg->tag = 'h';
+            arg->size = 8;
+            return 1;
+        }
+        if (enif_is_identical(tuple[0], atom_double) && enif_get_double(env, tuple[1], &arg->v.f))
+        {
+            arg->tag = 'd';
+            arg->size = 8;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static unsigned char* put_prefix_arg(unsigned char* out, const prefix_arg* arg)
+{
+    memset(out, 0, arg->size);
+    switch (arg->tag)
+    {
+    case 'i':
+        write_u32(out, (uint32_t)arg->v.i);
+        break;
+    case 'f':
+    {
+        float f = (float)arg->v.f;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        write_u32(out, bits);
+        break;
+    }
+    case 'd':
+    {
+        uint64_t bits;
+        memcpy(&bits, &arg->v.f, sizeof(bits));
+        write_u32(out, (uint32_t)(bits >> 32));
+        write_u32(out + 4, (uint32_t)bits);
+        break;
+    }
+    case 'h':
+        write_u64_le(out, arg->v.h);
+        break;
+    case 's':
+    case 'S':
+        memcpy(out, arg->bin.data, arg->bin.size);
+        break;
+    case 'b':
+        write_u32(out, (uint32_t)arg->bin.size);
+        memcpy(out + 4, arg->bin.data, arg->bin.size);
+        break;
+    }
+    return out + arg->size;
+}
+
+// readdress(Packet, Address, PrefixArgs) swaps the address of a message
+// and inserts PrefixArgs in front of its existing arguments. The original
+// type tags and argument data are copied across untouched.
+static ERL_NIF_TERM readdress_nif(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+    ErlNifBinary bin, address;
+    prefix_arg prefix[MAX_PREFIX_ARGS];
+    unsigned nprefix = 0;
+    size_t address_len, tags_len, tags_pos, data_pos, new_tags_len, out_size;
+    ERL_NIF_TERM list, head, result;
+    unsigned char* out;
+    int ok = 1;
+
+    if (!enif_inspect_binary(env, argv[0], &bin) || is_bundle(bin.data, bin.size) ||
+        !enif_inspect_iolist_as_binary(env, argv[1], &address) ||
+        memchr(address.data, 0, address.size) != NULL)
+    {
+        return enif_make_badarg(env);
+    }
+
+    tags_pos = osc_string(bin.data, bin.size, 0, &address_len);
+    if (tags_pos == 0)
+    {
+        return enif_make_badarg(env);
+    }
+    data_pos = osc_string(bin.data, bin.size, tags_pos, &tags_len);
+    if (data_pos == 0 || tags_len == 0 || bin.data[tags_pos] != ',')
+    {
+        return enif_make_badarg(env);
+    }
+
+    list = argv[2];
+    while (ok && enif_get_list_cell(env, list, &head, &list))
+    {
+        ok = nprefix < MAX_PREFIX_ARGS && get_prefix_arg(env, head, &prefix[nprefix]);
+        if (ok)
+        {
+            nprefix++;
+        }
+    }
+    ok = ok && enif_is_empty_list(env, list);
+
+    if (ok)
+    {
+        size_t args_size = 0;
+        for (unsigned i = 0; i < nprefix; i++)
+        {
+            args_size += prefix[i].size;
+        }
+
+        new_tags_len = tags_len + nprefix;
+        out_size = pad4(address.size + 1) + pad4(new_tags_len + 1) + args_size + (bin.size - data_pos);
+        out = enif_make_new_binary(env, out_size, &result);
+        memset(out, 0, pad4(address.size + 1) + pad4(new_tags_len + 1));
+
+        memcpy(out, address.data, address.size);
+        out += pad4(address.size + 1);
+
+        out[0] = ',';
+        for (unsigned i = 0; i < nprefix; i++)
+        {
+            out[1 + i] = prefix[i].tag == 'S' ? 's' : prefix[i].tag;
+        }
+        memcpy(out + 1 + nprefix, bin.data + tags_pos + 1, tags_len - 1);
+        out += pad4(new_tags_len + 1);
+
+        for (unsigned i = 0; i < nprefix; i++)
+        {
+            out = put_prefix_arg(out, &prefix[i]);
+        }
+        memcpy(out, bin.data + data_pos, bin.size - data_pos);
+    }
+    else
+    {
+        result = enif_make_badarg(env);
+    }
+
+    for (unsigned i = 0; i < nprefix; i++)
+    {
+        if (prefix[i].tag == 'S')
+        {
+            enif_release_binary(&prefix[i].bin);
+        }
+    }
+    return result;
+}
+
+// retime(Bundle, Time) replaces a bundle's time tag, leaving its elements
+// as they are. Time is in seconds past the unix epoch, like osc:now/0.
+static ERL_NIF_TERM retime_nif(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+    ErlNifBinary bin;
+    double time;
+    ErlNifSInt64 itime;
+    ERL_NIF_TERM result;
+    unsigned char* out;
+
+    if (!enif_inspect_binary(env, argv[0], &bin) || !is_bundle(bin.data, bin.size) || bin.size < 16)
+    {
+        return enif_make_badarg(env);
+    }
+    if (!enif_get_double(env, argv[1], &time))
+    {
+        if (!enif_get_int64(env, argv[1], &itime))
+        {
+            return enif_make_badarg(env);
+        }
+        time = (double)itime;
+    }
+
+    out = enif_make_new_binary(env, bin.size, &result);
+    memcpy(out, bin.data, bin.size);
+    encode_time(out + 8, time);
+    return result;
+}
+
+static ERL_NIF_TERM is_loaded_nif(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+    return enif_make_atom(env, "true");
+}
+
+static int load(ErlNifEnv* env, void** priv_data, ERL_NIF_TERM load_info)
+{
+    atom_cmd = enif_make_atom(env, "cmd");
+    atom_bundle = enif_make_atom(env, "bundle");
+    atom_int64 = enif_make_atom(env, "int64");
+    atom_double = enif_make_atom(env, "double");
+    return 0;
+}
+
+static int upgrade(ErlNifEnv* env, void** priv_data, void** old_priv_data, ERL_NIF_TERM load_info)
+{
+    return load(env, priv_data, load_info);
+}
+
+static ErlNifFunc nif_funcs[] = {
+    {"decode", 1, decode_nif},
+    {"readdress", 3, readdress_nif},
+    {"retime", 2, retime_nif},
+    {"is_loaded", 0, is_loaded_nif}
+};
+
+ERL_NIF_INIT(sp_osc, nif_funcs, load, NULL, upgrade, NULL);
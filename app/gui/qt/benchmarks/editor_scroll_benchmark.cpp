@@ -0,0 +1,157 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+// Opens a large Ruby buffer in the editor and scrolls through it a page
+// at a time, reporting how long each repaint takes. Pass a file to
+// benchmark a real score, otherwise a 20k line one is generated:
+//
+//   editor-scroll-benchmark [file.rb] [--lines N] [--frames N]
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+
+#include "model/sonicpitheme.h"
+#include "widgets/sonicpilexer.h"
+#include "widgets/sonicpiscintilla.h"
+
+namespace {
+
+  // Roughly the shape of a generated score - nested live_loops with
+  // plenty of strings, symbols, comments and numbers for LexRuby to chew on
+  QString generateScore(int numLines) {
+    QString out;
+    QTextStream s(&out);
+    int line = 0;
+    int loop = 0;
+    while (line < numLines) {
+      s << "# section " << loop << "\n";
+      s << "live_loop :section_" << loop << " do\n";
+      s << "  use_synth :tb303\n";
+      s << "  with_fx :reverb, room: 0.8 do\n";
+      line += 4;
+      for (int i = 0; i < 16 && line < numLines - 3; i++, line++) {
+        s << "    play " << (40 + (loop + i) % 40) << ", release: 0." << (i % 9 + 1)
+          << ", cutoff: rrand(70, 130) if spread(3, 8).tick # step " << i << "\n";
+      }
+      s << "    sample :bd_haus, amp: 1.5, rate: \"1.0\".to_f\n";
+      s << "  end\n";
+      s << "  sleep 0.25\n";
+      s << "end\n";
+      line += 4;
+      loop++;
+    }
+    return out;
+  }
+
+  double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) {
+      return 0;
+    }
+    size_t idx = std::min(sorted.size() - 1, (size_t) (p * (sorted.size() - 1) + 0.5));
+    return sorted[idx];
+  }
+
+  double elapsedMs(const QElapsedTimer &timer) {
+    return timer.nsecsElapsed() / 1000000.0;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  QApplication app(argc, argv);
+
+  int numLines = 20000;
+  int numFrames = 0;
+  QString fileName;
+
+  QStringList args = app.arguments();
+  for (int i = 1; i < args.size(); i++) {
+    if (args[i] == "--lines" && i + 1 < args.size()) {
+      numLines = args[++i].toInt();
+    } else if (args[i] == "--frames" && i + 1 < args.size()) {
+      numFrames = args[++i].toInt();
+    } else {
+      fileName = args[i];
+    }
+  }
+
+  QString content;
+  if (fileName.isEmpty()) {
+    content = generateScore(numLines);
+  } else {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      std::cerr << "Unable to open " << fileName.toStdString() << std::endl;
+      return 1;
+    }
+    content = QString::fromUtf8(file.readAll());
+  }
+
+  SonicPiTheme *theme = new SonicPiTheme(&app, "", "");
+  SonicPiLexer *lexer = new SonicPiLexer(theme);
+  SonicPiScintilla *editor = new SonicPiScintilla(lexer, theme, "benchmark", nullptr, true);
+  editor->resize(1280, 800);
+  editor->show();
+  app.processEvents();
+
+  QElapsedTimer timer;
+  timer.start();
+  editor->replaceBuffer(content, 0, 0, 0);
+  editor->viewport()->repaint();
+  double openMs = elapsedMs(timer);
+
+  int lines = editor->lines();
+  int page = std::max(1, (int) editor->SendScintilla(QsciScintilla::SCI_LINESONSCREEN));
+  if (numFrames <= 0) {
+    numFrames = lines / page + 1;
+  }
+
+  // Each frame jumps a page further down, then lets any idle styling or
+  // queued updates run before the next one so they're not charged to
+  // the repaint
+  std::vector<double> frames;
+  frames.reserve(numFrames);
+  for (int i = 0; i < numFrames; i++) {
+    editor->setFirstVisibleLine((i * page) % std::max(1, lines));
+    timer.restart();
+    editor->viewport()->repaint();
+    frames.push_back(elapsedMs(timer));
+    app.processEvents();
+  }
+
+  std::vector<double> sorted = frames;
+  std::sort(sorted.begin(), sorted.end());
+  double total = 0;
+  for (double f : frames) {
+    total += f;
+  }
+
+  std::cout << "lines:  " << lines << std::endl;
+  std::cout << "open:   " << openMs << " ms" << std::endl;
+  std::cout << "frames: " << frames.size() << " (" << page << " lines per page)" << std::endl;
+  std::cout << "mean:   " << (frames.empty() ? 0 : total / frames.size()) << " ms" << std::endl;
+  std::cout << "min:    " << percentile(sorted, 0) << " ms" << std::endl;
+  std::cout << "median: " << percentile(sorted, 0.5) << " ms" << std::endl;
+  std::cout << "p95:    " << percentile(sorted, 0.95) << " ms" << std::endl;
+  std::cout << "max:    " << percentile(sorted, 1) << " ms" << std::endl;
+
+  delete editor;
+  return 0;
+}
@@ -0,0 +1,468 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+// Boots a local server with the headless API client, replays a recorded
+// session against it and reports how long each leg of the GUI <-> server
+// round trip takes:
+//
+//   run -> log      pressing Run to the first /log/multi_message arriving
+//   run -> done     pressing Run to /runs/all-completed
+//   osc -> cue      an incoming OSC message to its /incoming/osc cue
+//   log decode      unpacking a /log/multi_message as OscHandler does
+//   log render      SonicPiLog::handleMultiMessage plus a repaint
+//   log -> paint    a log arriving to it being painted
+//   cue render      appending a cue to the cue pane plus a repaint
+//   cue -> paint    a cue arriving to it being painted
+//
+// Runs headless with the offscreen platform, e.g. in CI:
+//
+//   QT_QPA_PLATFORM=offscreen run-latency-benchmark [session] [--iterations N]
+//       [--root path] [--ruby path]
+//
+// Sessions are plain text. Lines starting with @ are steps, everything
+// else is code for the preceding @run:
+//
+//   @run           run the code that follows
+//   @osc /path 1 "a"   send an OSC message to the server's cue port
+//   @wait ms       pause before the next step
+//   @stop          stop all running jobs
+//
+// Lines starting with # outside of a @run are comments.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QApplication>
+#include <QColor>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QVBoxLayout>
+#include <QWidget>
+
+#include "api/api.h"
+#include "api/osc/oscpkt.hh"
+#include "api/osc/udp.hh"
+#include "model/sonicpitheme.h"
+#include "widgets/sonicpilog.h"
+
+namespace {
+
+  typedef std::chrono::steady_clock Clock;
+
+  double elapsedMs(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+  }
+
+  double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) {
+      return 0;
+    }
+    size_t idx = std::min(sorted.size() - 1, (size_t) (p * (sorted.size() - 1) + 0.5));
+    return sorted[idx];
+  }
+
+  void report(const char *name, std::vector<double> samples) {
+    if (samples.empty()) {
+      printf("%-14s %7d %9s %9s %9s %9s %9s\n", name, 0, "-", "-", "-", "-", "-");
+      return;
+    }
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double s : samples) {
+      total += s;
+    }
+    printf("%-14s %7d %9.3f %9.3f %9.3f %9.3f %9.3f\n", name, (int) samples.size(),
+           total / samples.size(), percentile(samples, 0.5), percentile(samples, 0.9),
+           percentile(samples, 0.99), samples.back());
+  }
+
+  struct Step {
+    enum Type { Run, Osc, Wait, Stop };
+    Type type;
+    std::string code;
+    std::string address;
+    oscpkt::Message msg;
+    int ms;
+  };
+
+  oscpkt::Message parseOsc(const QString &line, std::string &address) {
+    QStringList tokens;
+    QString token;
+    bool quoted = false;
+    for (QChar c : line) {
+      if (c == '"') {
+        quoted = !quoted;
+      } else if (c.isSpace() && !quoted) {
+        if (!token.isEmpty()) {
+          tokens << token;
+          token.clear();
+        }
+      } else {
+        token += c;
+      }
+    }
+    if (!token.isEmpty()) {
+      tokens << token;
+    }
+
+    address = tokens.isEmpty() ? "/" : tokens[0].toStdString();
+    oscpkt::Message msg(address);
+    for (int i = 1; i < tokens.size(); i++) {
+      bool ok;
+      int n = tokens[i].toInt(&ok);
+      if (ok) {
+        msg.pushInt32(n);
+        continue;
+      }
+      float f = tokens[i].toFloat(&ok);
+      if (ok) {
+        msg.pushFloat(f);
+      } else {
+        msg.pushStr(tokens[i].toStdString());
+      }
+    }
+    return msg;
+  }
+
+  bool loadSession(const QString &path, std::vector<Step> &steps) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      return false;
+    }
+    QTextStream in(&file);
+    in.setCodec("UTF-8");
+    Step *run = nullptr;
+    while (!in.atEnd()) {
+      QString line = in.readLine();
+      QString trimmed = line.trimmed();
+      if (trimmed.startsWith("@")) {
+        QString directive = trimmed.section(' ', 0, 0);
+        QString rest = trimmed.section(' ', 1).trimmed();
+        Step step;
+        step.ms = 0;
+        run = nullptr;
+        if (directive == "@run") {
+          step.type = Step::Run;
+        } else if (directive == "@osc") {
+          step.type = Step::Osc;
+          step.msg = parseOsc(rest, step.address);
+        } else if (directive == "@wait") {
+          step.type = Step::Wait;
+          step.ms = rest.toInt();
+        } else if (directive == "@stop") {
+          step.type = Step::Stop;
+        } else {
+          std::cerr << "Unknown step " << directive.toStdString() << std::endl;
+          return false;
+        }
+        steps.push_back(step);
+        if (step.type == Step::Run) {
+          run = &steps.back();
+        }
+      } else if (run) {
+        run->code += line.toStdString() + "\n";
+      } else if (!trimmed.isEmpty() && !trimmed.startsWith("#")) {
+        std::cerr << "Code outside of a @run: " << line.toStdString() << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Rebuilds the packet the server sent, so decoding can be timed on its
+  // own rather than mixed in with the socket
+  std::vector<char> encode(const SonicPi::API::MultiLog &ml) {
+    oscpkt::Message msg("/log/multi_message");
+    msg.pushInt32(ml.jobId);
+    msg.pushStr(ml.threadName);
+    msg.pushStr(ml.runtime);
+    msg.pushInt32((int) ml.messages.size());
+    for (const auto &m : ml.messages) {
+      msg.pushInt32(m.type);
+      msg.pushStr(m.text);
+    }
+    oscpkt::PacketWriter pw;
+    pw.addMessage(msg);
+    return std::vector<char>(pw.packetData(), pw.packetData() + pw.packetSize());
+  }
+
+  // The same unpacking OscHandler does for /log/multi_message
+  bool decode(oscpkt::PacketViewReader &pr, const std::vector<char> &packet, SonicPiTheme *theme, SonicPiLog::MultiMessage &mm) {
+    pr.init(packet.data(), packet.size());
+    const oscpkt::MessageView *msg = pr.popMessage();
+    if (!msg || !msg->match("/log/multi_message")) {
+      return false;
+    }
+    int msg_count;
+    mm.theme = theme;
+    mm.messages.clear();
+    oscpkt::StringView threadName, runtime, s;
+    oscpkt::MessageView::ArgReader ar = msg->arg();
+    ar.popInt32(mm.job_id);
+    ar.popStr(threadName);
+    ar.popStr(runtime);
+    ar.popInt32(msg_count);
+    mm.thread_name = QString::fromUtf8(threadName.data(), int(threadName.size()));
+    mm.runtime = QString::fromUtf8(runtime.data(), int(runtime.size()));
+    for (int i = 0; i < msg_count; i++) {
+      SonicPiLog::Message message;
+      ar.popInt32(message.msg_type);
+      ar.popStr(s);
+      message.s = QString::fromUtf8(s.data(), int(s.size()));
+      mm.messages.push_back(message);
+    }
+    return ar.isOkNoMoreArgs();
+  }
+
+  // Mirrors OscHandler's /incoming/osc handling for the cue pane
+  void renderCue(SonicPiLog *incoming, SonicPiTheme *theme, const SonicPi::API::CueInfo &cue) {
+    int idmod = ((cue.id * 3) % 200);
+    idmod = 155 + ((idmod < 100) ? idmod : 200 - idmod);
+    QColor bg = theme->color(SonicPiTheme::CuePathBackground);
+    bg.setAlpha(idmod);
+    incoming->setTextBgFgColors(bg, theme->color(SonicPiTheme::CuePathForeground));
+    incoming->appendPlainText(QString::fromStdString(" " + cue.address));
+    incoming->setTextBgFgColors(theme->color(SonicPiTheme::LogBackground), QColor("white"));
+    incoming->insertPlainText(" ");
+    bg = theme->color(SonicPiTheme::CueDataBackground);
+    bg.setAlpha(idmod);
+    incoming->setTextBgFgColors(bg, theme->color(SonicPiTheme::CueDataForeground));
+    incoming->insertPlainText(QString::fromStdString(cue.arguments));
+  }
+
+  struct Samples {
+    std::vector<double> runToLog, runToDone, oscToCue;
+    std::vector<double> logRender, logToPaint, cueRender, cueToPaint;
+  };
+}
+
+int main(int argc, char *argv[])
+{
+  QApplication app(argc, argv);
+
+  // CMake builds the benchmark next to the app, see MainWindow::rootPath
+  QString rootPath = QCoreApplication::applicationDirPath() + "/../../../..";
+  QString rubyPath;
+  QString sessionPath;
+  int iterations = 5;
+
+  QStringList args = app.arguments();
+  for (int i = 1; i < args.size(); i++) {
+    if (args[i] == "--iterations" && i + 1 < args.size()) {
+      iterations = args[++i].toInt();
+    } else if (args[i] == "--root" && i + 1 < args.size()) {
+      rootPath = args[++i];
+    } else if (args[i] == "--ruby" && i + 1 < args.size()) {
+      rubyPath = args[++i];
+    } else {
+      sessionPath = args[i];
+    }
+  }
+  if (sessionPath.isEmpty()) {
+    sessionPath = rootPath + "/app/gui/qt/benchmarks/sessions/basic.session";
+  }
+
+  std::vector<Step> steps;
+  if (!loadSession(sessionPath, steps)) {
+    std::cerr << "Unable to load session " << sessionPath.toStdString() << std::endl;
+    return 1;
+  }
+
+  SonicPiTheme *theme = new SonicPiTheme(&app, "", "");
+  QWidget window;
+  QVBoxLayout *layout = new QVBoxLayout(&window);
+  SonicPiLog *outputPane = new SonicPiLog;
+  SonicPiLog *incomingPane = new SonicPiLog;
+  layout->addWidget(outputPane);
+  layout->addWidget(incomingPane);
+  window.resize(800, 900);
+  window.show();
+  app.processEvents();
+
+  Samples samples;
+  std::mutex mutex;
+  std::vector<SonicPi::API::MultiLog> logs;
+  bool awaitingLog = false, awaitingDone = false;
+  Clock::time_point runStart;
+  std::map<std::string, Clock::time_point> oscSent;
+
+  // Callbacks arrive on the client's receive thread - timings are taken
+  // there, and painting is handed over to the GUI thread just as
+  // OscHandler does with queued invocations
+  SonicPi::API::Callbacks callbacks;
+  callbacks.log = [&](const SonicPi::API::MultiLog &ml) {
+    Clock::time_point received = Clock::now();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (awaitingLog) {
+        samples.runToLog.push_back(elapsedMs(runStart, received));
+        awaitingLog = false;
+      }
+      logs.push_back(ml);
+    }
+    SonicPiLog::MultiMessage mm;
+    mm.theme = theme;
+    mm.job_id = ml.jobId;
+    mm.thread_name = QString::fromStdString(ml.threadName);
+    mm.runtime = QString::fromStdString(ml.runtime);
+    for (const auto &m : ml.messages) {
+      mm.messages.push_back({m.type, QString::fromStdString(m.text)});
+    }
+    QMetaObject::invokeMethod(&app, [&, mm, received]() {
+      Clock::time_point start = Clock::now();
+      outputPane->handleMultiMessage(mm);
+      outputPane->viewport()->repaint();
+      Clock::time_point painted = Clock::now();
+      samples.logRender.push_back(elapsedMs(start, painted));
+      samples.logToPaint.push_back(elapsedMs(received, painted));
+    }, Qt::QueuedConnection);
+  };
+  callbacks.allJobsCompleted = [&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (awaitingDone) {
+      samples.runToDone.push_back(elapsedMs(runStart, Clock::now()));
+      awaitingDone = false;
+    }
+  };
+  callbacks.cue = [&](const SonicPi::API::CueInfo &cue) {
+    Clock::time_point received = Clock::now();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto it = oscSent.begin(); it != oscSent.end(); ++it) {
+        const std::string &path = it->first;
+        if (cue.address.size() >= path.size() &&
+            cue.address.compare(cue.address.size() - path.size(), path.size(), path) == 0) {
+          samples.oscToCue.push_back(elapsedMs(it->second, received));
+          oscSent.erase(it);
+          break;
+        }
+      }
+    }
+    QMetaObject::invokeMethod(&app, [&, cue, received]() {
+      Clock::time_point start = Clock::now();
+      renderCue(incomingPane, theme, cue);
+      incomingPane->viewport()->repaint();
+      Clock::time_point painted = Clock::now();
+      samples.cueRender.push_back(elapsedMs(start, painted));
+      samples.cueToPaint.push_back(elapsedMs(received, painted));
+    }, Qt::QueuedConnection);
+  };
+  callbacks.runtimeError = [](const SonicPi::API::RuntimeError &err) {
+    std::cerr << "Runtime error: " << err.description << std::endl;
+  };
+  callbacks.syntaxError = [](const SonicPi::API::SyntaxError &err) {
+    std::cerr << "Syntax error: " << err.description << std::endl;
+  };
+
+  SonicPi::API::Client client(callbacks);
+  SonicPi::API::BootOptions options;
+  options.rootPath = rootPath.toStdString();
+  options.rubyPath = rubyPath.toStdString();
+
+  std::cout << "Booting server..." << std::endl;
+  Clock::time_point bootStart = Clock::now();
+  if (!client.Boot(options).get()) {
+    std::cerr << "Unable to boot the server" << std::endl;
+    return 1;
+  }
+  double bootMs = elapsedMs(bootStart, Clock::now());
+
+  // Make sure incoming OSC is turned into cues
+  oscpkt::Message cuePort("/cue-port-start");
+  cuePort.pushStr(client.ClientId());
+  client.Send(cuePort);
+  oscpkt::Message cueInternal("/cue-port-internal");
+  cueInternal.pushStr(client.ClientId());
+  client.Send(cueInternal);
+
+  oscpkt::UdpSocket oscSocket;
+  oscSocket.connectTo("127.0.0.1", client.Ports()["server-osc-cues"]);
+
+  std::thread player([&]() {
+    for (int i = 0; i < iterations; i++) {
+      for (const Step &step : steps) {
+        switch (step.type) {
+        case Step::Run: {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            runStart = Clock::now();
+            awaitingLog = awaitingDone = true;
+          }
+          client.RunCode(step.code);
+          break;
+        }
+        case Step::Osc: {
+          oscpkt::PacketWriter pw;
+          pw.addMessage(step.msg);
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            oscSent[step.address] = Clock::now();
+          }
+          oscSocket.sendPacket(pw.packetData(), pw.packetSize());
+          break;
+        }
+        case Step::Wait:
+          std::this_thread::sleep_for(std::chrono::milliseconds(step.ms));
+          break;
+        case Step::Stop:
+          client.StopAll();
+          break;
+        }
+      }
+    }
+    client.StopAll();
+    // let the last logs and cues drain
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    QMetaObject::invokeMethod(&app, "quit", Qt::QueuedConnection);
+  });
+
+  app.exec();
+  player.join();
+  client.Shutdown();
+
+  // Decode every log the server sent, a few times over to get past the
+  // timer's resolution
+  const int decodeRepeats = 100;
+  std::vector<double> logDecode;
+  oscpkt::PacketViewReader pr;
+  SonicPiLog::MultiMessage mm;
+  for (const auto &ml : logs) {
+    std::vector<char> packet = encode(ml);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < decodeRepeats; i++) {
+      decode(pr, packet, theme, mm);
+    }
+    logDecode.push_back(elapsedMs(start, Clock::now()) / decodeRepeats);
+  }
+
+  std::cout << "session:    " << sessionPath.toStdString() << " x " << iterations << std::endl;
+  std::cout << "boot:       " << bootMs << " ms" << std::endl;
+  printf("%-14s %7s %9s %9s %9s %9s %9s\n", "(ms)", "count", "mean", "p50", "p90", "p99", "max");
+  report("run -> log", samples.runToLog);
+  report("run -> done", samples.runToDone);
+  report("osc -> cue", samples.oscToCue);
+  report("log decode", logDecode);
+  report("log render", samples.logRender);
+  report("log -> paint", samples.logToPaint);
+  report("cue render", samples.cueRender);
+  report("cue -> paint", samples.cueToPaint);
+
+  return 0;
+}
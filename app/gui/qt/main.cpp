@@ -24,6 +24,7 @@
 #include "widgets/sonicpilog.h"
 
 #include "dpi.h"
+#include "api/arena.h"
 
 #ifdef _WIN32
 #include <QtPlatformHeaders\QWindowsWindowFunctions>
@@ -33,6 +34,9 @@
     #include "platform/macos.h"
 #endif
 
+// Traps heap use on the audio thread when built with ENABLE_RT_ALLOC_CHECK
+SP_RT_ALLOC_CHECK_IMPLEMENT
+
 int main(int argc, char *argv[])
 {
 
@@ -34,11 +34,14 @@
 #include <QScrollBar>
 #include <QSplitter>
 #include <QListWidget>
+#include <QListView>
 #include <QSplashScreen>
 #include <QBoxLayout>
 #include <QLabel>
 #include <QLineEdit>
 #include <QStyle>
+#include <QEventLoop>
+#include <QTimer>
 
 // QScintilla stuff
 #include <Qsci/qsciapis.h>
@@ -49,12 +52,15 @@
 #include "utils/sonicpiapis.h"
 #include "model/sonicpitheme.h"
 #include "visualizer/scope.h"
+#include "visualizer/recorder.h"
 
 #include "utils/borderlesslinksproxystyle.h"
+#include "utils/processreaper.h"
+#include "utils/helpsearchindex.h"
 
 // OSC stuff
-#include "osc/oscpkt.hh"
-#include "osc/udp.hh"
+#include "api/api.h"
+#include "api/osc/oscpkt.hh"
 #include "osc/oschandler.h"
 #include "osc/oscsender.h"
 #include "osc/sonic_pi_udp_osc_server.h"
@@ -65,6 +71,7 @@
 #include "model/settings.h"
 #include "widgets/settingswidget.h"
 #include "widgets/sonicpicontext.h"
+#include "widgets/diagnosticswidget.h"
 
 #include "utils/ruby_help.h"
 
@@ -75,7 +82,6 @@ using namespace oscpkt;// OSC specific stuff
 // Operating System Specific includes
 #if defined(Q_OS_WIN)
 #include <QtConcurrent/QtConcurrentRun>
-void sleep(int x) { Sleep((x)*1000); }
 #elif defined(Q_OS_MAC)
 #include <QtConcurrent/QtConcurrentRun>
 #else
@@ -125,6 +131,8 @@ MainWindow::MainWindow(QApplication &app, bool i18n, QSplashScreen* splash)
     updated_dark_mode_for_prefs = false;
     loaded_workspaces = false;
     is_recording = false;
+    recording_with_tap = false;
+    audioRecorder = nullptr;
     show_rec_icon_a = false;
     restoreDocPane = false;
     focusMode = false;
@@ -198,6 +206,9 @@ MainWindow::MainWindow(QApplication &app, bool i18n, QSplashScreen* splash)
     // be found in ruby_help.h:
     std::cout << "[GUI] - initialising documentation window" << std::endl;
     initDocsWindow();
+    if (helpSearch->load(":/help/search.idx")) {
+        helpSearch->restrictTo(helpUrls);
+    }
 
     //setup autocompletion
     autocomplete->loadSamples(sample_path);
@@ -270,19 +281,7 @@ MainWindow::MainWindow(QApplication &app, bool i18n, QSplashScreen* splash)
 bool MainWindow::initAndCheckPorts() {
     std::cout << "[GUI] - Discovering port numbers..." << std::endl;
 
-    QProcess* determinePortNumbers = new QProcess();
-    QStringList determine_port_numbers_send_args;
-    determine_port_numbers_send_args << port_discovery_path;
-    determinePortNumbers->start(ruby_path, determine_port_numbers_send_args);
-    determinePortNumbers->waitForFinished();
-    QTextStream determine_port_numbers_stream(determinePortNumbers->readAllStandardOutput().trimmed());
-    QString determine_port_numbers_line = determine_port_numbers_stream.readLine();
-    while (!determine_port_numbers_line.isNull()) {
-        auto parts = determine_port_numbers_line.split(": ");
-        std::cout << "[GUI] - Port entry " << parts[0].trimmed().toStdString() << " : " << parts[1].trimmed().toStdString() << QString(" : %1").arg(parts[1].trimmed().toInt()).toStdString() << std::endl;
-        port_map[parts[0].trimmed()] = parts[1].trimmed().toInt();
-        determine_port_numbers_line = determine_port_numbers_stream.readLine();
-    };
+    discoverPorts();
 
     gui_send_to_server_port   = port_map["gui-send-to-server"];
     gui_listen_to_server_port = port_map["gui-listen-to-server"];
@@ -345,6 +344,17 @@ bool MainWindow::initAndCheckPorts() {
 }
 
 
+void MainWindow::discoverPorts() {
+    port_map.clear();
+    for (const auto &port : SonicPi::API::DiscoverPorts()) {
+        port_map[QString::fromStdString(port.first)] = port.second;
+    }
+
+    for (auto itr = port_map.constBegin(); itr != port_map.constEnd(); ++itr) {
+        std::cout << "[GUI] - Port entry " << itr.key().toStdString() << " : " << itr.value() << std::endl;
+    }
+}
+
 void MainWindow::initPaths() {
     QString root_path = rootPath();
 
@@ -363,7 +373,6 @@ void MainWindow::initPaths() {
     }
 
     ruby_server_path = QDir::toNativeSeparators(root_path + "/app/server/ruby/bin/sonic-pi-server.rb");
-    port_discovery_path = QDir::toNativeSeparators(root_path + "/app/server/ruby/bin/port-discovery.rb");
     fetch_url_path = QDir::toNativeSeparators(root_path + "/app/server/ruby/bin/fetch-url.rb");
     sample_path = QDir::toNativeSeparators(root_path + "/etc/samples");
 
@@ -377,7 +386,6 @@ void MainWindow::initPaths() {
     scsynth_log_path       = QDir::toNativeSeparators(log_path + QDir::separator() + "scsynth.log");
 
     init_script_path       = QDir::toNativeSeparators(root_path + "/app/server/ruby/bin/init-script.rb");
-    exit_script_path       = QDir::toNativeSeparators(root_path + "/app/server/ruby/bin/exit-script.rb");
 
     qt_app_theme_path      = QDir::toNativeSeparators(root_path + "/app/gui/qt/theme/app.qss");
 
@@ -447,17 +455,12 @@ void MainWindow::checkForStudioMode() {
 }
 
 bool MainWindow::checkPort(int port) {
-    bool available = false;
-    oscpkt::UdpSocket sock;
-    sock.bindTo(port);
-    if ((port < 1024) || (!sock.isOk())) {
-        std::cout << "[GUI] -    port: " << port << " [Not Available]" << std::endl;
-        available = false;
-    } else {
+    bool available = SonicPi::API::PortAvailable(port);
+    if (available) {
         std::cout << "[GUI] -    port: " << port << " [OK]" << std::endl;
-        available = true;
+    } else {
+        std::cout << "[GUI] -    port: " << port << " [Not Available]" << std::endl;
     }
-    sock.close();
     return available;
 }
 
@@ -482,7 +485,7 @@ void MainWindow::showWelcomeScreen() {
         startupPane->setHtml(source);
         docWidget->show();
         docsCentral->setCurrentIndex(0);
-        helpLists[0]->setCurrentRow(0);
+        selectHelpEntry(0, 0);
         startupPane->show();
         startupPane->raise();
         startupPane->activateWindow();
@@ -573,6 +576,12 @@ void MainWindow::setupWindowStructure() {
     scopeInterface->setObjectName("scopes");
     restoreScopeState(scopeInterface->GetScopeCategories());
     settingsWidget->updateScopeNames(scopeInterface->GetScopeCategories());
+
+    audioRecorder = new AudioRecorder(scsynth_port, this);
+    connect(audioRecorder, SIGNAL(backpressureChanged(bool, int)), this, SLOT(recordingBackpressure(bool, int)));
+    connect(audioRecorder, SIGNAL(framesDropped(double)), this, SLOT(recordingFramesDropped(double)));
+    connect(audioRecorder, SIGNAL(failed(QString)), this, SLOT(recordingFailed(QString)));
+    connect(audioRecorder, SIGNAL(finished(QString, bool)), this, SLOT(recordingFinished(QString, bool)));
     QSizePolicy prefsSizePolicy(QSizePolicy::Maximum, QSizePolicy::Maximum);
     settingsWidget->setSizePolicy(prefsSizePolicy);
     prefsWidget->setWidget(settingsWidget);
@@ -756,13 +765,13 @@ void MainWindow::setupWindowStructure() {
     errorPane->document()->setMaximumBlockCount(1000);
     contextPane->document()->setMaximumBlockCount(1000);
 
-    outputPane->setTextColor(QColor(theme->color("LogForeground")));
+    outputPane->setTextColor(QColor(theme->color(SonicPiTheme::LogForeground)));
     outputPane->appendPlainText("\n");
 
-    incomingPane->setTextColor(QColor(theme->color("LogForeground")));
+    incomingPane->setTextColor(QColor(theme->color(SonicPiTheme::LogForeground)));
     incomingPane->appendPlainText("\n");
 
-    contextPane->setTextColor(QColor(theme->color("LogForeground")));
+    contextPane->setTextColor(QColor(theme->color(SonicPiTheme::LogForeground)));
     contextPane->appendPlainText("\n");
 
 
@@ -791,6 +800,17 @@ void MainWindow::setupWindowStructure() {
 
     connect(scopeWidget, SIGNAL(visibilityChanged(bool)), this, SLOT(scopeVisibilityChanged()));
 
+    diagnosticsPane = new DiagnosticsWidget;
+    connect(diagnosticsPane, SIGNAL(subscriptionChanged(bool)), this, SLOT(metricsSubscriptionChanged(bool)));
+    diagnosticsWidget = new QDockWidget(tr("Diagnostics"), this);
+    diagnosticsWidget->setFocusPolicy(Qt::NoFocus);
+    diagnosticsWidget->setAllowedAreas(Qt::RightDockWidgetArea | Qt::BottomDockWidgetArea | Qt::TopDockWidgetArea);
+    diagnosticsWidget->setFeatures(QDockWidget::DockWidgetClosable | QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable);
+    diagnosticsWidget->setWidget(diagnosticsPane);
+    diagnosticsWidget->setObjectName("diagnostics");
+    addDockWidget(Qt::BottomDockWidgetArea, diagnosticsWidget);
+    diagnosticsWidget->hide();
+
     outputWidget = new QDockWidget(tr("Log"), this);
     outputWidget->setFocusPolicy(Qt::NoFocus);
     outputWidget->setFeatures(QDockWidget::NoDockWidgetFeatures);
@@ -852,9 +872,33 @@ void MainWindow::setupWindowStructure() {
 
     addUniversalCopyShortcuts(docPane);
 
+    helpSearch = new HelpSearchIndex;
+    helpSearchBox = new QLineEdit;
+    helpSearchBox->setPlaceholderText(tr("Search help"));
+    helpSearchBox->setClearButtonEnabled(true);
+    connect(helpSearchBox, SIGNAL(textChanged(const QString &)), this, SLOT(searchHelp(const QString &)));
+    connect(helpSearchBox, SIGNAL(returnPressed()), this, SLOT(focusHelpSearchResults()));
+
+    helpSearchResults = new QListWidget;
+    connect(helpSearchResults,
+            SIGNAL(itemPressed(QListWidgetItem*)),
+            this, SLOT(updateDocPane(QListWidgetItem*)));
+    connect(helpSearchResults,
+            SIGNAL(currentItemChanged(QListWidgetItem*, QListWidgetItem*)),
+            this, SLOT(updateDocPane2(QListWidgetItem*, QListWidgetItem*)));
+    helpSearchResults->hide();
+
+    QVBoxLayout *docsListingLayout = new QVBoxLayout;
+    docsListingLayout->setMargin(0);
+    docsListingLayout->addWidget(helpSearchBox);
+    docsListingLayout->addWidget(docsCentral);
+    docsListingLayout->addWidget(helpSearchResults);
+    QWidget *docsListing = new QWidget;
+    docsListing->setLayout(docsListingLayout);
+
     docsplit = new QSplitter;
 
-    docsplit->addWidget(docsCentral);
+    docsplit->addWidget(docsListing);
     docsplit->addWidget(docPane);
 
     docWidget = new QDockWidget(tr("Help"), this);
@@ -869,6 +913,11 @@ void MainWindow::setupWindowStructure() {
     //Currently causes a segfault when dragging doc pane out of main
     //window:
     connect(docWidget, SIGNAL(visibilityChanged(bool)), this, SLOT(toggleHelpIcon()));
+    connect(docWidget, &QDockWidget::visibilityChanged, [this](bool visible) {
+        if (visible)
+            helpList(docsCentral->currentIndex());
+    });
+    connect(docsCentral, SIGNAL(currentChanged(int)), this, SLOT(helpTabShown(int)));
 
     mainWidgetLayout = new QVBoxLayout;
     mainWidgetLayout->addWidget(tabs);
@@ -1225,72 +1274,58 @@ void MainWindow::startRubyServer(){
     }
     serverProcess->start(ruby_path, args);
 
+    if (!serverProcess->waitForStarted()) {
+        invokeStartupError(tr("The Sonic Pi Server could not be started!"));
+        return;
+    }
+
 #ifdef Q_OS_WIN
     //set priority of Ruby server to be "above normal" on Windows
     QProcess::startDetached("wmic process where processid='" + QString::number(serverProcess->processId()) + "' CALL setpriority \"above normal\"");
 #endif
 
-    // Register server pid for potential zombie clearing
-    QStringList regServerArgs;
 #if QT_VERSION >= QT_VERSION_CHECK(5, 3, 0)
+    // Register server pid for potential zombie clearing. This is only
+    // needed after a crash so there's no need to wait for it to finish.
+    QStringList regServerArgs;
     regServerArgs << QDir::toNativeSeparators(rootPath() + "/app/server/ruby/bin/task-register.rb")<< QString::number(serverProcess->processId());
-#endif
     QProcess *regServerProcess = new QProcess();
+    connect(regServerProcess, SIGNAL(finished(int,QProcess::ExitStatus)), regServerProcess, SLOT(deleteLater()));
     regServerProcess->start(ruby_path, regServerArgs);
-    regServerProcess->waitForFinished();
-#if QT_VERSION >= QT_VERSION_CHECK(5, 3, 0)
-    std::cout << "[GUI] - Ruby server pid registered: "<< serverProcess->processId() << std::endl;
+    std::cout << "[GUI] - Registering Ruby server pid: "<< serverProcess->processId() << std::endl;
 #endif
-
-    if (!serverProcess->waitForStarted()) {
-        invokeStartupError(tr("The Sonic Pi Server could not be started!"));
-        return;
-    }
 }
 
 bool MainWindow::waitForServiceSync() {
-    QString contents;
     std::cout << "[GUI] - waiting for Sonic Pi Server to boot..." << std::endl;
-    bool server_booted = false;
-    if (!homeDirWritable) {
-        // we can't monitor the logs so hope for the best!
-        sleep(15);
-        server_booted = true;
-    } else {
-        for(int i = 0; i < 60; i ++) {
-            qApp->processEvents();
-            contents = readFile(server_output_log_path);
-            if (contents.contains("Sonic Pi Server successfully booted.")) {
-                std::cout << std::endl << "[GUI] - Sonic Pi Server successfully booted." << std::endl;
-                server_booted = true;
-                break;
-            } else {
-                std::cout << ".";
-                sleep(1);
-            }
-        }
-    }
-
-    if (!server_booted) {
-        std::cout << std::endl << "[GUI] - Critical error! Could not boot Sonic Pi Server." << std::endl;
-        invokeStartupError("Critical error! - Could not boot Sonic Pi Server.");
-        return false;
-    }
 
-    int timeout = 60;
-    std::cout << "[GUI] - waiting for Sonic Pi Server to respond..." << std::endl;
-    while (sonicPiOSCServer->waitForServer() && timeout-- > 0) {
-        sleep(1);
-        std::cout << ".";
-        if(sonicPiOSCServer->isIncomingPortOpen()) {
+    // The server sends /booted as soon as it is ready and the OSC handler
+    // then emits serverStarted, which ends the wait immediately. Keep
+    // pinging in case /booted went missing - the /ack reply does the same.
+    QEventLoop loop;
+    QTimer pingTimer;
+    QTimer timeoutTimer;
+    timeoutTimer.setSingleShot(true);
+
+    connect(this, SIGNAL(serverStarted()), &loop, SLOT(quit()));
+    connect(&timeoutTimer, SIGNAL(timeout()), &loop, SLOT(quit()));
+    connect(&pingTimer, &QTimer::timeout, [this, &loop]() {
+        if (!sonicPiOSCServer->waitForServer()) {
+            loop.quit();
+        } else if (sonicPiOSCServer->isIncomingPortOpen()) {
             Message msg("/ping");
             msg.pushStr(guiID.toStdString());
             msg.pushStr("QtClient/1/hello");
             sendOSC(msg);
-        } else {
-          std::cout << "!";
         }
+    });
+
+    if (sonicPiOSCServer->waitForServer()) {
+        pingTimer.start(250);
+        timeoutTimer.start(60000);
+        loop.exec();
     }
+
     if (!sonicPiOSCServer->isServerStarted()) {
         std::cout << std::endl <<  "[GUI] - Critical error! Could not connect to Sonic Pi Server." << std::endl;
         invokeStartupError("Critical server error - could not connect to Sonic Pi Server!");
@@ -1665,10 +1700,7 @@ void MainWindow::runCode()
         beautifyCode();
     }
 
-    ws->highlightCurrentLine();
-    lexer->highlightAll();
-    QTimer::singleShot(500, lexer, SLOT(unhighlightAll()));
-    QTimer::singleShot(500, ws, SLOT(unhighlightCurrentLine()));
+    ws->flashRun();
     ws->clearLineMarkers();
     resetErrorPane();
 
@@ -1714,20 +1746,7 @@ void MainWindow::beautifyCode()
 {
     statusBar()->showMessage(tr("Beautifying..."), 2000);
     SonicPiScintilla* ws = ((SonicPiScintilla*)tabs->currentWidget());
-    std::string code = ws->text().toStdString();
-    int line = 0;
-    int index = 0;
-    ws->getCursorPosition(&line, &index);
-    int first_line = ws->firstVisibleLine();
-    Message msg("/buffer-beautify");
-    msg.pushStr(guiID.toStdString());
-    std::string filename = ((SonicPiScintilla*)tabs->currentWidget())->fileName.toStdString();
-    msg.pushStr(filename);
-    msg.pushStr(code);
-    msg.pushInt32(line);
-    msg.pushInt32(index);
-    msg.pushInt32(first_line);
-    sendOSC(msg);
+    ws->beautify();
 }
 
 
@@ -1930,20 +1949,38 @@ void MainWindow::helpContext() {
 
     if (helpKeywords.contains(selection)) {
         struct help_entry entry = helpKeywords[selection];
-        QListWidget *list = helpLists[entry.pageIndex];
-
-        // force current row to be changed
-        // by setting it to a different value to
-        // entry.entryIndex and then setting it
-        // back. That way it always gets displayed
-        // in the GUI :-)
-        if (entry.entryIndex == 0) {
-            list->setCurrentRow(1);
-        } else {
-            list->setCurrentRow(0);
-        }
+        helpSearchBox->clear();
         docsCentral->setCurrentIndex(entry.pageIndex);
-        list->setCurrentRow(entry.entryIndex);
+        selectHelpEntry(entry.pageIndex, entry.entryIndex);
+    } else if (!selection.isEmpty()) {
+        // not a keyword, so fall back to searching the text of the docs
+        helpSearchBox->setText(selection);
+        focusHelpSearchResults();
+    }
+}
+
+void MainWindow::searchHelp(const QString &query) {
+    helpSearchResults->clear();
+    if (query.trimmed().isEmpty()) {
+        helpSearchResults->hide();
+        docsCentral->show();
+        return;
+    }
+
+    QVector<HelpSearchIndex::Result> results = helpSearch->search(query);
+    for (const HelpSearchIndex::Result &result : results) {
+        QListWidgetItem *item = new QListWidgetItem(result.title);
+        item->setData(32, QVariant(result.url));
+        helpSearchResults->addItem(item);
+    }
+    docsCentral->hide();
+    helpSearchResults->show();
+}
+
+void MainWindow::focusHelpSearchResults() {
+    if (helpSearchResults->count() > 0) {
+        helpSearchResults->setCurrentRow(0);
+        helpSearchResults->setFocus();
     }
 }
 
@@ -2125,7 +2162,7 @@ void MainWindow::updateColourTheme(){
     errorPane->document()->setDefaultStyleSheet(css);
 
     // update context pane
-    contextPane->setTextColor(QColor(theme->color("LogForeground")));
+    contextPane->setTextColor(QColor(theme->color(SonicPiTheme::LogForeground)));
     updateContextWithCurrentWs();
 
     // clear stylesheets
@@ -2169,8 +2206,8 @@ void MainWindow::updateColourTheme(){
         ws->redraw();
     }
 
-    scopeInterface->SetColor(theme->color("Scope"));
-    scopeInterface->SetColor2(theme->color("Scope_2"));
+    scopeInterface->SetColor(theme->color(SonicPiTheme::Scope));
+    scopeInterface->SetColor2(theme->color(SonicPiTheme::Scope_2));
     lexer->unhighlightAll();
 
 
@@ -2541,7 +2578,7 @@ void  MainWindow::createToolBar()
     // Record
     recAct = new QAction(theme->getRecIcon(false, false), tr("Start Recording"), this);
     recSc = new QShortcut(shiftMetaKey('R'), this, SLOT(toggleRecording()));
-    updateAction(recAct, recSc, tr("Start recording to a WAV audio file"));
+    updateAction(recAct, recSc, tr("Start recording to a WAV, FLAC or Opus audio file"));
     connect(recAct, SIGNAL(triggered()), this, SLOT(toggleRecording()));
 
     // Save
@@ -2796,6 +2833,8 @@ void  MainWindow::createToolBar()
       connect(act, SIGNAL(triggered()), this, SLOT(scopeKindVisibilityMenuChanged()));
       scopeKindVisibilityMenu->addAction(act);
     }
+    displayMenu->addSeparator();
+    displayMenu->addAction(diagnosticsWidget->toggleViewAction());
 
 
     ioMenu = menuBar()->addMenu(tr("IO"));
@@ -3098,44 +3137,126 @@ void MainWindow::toggleRecordingOnIcon() {
 
 /**
  * Start or Stop recording
+ *
+ * The file is chosen up front. WAV is recorded by the server and saved
+ * when we stop; FLAC and Opus are encoded here as they play, from a tap
+ * the server feeds into the shared memory scope buffers.
  */
 void MainWindow::toggleRecording() {
-    is_recording = !is_recording;
-    if(is_recording) {
+    if(!is_recording) {
+        QSettings settings(QSettings::IniFormat, QSettings::UserScope, "sonic-pi.net", "gui-settings");
+        QString lastDir = settings.value("lastDir", QDir::homePath() + "/Desktop").toString();
+        QString flacFilter = tr("FLAC (*.flac)");
+        QString opusFilter = tr("Opus (*.opus)");
+        QString wavFilter = tr("Wavefile (*.wav)");
+        QString selfilter = settings.value("lastRecordingFilter", wavFilter).toString();
+        QString fileName = QFileDialog::getSaveFileName(this, tr("Save Recording"), lastDir, QString("%1;;%2;;%3").arg(wavFilter).arg(flacFilter).arg(opusFilter), &selfilter);
+        if (fileName.isEmpty()) {
+            return;
+        }
+
+        QFileInfo fi=fileName;
+        if (fi.suffix().isEmpty()) {
+            if (selfilter == flacFilter) {
+                fileName += ".flac";
+            } else if (selfilter == opusFilter) {
+                fileName += ".opus";
+            } else {
+                fileName += ".wav";
+            }
+        }
+        settings.setValue("lastDir", fi.dir().absolutePath());
+        settings.setValue("lastRecordingFilter", selfilter);
+
+        AudioRecorder::Format format;
+        recording_path = fileName;
+        recording_with_tap = AudioRecorder::FormatForPath(fileName, format);
+
+        is_recording = true;
         updateAction(recAct, recSc, tr("Stop Recording"), tr("Stop Recording"));
-        // recAct->setStatusTip(tr("Stop Recording"));
-        // recAct->setToolTip(tr("Stop Recording"));
-        // recAct->setText(tr("Stop Recording"));
         rec_flash_timer->start(500);
-        Message msg("/start-recording");
+
+        // For FLAC and Opus the recorder starts once the server replies
+        // with /recording-tap (see recordingTapReady)
+        Message msg(recording_with_tap ? "/start-recording-tap" : "/start-recording");
         msg.pushStr(guiID.toStdString());
         sendOSC(msg);
     } else {
+        is_recording = false;
         rec_flash_timer->stop();
         updateAction(recAct, recSc, tr("Start Recording"), tr("Start Recording"));
         recAct->setIcon( theme->getRecIcon(is_recording, false));
 
-        Message msg("/stop-recording");
-        msg.pushStr(guiID.toStdString());
-        sendOSC(msg);
-        QSettings settings(QSettings::IniFormat, QSettings::UserScope, "sonic-pi.net", "gui-settings");
-        QString lastDir = settings.value("lastDir", QDir::homePath() + "/Desktop").toString();
-        QString fileName = QFileDialog::getSaveFileName(this, tr("Save Recording"), lastDir, tr("Wavefile (*.wav)"));
-        if (!fileName.isEmpty()) {
-            QFileInfo fi=fileName;
-            settings.setValue("lastDir", fi.dir().absolutePath());
-            Message msg("/save-recording");
+        if (recording_with_tap) {
+            // The recorder may never have started (the server hadn't
+            // replied yet, or Start failed), in which case there's no
+            // file. Otherwise the encoder may still have a backlog to
+            // write, so recordingFinished says when it's saved
+            if (audioRecorder->IsRecording()) {
+                audioRecorder->Finish();
+            }
+            Message msg("/stop-recording-tap");
             msg.pushStr(guiID.toStdString());
-            msg.pushStr(fileName.toStdString());
             sendOSC(msg);
         } else {
-            Message msg("/delete-recording");
+            Message msg("/stop-recording");
             msg.pushStr(guiID.toStdString());
             sendOSC(msg);
+            Message saveMsg("/save-recording");
+            saveMsg.pushStr(guiID.toStdString());
+            saveMsg.pushStr(recording_path.toStdString());
+            sendOSC(saveMsg);
         }
     }
 }
 
+void MainWindow::recordingTapReady(int scopeNum, int sampleRate, int frames) {
+    if (!is_recording || !recording_with_tap || audioRecorder->IsRecording()) {
+        // Stopped before the server got back to us
+        if (scopeNum >= 0) {
+            Message msg("/stop-recording-tap");
+            msg.pushStr(guiID.toStdString());
+            sendOSC(msg);
+        }
+        return;
+    }
+
+    QString error;
+    AudioRecorder::Format format;
+    AudioRecorder::FormatForPath(recording_path, format);
+    if (scopeNum < 0) {
+        error = tr("The server is already recording");
+    } else if (audioRecorder->Start(recording_path, format, scopeNum, sampleRate, frames, error)) {
+        return;
+    }
+    recordingFailed(error);
+}
+
+void MainWindow::recordingBackpressure(bool behind, int percentBuffered) {
+    if (behind) {
+        statusBar()->showMessage(tr("Recording is falling behind, %1% buffered...").arg(percentBuffered), 5000);
+    } else {
+        statusBar()->showMessage(tr("Recording caught up"), 2000);
+    }
+}
+
+void MainWindow::recordingFramesDropped(double seconds) {
+    statusBar()->showMessage(tr("Recording couldn't keep up, dropped %1s of audio").arg(seconds, 0, 'f', 2), 5000);
+}
+
+void MainWindow::recordingFinished(QString path, bool saved) {
+    if (saved) {
+        statusBar()->showMessage(tr("Saved recording to %1").arg(path), 5000);
+    }
+}
+
+void MainWindow::recordingFailed(QString error) {
+    if (is_recording && recording_with_tap) {
+        toggleRecording();
+    }
+    statusBar()->showMessage(tr("Recording failed: %1").arg(error), 10000);
+}
+
 
 void MainWindow::createStatusBar()
 {
@@ -3357,29 +3478,44 @@ void MainWindow::onExitCleanup()
     {
         scopeInterface->ShutDown();
     }
-    setupLogPathAndRedirectStdOut();
-    std::cout << "[GUI] - stopping OSC server" << std::endl;
-    sonicPiOSCServer->stop();
-    if(protocol == TCP){
-        clientSock->close();
+    if (audioRecorder)
+    {
+        // Finish the file while the tap is still being fed, waiting for
+        // the encoder to get any backlog (or an earlier file) to disk
+        audioRecorder->Stop();
     }
+    setupLogPathAndRedirectStdOut();
     if(serverProcess->state() == QProcess::NotRunning) {
         std::cout << "[GUI] - warning, server process is not running." << std::endl;
     } else {
         if (loaded_workspaces) {
-            // this should be a synchorous call to avoid the following sleep
+            // The server writes out all queued saves before it
+            // acknowledges the /exit below
             saveWorkspaces();
         }
-        sleep(1);
         std::cout << "[GUI] - asking server process to exit..." << std::endl;
         Message msg("/exit");
         msg.pushStr(guiID.toStdString());
         sendOSC(msg);
+        if (!waitForServerExit()) {
+            std::cout << "[GUI] - server didn't acknowledge exit in time" << std::endl;
+        }
+    }
+
+    std::cout << "[GUI] - stopping OSC server" << std::endl;
+    sonicPiOSCServer->stop();
+    if(protocol == TCP){
+        clientSock->close();
     }
     if(protocol == UDP){
         osc_thread.waitForFinished();
     }
-    sleep(2);
+
+    // Give the server a moment to run its at_exit hooks (which ask
+    // scsynth to quit) before any remaining children are reaped
+    if(serverProcess->state() != QProcess::NotRunning) {
+        serverProcess->waitForFinished(1000);
+    }
 
     // ensure all child processes are nuked if they didn't die gracefully
     cleanupRunningProcesses();
@@ -3388,12 +3524,31 @@ void MainWindow::onExitCleanup()
     std::cout.rdbuf(coutbuf); // reset to stdout before exiting
 }
 
+bool MainWindow::waitForServerExit()
+{
+    // The OSC handler emits serverExited when /exited arrives. Saves are
+    // flushed first on the server, so allow a generous upper bound for a
+    // slow disk - a healthy server replies almost immediately.
+    QEventLoop loop;
+    QTimer timeoutTimer;
+    timeoutTimer.setSingleShot(true);
+
+    connect(this, SIGNAL(serverExited()), &loop, SLOT(quit()));
+    connect(&timeoutTimer, SIGNAL(timeout()), &loop, SLOT(quit()));
+    connect(serverProcess, SIGNAL(finished(int,QProcess::ExitStatus)), &loop, SLOT(quit()));
+
+    if (sonicPiOSCServer->continueListening()) {
+        timeoutTimer.start(5000);
+        loop.exec();
+    }
+
+    return !sonicPiOSCServer->continueListening() || serverProcess->state() == QProcess::NotRunning;
+}
+
 void MainWindow::cleanupRunningProcesses()
 {
-    std::cout << "[GUI] - executing exit script" << std::endl;
-    QProcess* exitProcess = new QProcess();
-    exitProcess->start(ruby_path, QStringList(exit_script_path));
-    exitProcess->waitForFinished();
+    std::cout << "[GUI] - clearing registered processes" << std::endl;
+    ProcessReaper::reapRegistered(1000);
 }
 
 void MainWindow::heartbeatOSC() {
@@ -3404,6 +3559,8 @@ void MainWindow::heartbeatOSC() {
 
 
 void MainWindow::updateDocPane(QListWidgetItem *cur) {
+    if (!cur)
+        return;
     QString url = cur->data(32).toString();
     docPane->setSource(QUrl(url));
 }
@@ -3413,45 +3570,68 @@ void MainWindow::updateDocPane2(QListWidgetItem *cur, QListWidgetItem *prev) {
     updateDocPane(cur);
 }
 
-void MainWindow::addHelpPage(QListWidget *nameList,
-        struct help_page *helpPages, int len) {
+void MainWindow::updateDocPaneIndex(const QModelIndex &cur) {
+    if (!cur.isValid())
+        return;
+    docPane->setSource(QUrl(cur.data(HelpListModel::UrlRole).toString()));
+}
+
+void MainWindow::updateDocPaneIndex2(const QModelIndex &cur, const QModelIndex &prev) {
+    (void)prev;
+    updateDocPaneIndex(cur);
+}
+
+// The page tables are static data generated into ruby_help.h, so all
+// that's needed up front is a model over them and the keyword lookup
+// for helpContext. Views are created when the tab is first shown.
+void MainWindow::addHelpPage(int tab,
+        const struct help_page *helpPages, int len) {
     int i;
     struct help_entry entry;
-    entry.pageIndex = docsCentral->count()-1;
+    entry.pageIndex = tab;
 
-    for(i = 0; i < len; i++) {
-        QListWidgetItem *item = new QListWidgetItem(helpPages[i].title);
-        item->setData(32, QVariant(helpPages[i].url));
-        nameList->addItem(item);
-        entry.entryIndex = nameList->count()-1;
+    helpModels[tab] = new HelpListModel(helpPages, len, this);
 
+    for(i = 0; i < len; i++) {
+        helpUrls.insert(QString::fromUtf8(helpPages[i].url));
         if (helpPages[i].keyword != NULL) {
-            helpKeywords.insert(helpPages[i].keyword, entry);
-            // magic numbers ahoy
-            // to be revamped along with the help system
-            switch (entry.pageIndex) {
-                case 2:
-                    autocomplete->addSymbol(SonicPiAPIs::Synth, helpPages[i].keyword);
-                    break;
-                case 3:
-                    autocomplete->addSymbol(SonicPiAPIs::FX, helpPages[i].keyword);
-                    break;
-                case 5:
-                    autocomplete->addKeyword(SonicPiAPIs::Func, helpPages[i].keyword);
-                    break;
-            }
+            entry.entryIndex = i;
+            helpKeywords.insert(QString::fromUtf8(helpPages[i].keyword), entry);
         }
     }
 }
 
-QListWidget *MainWindow::createHelpTab(QString name) {
-    QListWidget *nameList = new QListWidget;
-    connect(nameList,
-            SIGNAL(itemPressed(QListWidgetItem*)),
-            this, SLOT(updateDocPane(QListWidgetItem*)));
+int MainWindow::createHelpTab(QString name) {
+    QBoxLayout *layout = new QBoxLayout(QBoxLayout::LeftToRight);
+    layout->setStretch(1, 1);
+    QWidget *tabWidget = new QWidget;
+    tabWidget->setLayout(layout);
+    helpModels.append(NULL);
+    helpLists.append(NULL);
+    return docsCentral->addTab(tabWidget, name);
+}
+
+void MainWindow::helpTabShown(int index) {
+    if (docWidget->isVisible())
+        helpList(index);
+}
+
+QListView *MainWindow::helpList(int tab) {
+    if (tab < 0 || tab >= helpLists.size() || !helpModels[tab])
+        return NULL;
+    if (helpLists[tab])
+        return helpLists[tab];
+
+    QListView *nameList = new QListView;
+    // every row is a single line of text, so don't measure them all
+    nameList->setUniformItemSizes(true);
+    nameList->setModel(helpModels[tab]);
     connect(nameList,
-            SIGNAL(currentItemChanged(QListWidgetItem*, QListWidgetItem*)),
-            this, SLOT(updateDocPane2(QListWidgetItem*, QListWidgetItem*)));
+            SIGNAL(pressed(const QModelIndex &)),
+            this, SLOT(updateDocPaneIndex(const QModelIndex &)));
+    connect(nameList->selectionModel(),
+            SIGNAL(currentChanged(const QModelIndex &, const QModelIndex &)),
+            this, SLOT(updateDocPaneIndex2(const QModelIndex &, const QModelIndex &)));
 
     QShortcut *up = new QShortcut(ctrlKey('p'), nameList);
     up->setContext(Qt::WidgetShortcut);
@@ -3460,32 +3640,47 @@ QListWidget *MainWindow::createHelpTab(QString name) {
     down->setContext(Qt::WidgetShortcut);
     connect(down, SIGNAL(activated()), this, SLOT(helpScrollDown()));
 
-    QBoxLayout *layout = new QBoxLayout(QBoxLayout::LeftToRight);
-    layout->addWidget(nameList);
-    layout->setStretch(1, 1);
-    QWidget *tabWidget = new QWidget;
-    tabWidget->setLayout(layout);
-    docsCentral->addTab(tabWidget, name);
-    helpLists.append(nameList);
+    docsCentral->widget(tab)->layout()->addWidget(nameList);
+    helpLists[tab] = nameList;
     return nameList;
 }
 
+// Makes the given entry current and always shows it, even if it was
+// already current
+void MainWindow::selectHelpEntry(int tab, int row) {
+    QListView *list = helpList(tab);
+    if (!list)
+        return;
+    QModelIndex index = helpModels[tab]->index(row);
+    if (list->currentIndex() == index) {
+        updateDocPaneIndex(index);
+    } else {
+        list->setCurrentIndex(index);
+    }
+}
+
 void MainWindow::helpScrollUp() {
     int section = docsCentral->currentIndex();
-    int entry = helpLists[section]->currentRow();
+    QListView *list = helpList(section);
+    if (!list)
+        return;
+    int entry = list->currentIndex().row();
 
     if (entry > 0)
         entry--;
-    helpLists[section]->setCurrentRow(entry);
+    list->setCurrentIndex(helpModels[section]->index(entry));
 }
 
 void MainWindow::helpScrollDown() {
     int section = docsCentral->currentIndex();
-    int entry = helpLists[section]->currentRow();
+    QListView *list = helpList(section);
+    if (!list)
+        return;
+    int entry = list->currentIndex().row();
 
-    if (entry < helpLists[section]->count()-1)
+    if (entry < helpModels[section]->rowCount()-1)
         entry++;
-    helpLists[section]->setCurrentRow(entry);
+    list->setCurrentIndex(helpModels[section]->index(entry));
 }
 
 void MainWindow::docPrevTab() {
@@ -3756,6 +3951,19 @@ void MainWindow::zoomOutLogs() {
     contextPane->zoomOut();
 }
 
+void MainWindow::updateMetrics(QString source, QStringList names, QVariantList values) {
+    diagnosticsPane->updateMetrics(source, names, values);
+}
+
+// Ask the server to publish its and sp_midi's metrics only while the
+// diagnostics pane is visible
+void MainWindow::metricsSubscriptionChanged(bool subscribed) {
+    Message msg("/metrics-subscribe");
+    msg.pushStr(guiID.toStdString());
+    msg.pushInt32(subscribed ? 1 : 0);
+    sendOSC(msg);
+}
+
 void MainWindow::updateMIDIInPorts(QString port_info) {
     QString input_header = tr("Connected MIDI inputs") + ":\n\n";
     settingsWidget->updateMidiInPorts(input_header + port_info);
@@ -18,7 +18,8 @@
 #include <QMainWindow>
 #include <QFuture>
 #include <QSet>
-#include "osc/oscpkt.hh"
+#include "api/osc/oscpkt.hh"
+#include "model/helplistmodel.h"
 #include <fstream>
 #include <QIcon>
 #include <vector>
@@ -38,6 +39,8 @@ class OscSender;
 class QShortcut;
 class QDockWidget;
 class QListWidget;
+class QListView;
+class QModelIndex;
 class QListWidgetItem;
 class QSignalMapper;
 class QTabWidget;
@@ -50,6 +53,7 @@ class QLabel;
 class InfoWidget;
 class SettingsWidget;
 class Scope;
+class AudioRecorder;
 class SonicPiAPIs;
 class SonicPiLog;
 class SonicPiScintilla;
@@ -58,12 +62,8 @@ class SonicPiTheme;
 class SonicPiLexer;
 class SonicPiSettings;
 class SonicPiContext;
-
-struct help_page {
-    QString title;
-    QString keyword;
-    QString url;
-};
+class DiagnosticsWidget;
+class HelpSearchIndex;
 
 struct help_entry {
     int pageIndex;
@@ -96,6 +96,8 @@ class MainWindow : public QMainWindow
 
 signals:
         void settingsChanged();
+        void serverStarted();
+        void serverExited();
 
        private slots:
 
@@ -148,6 +150,11 @@ signals:
         void onExitCleanup();
         void toggleRecording();
         void toggleRecordingOnIcon();
+        void recordingTapReady(int scopeNum, int sampleRate, int frames);
+        void recordingBackpressure(bool behind, int percentBuffered);
+        void recordingFramesDropped(double seconds);
+        void recordingFailed(QString error);
+        void recordingFinished(QString path, bool saved);
         void changeSystemPreAmp(int val, int silent=0);
         void changeGUITransparency(int val);
         void changeShowLineNumbers();
@@ -193,6 +200,9 @@ signals:
         void togglePrefs();
         void updateDocPane(QListWidgetItem *cur);
         void updateDocPane2(QListWidgetItem *cur, QListWidgetItem *prev);
+        void updateDocPaneIndex(const QModelIndex &cur);
+        void updateDocPaneIndex2(const QModelIndex &cur, const QModelIndex &prev);
+        void helpTabShown(int index);
         void showWindow();
         void splashClose();
         void setMessageBoxStyle();
@@ -204,6 +214,8 @@ signals:
         void tabPrev();
         void tabGoto(int index);
         void helpContext();
+        void searchHelp(const QString &query);
+        void focusHelpSearchResults();
         void resetErrorPane();
         void helpScrollUp();
         void helpScrollDown();
@@ -245,6 +257,8 @@ signals:
         void honourPrefs();
         void updateMIDIInPorts(QString port_info);
         void updateMIDIOutPorts(QString port_info);
+        void updateMetrics(QString source, QStringList names, QVariantList values);
+        void metricsSubscriptionChanged(bool subscribed);
 
         void showError(QString msg);
         void showBufferCapacityError();
@@ -261,6 +275,7 @@ signals:
 
     private:
         bool initAndCheckPorts();
+        void discoverPorts();
         void initPaths();
         bool checkPort(int port);
         QString osDescription();
@@ -269,6 +284,7 @@ signals:
         void startRubyServer();
         void cleanupRunningProcesses();
         bool waitForServiceSync();
+        bool waitForServerExit();
         void clearOutputPanels();
         void createShortcuts();
         void createToolBar();
@@ -290,9 +306,11 @@ signals:
         //   void initPrefsWindow();
         void initDocsWindow();
         void refreshDocContent();
-        void addHelpPage(QListWidget *nameList, struct help_page *helpPages,
+        void addHelpPage(int tab, const struct help_page *helpPages,
                 int len);
-        QListWidget *createHelpTab(QString name);
+        int createHelpTab(QString name);
+        QListView *helpList(int tab);
+        void selectHelpEntry(int tab, int row);
         QKeySequence metaKey(char key);
         Qt::Modifier metaKeyModifier();
         QKeySequence shiftMetaKey(char key);
@@ -323,6 +341,9 @@ signals:
         bool is_recording;
         bool show_rec_icon_a;
         QTimer *rec_flash_timer;
+        AudioRecorder *audioRecorder;
+        QString recording_path;
+        bool recording_with_tap;
 
 #ifdef Q_OS_MAC
         QMainWindow* splash;
@@ -352,6 +373,8 @@ signals:
         QWidget *mainWidget;
         QDockWidget *scopeWidget;
         QDockWidget *visualizerWidget;
+        QDockWidget *diagnosticsWidget;
+        DiagnosticsWidget *diagnosticsPane;
         bool hidingDocPane;
         bool restoreDocPane;
 
@@ -376,13 +399,19 @@ signals:
         QTextEdit *startupPane;
         QVBoxLayout *mainWidgetLayout;
 
-        QList<QListWidget *> helpLists;
+        // Help list views are only created when their tab is first shown
+        QList<HelpListModel *> helpModels;
+        QList<QListView *> helpLists;
         QHash<QString, help_entry> helpKeywords;
+        QSet<QString> helpUrls;
+        HelpSearchIndex *helpSearch;
+        QLineEdit *helpSearchBox;
+        QListWidget *helpSearchResults;
         std::streambuf *coutbuf;
         std::ofstream stdlog;
 
         SonicPiAPIs *autocomplete;
-        QString fetch_url_path, sample_path, log_path, sp_user_path, sp_user_tmp_path, ruby_server_path, ruby_path, server_error_log_path, server_output_log_path, gui_log_path, scsynth_log_path, init_script_path, exit_script_path, tmp_file_store, process_log_path, port_discovery_path, qt_app_theme_path, qt_browser_dark_css, qt_browser_light_css, qt_browser_hc_css;
+        QString fetch_url_path, sample_path, log_path, sp_user_path, sp_user_tmp_path, ruby_server_path, ruby_path, server_error_log_path, server_output_log_path, gui_log_path, scsynth_log_path, init_script_path, tmp_file_store, process_log_path, qt_app_theme_path, qt_browser_dark_css, qt_browser_light_css, qt_browser_hc_css;
         QString defaultTextBrowserStyle;
 
         QString version;
@@ -0,0 +1,48 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+#include "helplistmodel.h"
+
+HelpListModel::HelpListModel(const struct help_page *pages, int len, QObject *parent)
+    : QAbstractListModel(parent), pages(pages), len(len)
+{
+}
+
+int HelpListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : len;
+}
+
+QVariant HelpListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= len) {
+        return QVariant();
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString::fromUtf8(pages[index.row()].title);
+    case UrlRole:
+        return url(index.row());
+    default:
+        return QVariant();
+    }
+}
+
+QString HelpListModel::url(int row) const
+{
+    if (row < 0 || row >= len) {
+        return QString();
+    }
+    return QString::fromUtf8(pages[row].url);
+}
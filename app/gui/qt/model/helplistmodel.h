@@ -0,0 +1,48 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+#ifndef HELPLISTMODEL_H
+#define HELPLISTMODEL_H
+
+#include <QAbstractListModel>
+
+// One entry in a help tab. The tables of these are generated into
+// ruby_help.h as static data, so all strings are UTF-8 literals.
+struct help_page {
+    const char *title;
+    const char *keyword;
+    const char *url;
+};
+
+// Read-only list model over a static help_page table. Nothing is
+// copied - rows are only turned into QStrings when a view asks for them.
+class HelpListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum { UrlRole = Qt::UserRole };
+
+    HelpListModel(const struct help_page *pages, int len, QObject *parent = 0);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    QString url(int row) const;
+
+private:
+    const struct help_page *pages;
+    int len;
+};
+
+#endif
@@ -191,16 +191,19 @@ QString SonicPiTheme::getName() {
 
 void SonicPiTheme::darkMode(){
   this->theme = withCustomSettings(darkTheme());
+  compileColors();
   this->css = ScalePxInStyleSheet(readFile(qt_browser_dark_css));
 }
 
 void SonicPiTheme::lightMode(){
   this->theme = withCustomSettings(lightTheme());
+  compileColors();
   this->css = ScalePxInStyleSheet(readFile(qt_browser_light_css));
 }
 
 void SonicPiTheme::hcMode(){
   this->theme = withCustomSettings(highContrastTheme());
+  compileColors();
   this->css = ScalePxInStyleSheet(readFile(qt_browser_hc_css));
 }
 
@@ -835,27 +838,44 @@ QMap<QString, QString> SonicPiTheme::highContrastTheme(){
 
 QPalette SonicPiTheme::createPalette() {
     QPalette p = QApplication::palette();
-    p.setColor(QPalette::WindowText,      color("WindowForeground"));
-    p.setColor(QPalette::Window,          color("WindowBackground"));
-    p.setColor(QPalette::Base,            color("Base"));
-    p.setColor(QPalette::AlternateBase,   color("AlternateBase"));
-    p.setColor(QPalette::Text,            color("Foreground"));
-    p.setColor(QPalette::HighlightedText, color("HighlightedForeground"));
-    p.setColor(QPalette::Highlight,       color("HighlightedBackground"));
-    p.setColor(QPalette::ToolTipBase,     color("ToolTipBase"));
-    p.setColor(QPalette::ToolTipText,     color("ToolTipText"));
-    p.setColor(QPalette::Button,          color("Button"));
-    p.setColor(QPalette::ButtonText,      color("ButtonText"));
-    p.setColor(QPalette::Shadow,          color("Shadow"));
-    p.setColor(QPalette::Light,           color("Light"));
-    p.setColor(QPalette::Midlight,        color("Midlight"));
-    p.setColor(QPalette::Mid,             color("Mid"));
-    p.setColor(QPalette::Dark,            color("Dark"));
-    p.setColor(QPalette::Link,            color("Link"));
-    p.setColor(QPalette::LinkVisited,     color("LinkVisited"));
+    p.setColor(QPalette::WindowText,      color(WindowForeground));
+    p.setColor(QPalette::Window,          color(WindowBackground));
+    p.setColor(QPalette::Base,            color(Base));
+    p.setColor(QPalette::AlternateBase,   color(AlternateBase));
+    p.setColor(QPalette::Text,            color(Foreground));
+    p.setColor(QPalette::HighlightedText, color(HighlightedForeground));
+    p.setColor(QPalette::Highlight,       color(HighlightedBackground));
+    p.setColor(QPalette::ToolTipBase,     color(ToolTipBase));
+    p.setColor(QPalette::ToolTipText,     color(ToolTipText));
+    p.setColor(QPalette::Button,          color(Button));
+    p.setColor(QPalette::ButtonText,      color(ButtonText));
+    p.setColor(QPalette::Shadow,          color(Shadow));
+    p.setColor(QPalette::Light,           color(Light));
+    p.setColor(QPalette::Midlight,        color(Midlight));
+    p.setColor(QPalette::Mid,             color(Mid));
+    p.setColor(QPalette::Dark,            color(Dark));
+    p.setColor(QPalette::Link,            color(Link));
+    p.setColor(QPalette::LinkVisited,     color(LinkVisited));
     return p;
 }
 
+#define SONIC_PI_THEME_COLOR_NAME(name) #name,
+static const char *colorNames[SonicPiTheme::NumColors] = {
+    SONIC_PI_THEME_COLORS(SONIC_PI_THEME_COLOR_NAME)
+};
+#undef SONIC_PI_THEME_COLOR_NAME
+
+QString SonicPiTheme::colorName(Color c){
+    return QString(colorNames[c]);
+}
+
+void SonicPiTheme::compileColors(){
+    for(int i = 0; i < NumColors; i++) {
+        colors[i] = QColor(theme.value(colorNames[i]));
+    }
+}
+
+// Slow path for keys only known at runtime - prefer color(Color)
 QColor SonicPiTheme::color(QString key){
     return theme[key];
 }
@@ -870,47 +890,47 @@ QString SonicPiTheme::getAppStylesheet() {
     // A hack to fix up for dpi
     appStyling = ScalePxInStyleSheet(appStyling);
 
-    QString windowColor = this->color("WindowBackground").name();
-    QString windowForegroundColor = this->color("WindowForeground").name();
-    QString paneColor = this->color("PaneBackground").name();
-    QString logForegroundColor = this->color("LogForeground").name();
-    QString logBackgroundColor = this->color("LogBackground").name();
-    QString windowBorderColor = this->color("WindowBorder").name();
-    QString windowInternalBorderColor = this->color("WindowInternalBorder").name();
-
-    QString buttonColor = this->color("Button").name();
-    QString buttonBorderColor = this->color("ButtonBorder").name();
-    QString buttonTextColor = this->color("ButtonText").name();
-    QString pressedButtonColor = this->color("PressedButton").name();
-    QString pressedButtonTextColor = this->color("PressedButtonText").name();
-
-    QString scrollBarColor = this->color("ScrollBar").name();
-    QString scrollBarBackgroundColor = this->color("ScrollBarBackground").name();
-
-    QString tabColor = this->color("Tab").name();
-    QString tabTextColor = this->color("TabText").name();
-    QString tabSelectedColor = this->color("TabSelected").name();
-    QString tabSelectedTextColor = this->color("TabSelectedText").name();
-
-    QString toolTipTextColor = this->color("ToolTipText").name();
-    QString toolTipBaseColor = this->color("ToolTipBase").name();
-
-    QString statusBarColor = this->color("StatusBar").name();
-    QString statusBarTextColor = this->color("StatusBarText").name();
-
-    QString sliderColor = this->color("Slider").name();
-    QString sliderBackgroundColor = this->color("SliderBackground").name();
-    QString sliderBorderColor = this->color("SliderBorder").name();
-
-    QString menuColor = this->color("Menu").name();
-    QString menuTextColor = this->color("MenuText").name();
-    QString menuSelectedColor = this->color("MenuSelected").name();
-    QString menuSelectedTextColor = this->color("MenuSelectedText").name();
-    QString menuBarColor = this->color("MenuBar").name();
-
-    QString selectionForegroundColor = this->color("SelectionForeground").name();
-    QString selectionBackgroundColor = this->color("SelectionBackground").name();
-    QString errorBackgroundColor = this->color("ErrorBackground").name();
+    QString windowColor = this->color(WindowBackground).name();
+    QString windowForegroundColor = this->color(WindowForeground).name();
+    QString paneColor = this->color(PaneBackground).name();
+    QString logForegroundColor = this->color(LogForeground).name();
+    QString logBackgroundColor = this->color(LogBackground).name();
+    QString windowBorderColor = this->color(WindowBorder).name();
+    QString windowInternalBorderColor = this->color(WindowInternalBorder).name();
+
+    QString buttonColor = this->color(Button).name();
+    QString buttonBorderColor = this->color(ButtonBorder).name();
+    QString buttonTextColor = this->color(ButtonText).name();
+    QString pressedButtonColor = this->color(PressedButton).name();
+    QString pressedButtonTextColor = this->color(PressedButtonText).name();
+
+    QString scrollBarColor = this->color(ScrollBar).name();
+    QString scrollBarBackgroundColor = this->color(ScrollBarBackground).name();
+
+    QString tabColor = this->color(Tab).name();
+    QString tabTextColor = this->color(TabText).name();
+    QString tabSelectedColor = this->color(TabSelected).name();
+    QString tabSelectedTextColor = this->color(TabSelectedText).name();
+
+    QString toolTipTextColor = this->color(ToolTipText).name();
+    QString toolTipBaseColor = this->color(ToolTipBase).name();
+
+    QString statusBarColor = this->color(StatusBar).name();
+    QString statusBarTextColor = this->color(StatusBarText).name();
+
+    QString sliderColor = this->color(Slider).name();
+    QString sliderBackgroundColor = this->color(SliderBackground).name();
+    QString sliderBorderColor = this->color(SliderBorder).name();
+
+    QString menuColor = this->color(Menu).name();
+    QString menuTextColor = this->color(MenuText).name();
+    QString menuSelectedColor = this->color(MenuSelected).name();
+    QString menuSelectedTextColor = this->color(MenuSelectedText).name();
+    QString menuBarColor = this->color(MenuBar).name();
+
+    QString selectionForegroundColor = this->color(SelectionForeground).name();
+    QString selectionBackgroundColor = this->color(SelectionBackground).name();
+    QString errorBackgroundColor = this->color(ErrorBackground).name();
 
     appStyling.replace("fixedWidthFont", "\"Hack\"");
 
@@ -19,15 +19,161 @@
 #include <QColor>
 #include <QPalette>
 #include <QIcon>
+
+// Every colour a theme can define. Expanded below into the
+// SonicPiTheme::Color enum and the matching key names used in the theme
+// maps and custom theme settings files.
+#define SONIC_PI_THEME_COLORS(X) \
+    X(AlternateBase) \
+    X(Background) \
+    X(BackticksBackground) \
+    X(BackticksForeground) \
+    X(Base) \
+    X(BraceForeground) \
+    X(Button) \
+    X(ButtonBorder) \
+    X(ButtonText) \
+    X(CaretForeground) \
+    X(CaretLineBackground) \
+    X(ClassNameBackground) \
+    X(ClassNameForeground) \
+    X(ClassVariableBackground) \
+    X(ClassVariableForeground) \
+    X(CommentBackground) \
+    X(CommentForeground) \
+    X(CueDataBackground) \
+    X(CueDataForeground) \
+    X(CuePathBackground) \
+    X(CuePathForeground) \
+    X(Dark) \
+    X(DataSectionBackground) \
+    X(DataSectionForeground) \
+    X(DefaultBackground) \
+    X(DefaultForeground) \
+    X(DemotedKeywordBackground) \
+    X(DemotedKeywordForeground) \
+    X(DocumentDelimiterBackground) \
+    X(DoubleQuotedStringBackground) \
+    X(DoubleQuotedStringForeground) \
+    X(ErrorBackground) \
+    X(FoldMarginForeground) \
+    X(Foreground) \
+    X(FunctionMethodNameBackground) \
+    X(FunctionMethodNameForeground) \
+    X(GlobalBackground) \
+    X(GlobalForeground) \
+    X(HereDocumentBackground) \
+    X(HereDocumentDelimiterBackground) \
+    X(HereDocumentDelimiterForeground) \
+    X(HereDocumentForeground) \
+    X(HighlightedBackground) \
+    X(HighlightedForeground) \
+    X(IndentationGuidesForeground) \
+    X(InstanceVariableBackground) \
+    X(InstanceVariableForeground) \
+    X(KeywordBackground) \
+    X(KeywordForeground) \
+    X(Light) \
+    X(Link) \
+    X(LinkVisited) \
+    X(LogBackground) \
+    X(LogBackground_1) \
+    X(LogBackground_2) \
+    X(LogBackground_3) \
+    X(LogBackground_4) \
+    X(LogBackground_5) \
+    X(LogBackground_6) \
+    X(LogForeground) \
+    X(LogForeground_1) \
+    X(LogForeground_2) \
+    X(LogForeground_3) \
+    X(LogForeground_4) \
+    X(LogForeground_5) \
+    X(LogForeground_6) \
+    X(LogInfoBackground) \
+    X(LogInfoBackground_1) \
+    X(LogInfoForeground) \
+    X(LogInfoForeground_1) \
+    X(MarginBackground) \
+    X(MarginForeground) \
+    X(MarkerBackground) \
+    X(MatchedBraceBackground) \
+    X(MatchedBraceForeground) \
+    X(Menu) \
+    X(MenuBar) \
+    X(MenuSelected) \
+    X(MenuSelectedText) \
+    X(MenuText) \
+    X(Mid) \
+    X(Midlight) \
+    X(ModuleNameBackground) \
+    X(ModuleNameForeground) \
+    X(NumberBackground) \
+    X(NumberForeground) \
+    X(PODBackground) \
+    X(PODForeground) \
+    X(PaneBackground) \
+    X(PercentStringForeground) \
+    X(PercentStringQBackground) \
+    X(PercentStringQForeground) \
+    X(PercentStringqBackground) \
+    X(PercentStringqForeground) \
+    X(PercentStringrBackground) \
+    X(PercentStringrForeground) \
+    X(PercentStringwBackground) \
+    X(PercentStringwForeground) \
+    X(PercentStringxBackground) \
+    X(PercentStringxForeground) \
+    X(PressedButton) \
+    X(PressedButtonText) \
+    X(RegexBackground) \
+    X(RegexForeground) \
+    X(Scope) \
+    X(Scope_2) \
+    X(ScrollBar) \
+    X(ScrollBarBackground) \
+    X(ScrollBarBorder) \
+    X(SelectionBackground) \
+    X(SelectionForeground) \
+    X(Shadow) \
+    X(SingleQuotedStringBackground) \
+    X(SingleQuotedStringForeground) \
+    X(Slider) \
+    X(SliderBackground) \
+    X(SliderBorder) \
+    X(StatusBar) \
+    X(StatusBarText) \
+    X(StderrBackground) \
+    X(StdinBackground) \
+    X(StdoutBackground) \
+    X(SymbolBackground) \
+    X(SymbolForeground) \
+    X(Tab) \
+    X(TabSelected) \
+    X(TabSelectedText) \
+    X(TabText) \
+    X(ToolTipBase) \
+    X(ToolTipText) \
+    X(WindowBackground) \
+    X(WindowBorder) \
+    X(WindowForeground) \
+    X(WindowInternalBorder)
+
 class SonicPiTheme : public QObject
 {
 Q_OBJECT
 public:
     enum Style { LightMode, DarkMode, LightProMode, DarkProMode, HighContrastMode };
 
+#define SONIC_PI_THEME_COLOR_ENUM(name) name,
+    enum Color { SONIC_PI_THEME_COLORS(SONIC_PI_THEME_COLOR_ENUM) NumColors };
+#undef SONIC_PI_THEME_COLOR_ENUM
+
     explicit SonicPiTheme(QObject *parent = 0, QString customSettingsFilename="", QString rootPath = "");
     ~SonicPiTheme();
     QColor color(QString);
+    inline const QColor &color(Color c) const { return colors[c]; }
+    static QString colorName(Color c);
     QString font(QString);
     void darkMode();
     void lightMode();
@@ -78,6 +224,10 @@ private:
     QMap<QString, QString> theme;
     QMap<QString, QString> customSettings;
 
+    // theme compiled into QColors whenever the style is switched
+    QColor colors[NumColors];
+    void compileColors();
+
     QString readFile(QString name);
 
     void loadToolBarIcons();
@@ -13,14 +13,24 @@
 
 
 // OSC stuff
-#include "oscpkt.hh"
+#include "api/osc/oscpkt.hh"
 #include "oschandler.h"
 #include "mainwindow.h"
 #include "widgets/sonicpilog.h"
 #include "model/sonicpitheme.h"
+#include "profiler.h"
+#include "api/metrics.h"
 #include <QTextEdit>
+#include <algorithm>
 #include <iostream>
 
+// Strings popped from a MessageView point into the received packet, so
+// this is the only copy made before they reach the log panes
+static QString toQString(const oscpkt::StringView &s)
+{
+    return QString::fromUtf8(s.data(), int(s.size()));
+}
+
 OscHandler::OscHandler(MainWindow *parent, SonicPiLog *outPane,  SonicPiLog *incomingPane, SonicPiTheme *theme)
 {
     window = parent;
@@ -32,40 +42,62 @@ OscHandler::OscHandler(MainWindow *parent, SonicPiLog *outPane,  SonicPiLog *inc
     this->theme = theme;
 }
 
-void OscHandler::oscMessage(std::vector<char> buffer)
+void OscHandler::oscMessage(const char *data, size_t size)
 {
+    SP_ZoneScopedN("OscHandler::oscMessage");
+    SP_Plot("GUI OSC packet bytes", (int64_t)size);
+    static auto& packets = SonicPi::Metrics::GetCounter("osc.packets");
+    static auto& bytes = SonicPi::Metrics::GetCounter("osc.bytes");
+    packets.Add();
+    bytes.Add(size);
     QColor bg;
 
-    pr.init(&buffer[0], buffer.size());
+    pr.init(data, size);
 
-    oscpkt::Message *msg;
+    const oscpkt::MessageView *msg;
     while (pr.isOk() && (msg = pr.popMessage()) != 0) {
       if (msg->match("/log/multi_message")){
-        int msg_count;
+        int msg_count = 0;
         SonicPiLog::MultiMessage mm;
+        mm.received = std::chrono::steady_clock::now();
         mm.theme = theme;
 
-        oscpkt::Message::ArgReader ar = msg->arg();
+        oscpkt::StringView thread_name, runtime;
+        oscpkt::MessageView::ArgReader ar = msg->arg();
         ar.popInt32(mm.job_id);
-        ar.popStr(mm.thread_name);
-        ar.popStr(mm.runtime);
+        ar.popStr(thread_name);
+        ar.popStr(runtime);
         ar.popInt32(msg_count);
+        mm.thread_name = toQString(thread_name);
+        mm.runtime = toQString(runtime);
 
+        // The count comes off the wire, so don't trust it further than
+        // the arguments actually in the packet (a type and a string each)
+        size_t max_count = ar.isOk() ? ar.nbArgRemaining() / 2 : 0;
+        mm.messages.reserve(std::min<size_t>(msg_count > 0 ? msg_count : 0, max_count));
         for(int i = 0 ; i < msg_count ; i++) {
           SonicPiLog::Message message;
+          oscpkt::StringView s;
           ar.popInt32(message.msg_type);
-          ar.popStr(message.s);
+          ar.popStr(s);
+          if (!ar.isOk()) {
+            break;
+          }
+          message.s = toQString(s);
           mm.messages.push_back(message);
         }
 
+        static auto& logBacklog = SonicPi::Metrics::GetGauge("log.backlog");
+        logBacklog.Add(1);
+        SP_Plot("Log queue depth", logBacklog.Get());
         QMetaObject::invokeMethod( out, "handleMultiMessage", Qt::QueuedConnection,
                                    Q_ARG(SonicPiLog::MultiMessage, mm ) );
       }
       else if (msg->match("/incoming/osc")) {
-        std::string time;
+        oscpkt::StringView time;
         int id;
-        std::string address;
-        std::string args;
+        oscpkt::StringView address;
+        oscpkt::StringView args;
         if (msg->arg().popStr(time).popInt32(id).popStr(address).popStr(args).isOkNoMoreArgs()) {
           int max_path_len = 0;
           for (int i = 0; i < last_incoming_path_lens.size() ; i++) {
@@ -73,45 +105,46 @@ void OscHandler::oscMessage(std::vector<char> buffer)
               max_path_len = last_incoming_path_lens[i];
             }
           }
-          int len_diff = max_path_len - int(address.length());
+          int len_diff = max_path_len - int(address.size());
           len_diff = (len_diff < 10) ? len_diff : 0;
           len_diff = std::max(len_diff, 0);
           len_diff = len_diff + 1;
           int idmod = ((id * 3) % 200);
           idmod = 155 + ((idmod < 100) ? idmod : 200 - idmod);
 
-          QString qs_address =  QString::fromStdString(address);
+          QString qs_address = toQString(address);
+          QString qs_args = toQString(args);
           if(!qs_address.startsWith(":")) {
-            bg = theme->color("CuePathBackground");
+            bg = theme->color(SonicPiTheme::CuePathBackground);
             bg.setAlpha(idmod);
-            QMetaObject::invokeMethod( incoming, "setTextBgFgColors",      Qt::QueuedConnection, Q_ARG(QColor, bg), Q_ARG(QColor, theme->color("CuePathForeground")));
+            QMetaObject::invokeMethod( incoming, "setTextBgFgColors",      Qt::QueuedConnection, Q_ARG(QColor, bg), Q_ARG(QColor, theme->color(SonicPiTheme::CuePathForeground)));
 
               QMetaObject::invokeMethod( incoming, "appendPlainText",        Qt::QueuedConnection,
-                                         Q_ARG(QString, QString::fromStdString(" " + address) ) );
+                                         Q_ARG(QString, " " + qs_address ) );
 
               QMetaObject::invokeMethod( incoming, "insertPlainText",        Qt::QueuedConnection,
-                                         Q_ARG(QString, QString::fromStdString(std::string(len_diff, ' ')) ) );
+                                         Q_ARG(QString, QString(len_diff, ' ') ) );
 
-              QMetaObject::invokeMethod( incoming, "setTextBgFgColors",      Qt::QueuedConnection, Q_ARG(QColor, theme->color("LogBackground")), Q_ARG(QColor, "white"));
+              QMetaObject::invokeMethod( incoming, "setTextBgFgColors",      Qt::QueuedConnection, Q_ARG(QColor, theme->color(SonicPiTheme::LogBackground)), Q_ARG(QColor, "white"));
 
               QMetaObject::invokeMethod( incoming, "insertPlainText",        Qt::QueuedConnection,
                                          Q_ARG(QString, QString::fromStdString(" ")));
-            bg = theme->color("CueDataBackground");
+            bg = theme->color(SonicPiTheme::CueDataBackground);
             bg.setAlpha(idmod);
-            QMetaObject::invokeMethod( incoming, "setTextBgFgColors",      Qt::QueuedConnection, Q_ARG(QColor, bg), Q_ARG(QColor, theme->color("CueDataForeground")));
+            QMetaObject::invokeMethod( incoming, "setTextBgFgColors",      Qt::QueuedConnection, Q_ARG(QColor, bg), Q_ARG(QColor, theme->color(SonicPiTheme::CueDataForeground)));
 
             //QMetaObject::invokeMethod( incoming, "setTextBgFgColors",      Qt::QueuedConnection, Q_ARG(QColor, QColor(255, 153, 0, idmod)), Q_ARG(QColor,g"white"));
               QMetaObject::invokeMethod( incoming, "insertPlainText",        Qt::QueuedConnection,
-                                         Q_ARG(QString, QString::fromStdString(args) ) );
-              last_incoming_path_lens[id % last_incoming_path_lens.size()] = int(address.length());
+                                         Q_ARG(QString, qs_args ) );
+              last_incoming_path_lens[id % last_incoming_path_lens.size()] = int(address.size());
             }
-          QMetaObject::invokeMethod( window, "addCuePath", Qt::QueuedConnection, Q_ARG(QString, qs_address), Q_ARG(QString, QString::fromStdString(args)));
+          QMetaObject::invokeMethod( window, "addCuePath", Qt::QueuedConnection, Q_ARG(QString, qs_address), Q_ARG(QString, qs_args));
             } else {
               std::cout << "[GUI] - unhandled OSC msg /incoming/osc: "<< std::endl;
         }
       }
       else if (msg->match("/log/info")) {
-        std::string s;
+        oscpkt::StringView s;
         int style;
         if (msg->arg().popInt32(style).popStr(s).isOkNoMoreArgs()) {
           // Evil nasties!
@@ -119,15 +152,15 @@ void OscHandler::oscMessage(std::vector<char> buffer)
 
 
           if(style == 1) {
-            QMetaObject::invokeMethod( out, "setTextBgFgColors",           Qt::QueuedConnection, Q_ARG(QColor, theme->color("LogInfoBackground_1")),  Q_ARG(QColor, theme->color("LogInfoForeground_1")));
+            QMetaObject::invokeMethod( out, "setTextBgFgColors",           Qt::QueuedConnection, Q_ARG(QColor, theme->color(SonicPiTheme::LogInfoBackground_1)),  Q_ARG(QColor, theme->color(SonicPiTheme::LogInfoForeground_1)));
           } else {
-            QMetaObject::invokeMethod( out, "setTextBgFgColors",           Qt::QueuedConnection, Q_ARG(QColor, theme->color("LogInfoBackground")),  Q_ARG(QColor, theme->color("LogInfoForeground")));
+            QMetaObject::invokeMethod( out, "setTextBgFgColors",           Qt::QueuedConnection, Q_ARG(QColor, theme->color(SonicPiTheme::LogInfoBackground)),  Q_ARG(QColor, theme->color(SonicPiTheme::LogInfoForeground)));
           }
 
-          QMetaObject::invokeMethod( out, "appendPlainText",        Qt::QueuedConnection, Q_ARG(QString, QString::fromStdString("=> " + s + "\n")) );
+          QMetaObject::invokeMethod( out, "appendPlainText",        Qt::QueuedConnection, Q_ARG(QString, "=> " + toQString(s) + "\n") );
 
-          QMetaObject::invokeMethod( out, "setTextColor",           Qt::QueuedConnection, Q_ARG(QColor, theme->color("LogForeground")));
-          QMetaObject::invokeMethod( out, "setTextBackgroundColor", Qt::QueuedConnection, Q_ARG(QColor, theme->color("LogBackground")));
+          QMetaObject::invokeMethod( out, "setTextColor",           Qt::QueuedConnection, Q_ARG(QColor, theme->color(SonicPiTheme::LogForeground)));
+          QMetaObject::invokeMethod( out, "setTextBackgroundColor", Qt::QueuedConnection, Q_ARG(QColor, theme->color(SonicPiTheme::LogBackground)));
         } else {
           std::cout << "[GUI] - error: unhandled OSC msg /info "<< std::endl;
         }
@@ -203,6 +236,14 @@ void OscHandler::oscMessage(std::vector<char> buffer)
           std::cout << "[GUI] - error: unhandled OSC msg /update_info_text: "<< std::endl;
         }
       }
+      else if (msg->match("/recording-tap")) {
+        int scope_num, sample_rate, frames;
+        if (msg->arg().popInt32(scope_num).popInt32(sample_rate).popInt32(frames).isOkNoMoreArgs()) {
+          QMetaObject::invokeMethod( window, "recordingTapReady", Qt::QueuedConnection, Q_ARG(int, scope_num), Q_ARG(int, sample_rate), Q_ARG(int, frames));
+        } else {
+          std::cout << "[GUI] - error: unhandled OSC msg /recording-tap: "<< std::endl;
+        }
+      }
       else if (msg->match("/buffer/replace-lines")) {
         std::string id;
         std::string content;
@@ -229,6 +270,8 @@ void OscHandler::oscMessage(std::vector<char> buffer)
         if (msg->arg().isOkNoMoreArgs()) {
           std::cout << "[GUI] - server asked us to exit" << std::endl;
           signal_server_stop = true;
+          // Also serves as the acknowledgement of our own /exit
+          QMetaObject::invokeMethod(window, "serverExited", Qt::QueuedConnection);
         } else {
           std::cout << "[GUI] - error: unhandled OSC msg /exited: "<< std::endl;
         }
@@ -246,11 +289,61 @@ void OscHandler::oscMessage(std::vector<char> buffer)
       else if (msg->match("/ack")) {
         std::string id;
         if (msg->arg().popStr(id).isOkNoMoreArgs()) {
-          server_started = true;
+          if (!server_started.exchange(true)) {
+            QMetaObject::invokeMethod( window, "serverStarted", Qt::QueuedConnection);
+          }
         } else {
           std::cout << "[GUI] - error: unhandled OSC msg /ack " << std::endl;
         }
       }
+      else if (msg->match("/booted")) {
+        if (msg->arg().isOkNoMoreArgs()) {
+          std::cout << "[GUI] - server reported successful boot" << std::endl;
+          if (!server_started.exchange(true)) {
+            QMetaObject::invokeMethod( window, "serverStarted", Qt::QueuedConnection);
+          }
+        } else {
+          std::cout << "[GUI] - error: unhandled OSC msg /booted " << std::endl;
+        }
+      }
+      else if (msg->match("/metrics")) {
+        // source, then alternating metric names and values
+        oscpkt::MessageView::ArgReader ar = msg->arg();
+        oscpkt::StringView source;
+        QStringList names;
+        QVariantList values;
+        ar.popStr(source);
+        while (ar.isOk() && ar.nbArgRemaining() >= 2) {
+          oscpkt::StringView name;
+          ar.popStr(name);
+          if (ar.isInt32()) {
+            int32_t i;
+            ar.popInt32(i);
+            values << double(i);
+          } else if (ar.isInt64()) {
+            int64_t i;
+            ar.popInt64(i);
+            values << double(i);
+          } else if (ar.isDouble()) {
+            double d;
+            ar.popDouble(d);
+            values << d;
+          } else {
+            float f;
+            ar.popFloat(f);
+            values << double(f);
+          }
+          names << toQString(name);
+        }
+        if (ar.isOkNoMoreArgs()) {
+          QMetaObject::invokeMethod( window, "updateMetrics", Qt::QueuedConnection,
+                                     Q_ARG(QString, toQString(source)),
+                                     Q_ARG(QStringList, names),
+                                     Q_ARG(QVariantList, values));
+        } else {
+          std::cout << "[GUI] - error: unhandled OSC msg /metrics: "<< std::endl;
+        }
+      }
       else if (msg->match("/midi/out-ports")) {
         std::string port_info;
         if (msg->arg().popStr(port_info).isOkNoMoreArgs()) {
@@ -15,7 +15,8 @@
 #define OSCHANDLER_H
 
 #include <array>
-#include "oscpkt.hh"
+#include <atomic>
+#include "api/osc/oscpkt.hh"
 #include "mainwindow.h"
 class SonicPiTheme;
 
@@ -24,9 +25,10 @@ class OscHandler
 
 public:
   OscHandler(MainWindow *parent = 0, SonicPiLog *out = 0, SonicPiLog *incoming = 0, SonicPiTheme *theme = 0);
-    void oscMessage(std::vector<char> buffer);
-    bool signal_server_stop;
-    bool server_started;
+    void oscMessage(const char *data, size_t size);
+    void oscMessage(const std::vector<char> &buffer) { oscMessage(buffer.data(), buffer.size()); }
+    std::atomic<bool> signal_server_stop;
+    std::atomic<bool> server_started;
 
 private:
     SonicPiTheme *theme;
@@ -35,7 +37,7 @@ private:
     SonicPiLog  *incoming;
     std::array<int, 20> last_incoming_path_lens;
 
-    oscpkt::PacketReader pr;
+    oscpkt::PacketViewReader pr;
     oscpkt::PacketWriter pw;
 };
 
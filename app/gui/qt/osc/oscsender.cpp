@@ -13,8 +13,8 @@
 
 
 // OSC stuff
-#include "oscpkt.hh"
-#include "udp.hh"
+#include "api/osc/oscpkt.hh"
+#include "api/osc/udp.hh"
 
 #include "oscsender.h"
 using namespace oscpkt;
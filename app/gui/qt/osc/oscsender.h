@@ -14,7 +14,7 @@
 #ifndef OSCSENDER_H
 #define OSCSENDER_H
 
-#include "oscpkt.hh"
+#include "api/osc/oscpkt.hh"
 using namespace oscpkt;
 
 class OscSender
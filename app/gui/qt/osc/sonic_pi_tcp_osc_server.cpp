@@ -5,17 +5,20 @@
 #include <QtNetwork>
 #include <QTcpSocket>
 
+#include <cstring>
 #include <iostream>
 #include "sonic_pi_osc_server.h"
 
 // OSC stuff
-#include "oscpkt.hh"
+#include "api/osc/oscpkt.hh"
+#include "profiler.h"
 
 SonicPiTCPOSCServer::SonicPiTCPOSCServer(MainWindow *sonicPiWindow, OscHandler *oscHandler) : SonicPiOSCServer(sonicPiWindow, oscHandler)
 {
     tcpServer = new QTcpServer(sonicPiWindow);
-    buffer.clear();
-    blockSize = 0;
+    socket = 0;
+    head = 0;
+    tail = 0;
 
     connect(tcpServer, SIGNAL(newConnection()), this, SLOT(client()));
 }
@@ -49,37 +52,50 @@ void SonicPiTCPOSCServer::client(){
     connect(socket, SIGNAL(readyRead()), this, SLOT(readMessage()));
     connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(logError(QAbstractSocket::SocketError)));
     connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
-    std::vector<char>().swap(buffer);
+    head = 0;
+    tail = 0;
 }
 
 void SonicPiTCPOSCServer::readMessage()
 {
-    while(socket->bytesAvailable() > 0){
-        if (blockSize == 0) {
-            if (socket->bytesAvailable() < (int)sizeof(quint32)){
-                return;
+    SP_ZoneScopedN("TCP OSC readMessage");
+    qint64 available;
+    while ((available = socket->bytesAvailable()) > 0) {
+        // make room for everything that's arrived, preferring to slide
+        // the unhandled bytes to the front over growing the buffer
+        if (buffer.size() - tail < (size_t)available) {
+            if (head > 0) {
+                memmove(buffer.data(), buffer.data() + head, tail - head);
+                tail -= head;
+                head = 0;
+            }
+            if (buffer.size() - tail < (size_t)available) {
+                buffer.resize(tail + available);
             }
-
-            socket->read((char *)&blockSize, sizeof(quint32));
-            blockSize = qToBigEndian(blockSize);
         }
 
-        if (socket->bytesAvailable() < blockSize){
+        qint64 bytesRead = socket->read(buffer.data() + tail, buffer.size() - tail);
+        if (bytesRead <= 0) {
+            if (bytesRead < 0) {
+                std::cerr << "[GUI] - Error: read: " << socket->errorString().toStdString() << "\n";
+            }
             return;
         }
+        tail += bytesRead;
+        SP_Plot("TCP OSC buffered bytes", (int64_t)(tail - head));
 
-        buffer.resize(blockSize);
-        int bytesRead = socket->read(&buffer[0], blockSize);
+        while (tail - head >= sizeof(quint32)) {
+            quint32 frameSize = qFromBigEndian<quint32>(buffer.data() + head);
+            if (tail - head - sizeof(quint32) < frameSize) {
+                break;
+            }
+            handler->oscMessage(buffer.data() + head + sizeof(quint32), frameSize);
+            head += sizeof(quint32) + frameSize;
+        }
 
-        if(bytesRead < 0 || (uint32_t)bytesRead != blockSize) {
-            std::cerr << "[GUI] - Error: read: " << bytesRead << " Expected:" << blockSize << "\n";
-            blockSize = 0;
-            return;
+        if (head == tail) {
+            head = 0;
+            tail = 0;
         }
-        std::vector<char> tmp(buffer);
-        tmp.swap(buffer);
-        handler->oscMessage(buffer);
-        blockSize = 0;
-        std::vector<char>().swap(buffer);
     }
 }
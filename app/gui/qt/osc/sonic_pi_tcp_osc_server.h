@@ -16,8 +16,6 @@ class SonicPiTCPOSCServer :  public SonicPiOSCServer
 public:
     explicit SonicPiTCPOSCServer(MainWindow *parent, OscHandler *handler = 0);
 
-    quint32 blockSize;
-
 public slots:
     void stop();
     void start();
@@ -30,7 +28,13 @@ private:
 
     QTcpServer *tcpServer;
     QTcpSocket *socket;
+
+    // Received bytes that haven't been handled yet are buffer[head, tail).
+    // Frames are a big endian u32 length followed by an OSC packet and
+    // are handed to the handler in place. Only a trailing partial frame
+    // is ever moved, and the buffer is kept between reads.
     std::vector<char> buffer;
+    size_t head, tail;
 };
 
 #endif // SONIC_PI_TCP_OSC_SERVER_H
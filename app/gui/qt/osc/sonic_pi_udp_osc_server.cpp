@@ -13,7 +13,8 @@
 
 #include "sonic_pi_udp_osc_server.h"
 #include "sonic_pi_osc_server.h"
-#include "udp.hh"
+#include "api/osc/udp.hh"
+#include "profiler.h"
 
 SonicPiUDPOSCServer::SonicPiUDPOSCServer(MainWindow *sonicPiWindow, OscHandler *oscHandler, int port) : SonicPiOSCServer(sonicPiWindow, oscHandler)
 {
@@ -30,6 +31,7 @@ void SonicPiUDPOSCServer::stop(){
 }
 
 void SonicPiUDPOSCServer::start(){
+  SP_SetThreadName("GUI UDP OSC server");
   std::cout << "[GUI] - starting UDP OSC Server on port " << port_num << "..." << std::endl;
   oscpkt::UdpSocket sock;
   sock.bindTo(port_num);
@@ -43,10 +45,19 @@ void SonicPiUDPOSCServer::start(){
 
   osc_incoming_port_open = true;
 
+  // Bursts of log messages arrive as many small datagrams, so drain
+  // everything that's queued with each receive. The batch's buffers
+  // are reused for the lifetime of the server.
+  oscpkt::UdpSocket::PacketBatch batch;
   while (sock.isOk() && continueListening()) {
-    if (sock.receiveNextPacket(30 /* timeout, in ms */)) {
-      handler->oscMessage(sock.buffer);
-      std::vector<char>().swap(sock.buffer);
+    if (sock.receiveNextPackets(batch, 30 /* timeout, in ms */)) {
+      SP_ZoneScopedN("UDP OSC batch");
+      SP_Plot("UDP OSC batch packets", (int64_t)batch.packetCount());
+      for (int i = 0; i < batch.packetCount(); i++) {
+        if (batch.packetSize(i) > 0) {
+          handler->oscMessage(batch.packetData(i), batch.packetSize(i));
+        }
+      }
       std::cout << std::flush;
     }
   }
@@ -1,10 +1,16 @@
+#pragma once
+
+// Tracy instrumentation. Everything here compiles away unless the build
+// is configured with -DENABLE_TRACY=ON, which defines TRACY_ENABLE.
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
+// TracyPlot is overloaded for int64_t, float and double, so cast plain ints
 #define SP_Plot(a, b) TracyPlot(a, b)
 #define SP_Lockable(a, b) TracyLockable(a, b)
 #define SP_LockableBase(a) LockableBase(a)
 #define SP_ZoneScoped ZoneScoped
 #define SP_ZoneScopedN(a) ZoneScopedN(a)
+#define SP_SetThreadName(a) tracy::SetThreadName(a)
 #define SP_FrameMark FrameMark
 #else
 #define SP_Plot(a, b)
@@ -12,5 +18,6 @@
 #define SP_LockableBase(a) a
 #define SP_ZoneScoped
 #define SP_ZoneScopedN(a)
+#define SP_SetThreadName(a)
 #define SP_FrameMark
-#endif
\ No newline at end of file
+#endif
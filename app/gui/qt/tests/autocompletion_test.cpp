@@ -0,0 +1,110 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+// Types into a real editor and checks what the autocompletion popup
+// shows. Exits non-zero if any check fails. Run it with
+// QT_QPA_PLATFORM=offscreen when there's no display.
+
+#include <cstdint>
+#include <iostream>
+
+#include <QApplication>
+#include <QKeyEvent>
+
+#include "model/sonicpitheme.h"
+#include "utils/sonicpiapis.h"
+#include "widgets/sonicpilexer.h"
+#include "widgets/sonicpiscintilla.h"
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const char *what) {
+    std::cout << (ok ? "ok   - " : "FAIL - ") << what << std::endl;
+    if (!ok) {
+      failures++;
+    }
+  }
+
+  void typeKey(QWidget *w, int key, const QString &text = QString()) {
+    QKeyEvent press(QEvent::KeyPress, key, Qt::NoModifier, text);
+    QApplication::sendEvent(w, &press);
+    QKeyEvent release(QEvent::KeyRelease, key, Qt::NoModifier, text);
+    QApplication::sendEvent(w, &release);
+  }
+
+  void typeText(QWidget *w, const QString &text) {
+    for (QChar c : text) {
+      typeKey(w, c.toUpper().unicode(), QString(c));
+    }
+  }
+
+  bool listActive(SonicPiScintilla *editor) {
+    return editor->SendScintilla(QsciScintilla::SCI_AUTOCACTIVE) != 0;
+  }
+
+  QString currentItem(SonicPiScintilla *editor) {
+    QByteArray buf(256, '\0');
+    editor->SendScintilla(QsciScintilla::SCI_AUTOCGETCURRENTTEXT, (uintptr_t) 0, buf.data());
+    return QString::fromUtf8(buf.constData());
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  QApplication app(argc, argv);
+
+  SonicPiTheme *theme = new SonicPiTheme(&app, "", "");
+  SonicPiLexer *lexer = new SonicPiLexer(theme);
+  SonicPiAPIs *apis = new SonicPiAPIs(lexer);
+  apis->addSymbol(SonicPiAPIs::Sample, "bd_haus");
+  apis->addSymbol(SonicPiAPIs::Sample, "bd_boom");
+  apis->addSymbol(SonicPiAPIs::Sample, "bass_hard_c");
+  apis->addSymbol(SonicPiAPIs::Sample, "loop_amen");
+
+  SonicPiScintilla *editor = new SonicPiScintilla(lexer, theme, "test", nullptr, true);
+  editor->resize(800, 600);
+  editor->show();
+  editor->setFocus();
+  editor->setText("");
+  app.processEvents();
+
+  // A prefix hit comes up through QsciScintilla as usual
+  typeText(editor, "sample :b");
+  check(listActive(editor), "prefix matches open the list");
+  check(currentItem(editor).startsWith(":b"), "a prefix match is selected");
+
+  // Nothing starts with :bh, so this is fuzzy only. The list must stay
+  // open and be in rank order, which isn't alphabetical here
+  typeText(editor, "h");
+  check(listActive(editor), "fuzzy matches keep the list open");
+  typeKey(editor, Qt::Key_Down);
+  check(currentItem(editor) == ":bd_haus", "best fuzzy match is first");
+  typeKey(editor, Qt::Key_Down);
+  check(currentItem(editor) == ":bass_hard_c", "next fuzzy match is second");
+
+  // Once nothing matches at all the list goes away
+  typeText(editor, "q");
+  check(!listActive(editor), "list closes when nothing matches");
+
+  // and prefix lists hide themselves again as normal
+  editor->setText("");
+  typeText(editor, "sample :lo");
+  check(listActive(editor), "prefix list opens after a fuzzy one");
+  typeText(editor, "x");
+  check(!listActive(editor), "prefix list auto hides again");
+
+  delete editor;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,295 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+// Reads the same packets with oscpkt's copying PacketReader and the
+// zero-copy PacketViewReader and checks they agree on everything: which
+// packets are valid, each message's address and type tags, and every
+// argument. The packets are well formed ones, then truncated, corrupted
+// and hand-broken copies of them.
+//
+// Each packet is read twice: from a buffer of exactly its own size, so
+// an ASan build catches any read past the end, and from one followed by
+// junk that isn't 0, so that in a plain build such a read changes what
+// the view sees. Exits non-zero if any check fails.
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "api/osc/oscpkt.hh"
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const std::string &what) {
+    if (!ok) {
+      std::cout << "FAIL - " << what << std::endl;
+      failures++;
+    }
+  }
+
+  bool sameArgs(const oscpkt::Message &m, const oscpkt::MessageView &v, const std::string &name) {
+    oscpkt::Message::ArgReader a = m.arg();
+    oscpkt::MessageView::ArgReader b = v.arg();
+    const std::string &tags = m.typeTags();
+    for (size_t i = 0; i < tags.size(); i++) {
+      bool same = true;
+      switch (tags[i]) {
+        case oscpkt::TYPE_TAG_TRUE:
+        case oscpkt::TYPE_TAG_FALSE: {
+          bool x, y;
+          a.popBool(x); b.popBool(y);
+          same = x == y;
+        } break;
+        case oscpkt::TYPE_TAG_INT32: {
+          int32_t x, y;
+          a.popInt32(x); b.popInt32(y);
+          same = x == y;
+        } break;
+        case oscpkt::TYPE_TAG_INT64: {
+          int64_t x, y;
+          a.popInt64(x); b.popInt64(y);
+          same = x == y;
+        } break;
+        case oscpkt::TYPE_TAG_FLOAT: {
+          float x, y;
+          a.popFloat(x); b.popFloat(y);
+          same = memcmp(&x, &y, sizeof(x)) == 0;
+        } break;
+        case oscpkt::TYPE_TAG_DOUBLE: {
+          double x, y;
+          a.popDouble(x); b.popDouble(y);
+          same = memcmp(&x, &y, sizeof(x)) == 0;
+        } break;
+        case oscpkt::TYPE_TAG_STRING: {
+          std::string x;
+          oscpkt::StringView y;
+          a.popStr(x); b.popStr(y);
+          same = x == y.str();
+        } break;
+        case oscpkt::TYPE_TAG_BLOB: {
+          std::vector<char> x;
+          oscpkt::StringView y;
+          a.popBlob(x); b.popBlob(y);
+          same = std::string(x.begin(), x.end()) == y.str();
+        } break;
+        default:
+          a.pop(); b.pop();
+      }
+      if (!same || a.isOk() != b.isOk()) {
+        check(false, name + ": argument " + std::to_string(i) + " ('" + tags[i] + "') differs");
+        return false;
+      }
+    }
+    if (a.isOkNoMoreArgs() != b.isOkNoMoreArgs()) {
+      check(false, name + ": readers disagree at the end of the arguments");
+      return false;
+    }
+    return true;
+  }
+
+  bool sameReading(const char *data, size_t size, const std::string &name) {
+    oscpkt::PacketReader reader(data, size);
+    oscpkt::PacketViewReader view_reader(data, size);
+    if (reader.isOk() != view_reader.isOk()) {
+      check(false, name + ": readers disagree on whether the packet is ok");
+      return false;
+    }
+
+    for (;;) {
+      oscpkt::Message *m = reader.popMessage();
+      const oscpkt::MessageView *v = view_reader.popMessage();
+      if (!m || !v) {
+        if (m || v) {
+          check(false, name + ": readers found a different number of messages");
+          return false;
+        }
+        return true;
+      }
+      if (m->isOk() != v->isOk() ||
+          m->addressPattern() != v->addressPattern().str() ||
+          m->typeTags() != v->typeTags().str() ||
+          m->timeTag() != v->timeTag()) {
+        check(false, name + ": message header differs for " + m->addressPattern());
+        return false;
+      }
+      if (!sameArgs(*m, *v, name)) {
+        return false;
+      }
+    }
+  }
+
+  bool sameReading(const std::vector<char> &packet, const std::string &name) {
+    std::vector<char> exact(packet);
+    if (!sameReading(exact.empty() ? nullptr : exact.data(), exact.size(), name)) {
+      return false;
+    }
+    std::vector<char> guarded(packet);
+    guarded.insert(guarded.end(), 64, char(0x7f));
+    guarded.push_back(0);
+    return sameReading(guarded.data(), packet.size(), name + " (guarded)");
+  }
+
+  std::vector<char> bytesOf(oscpkt::PacketWriter &w) {
+    const char *p = w.packetData();
+    return std::vector<char>(p, p + w.packetSize());
+  }
+
+  // The offset of the first byte of 'what' after 'from', or -1
+  long find(const std::vector<char> &packet, const std::string &what, size_t from = 0) {
+    for (size_t i = from; i + what.size() <= packet.size(); i++) {
+      if (memcmp(packet.data() + i, what.data(), what.size()) == 0) {
+        return long(i);
+      }
+    }
+    return -1;
+  }
+
+  void randomMessage(std::mt19937 &rng, oscpkt::Message &msg) {
+    static const char *addresses[] = { "/a", "/log/info", "/incoming/osc", "/foo/*/bar", "/x//y" };
+    std::uniform_int_distribution<int> pick(0, 8);
+    std::uniform_int_distribution<int> len(0, 9);
+    msg.init(addresses[pick(rng) % 5]);
+    for (int n = len(rng); n > 0; n--) {
+      switch (pick(rng)) {
+        case 0: msg.pushBool(true); break;
+        case 1: msg.pushBool(false); break;
+        case 2: msg.pushInt32(int32_t(rng())); break;
+        case 3: msg.pushInt64(int64_t(rng()) << 20); break;
+        case 4: msg.pushFloat(float(rng()) / 7.0f); break;
+        case 5: msg.pushDouble(double(rng()) / 3.0); break;
+        case 6: msg.pushStr(std::string(len(rng), char('a' + len(rng)))); break;
+        default: {
+          std::vector<char> blob(len(rng) * 3, char(rng()));
+          msg.pushBlob(blob.data(), blob.size());
+        }
+      }
+    }
+  }
+
+  std::vector<char> randomPacket(std::mt19937 &rng) {
+    oscpkt::PacketWriter w;
+    oscpkt::Message msg;
+    std::uniform_int_distribution<int> count(0, 3);
+    if (count(rng) == 0) {
+      randomMessage(rng, msg);
+      w.addMessage(msg);
+    } else {
+      w.startBundle(oscpkt::TimeTag(rng()));
+      for (int n = count(rng) + 1; n > 0; n--) {
+        if (count(rng) == 0) {
+          w.startBundle();
+          randomMessage(rng, msg);
+          w.addMessage(msg);
+          w.endBundle();
+        } else {
+          randomMessage(rng, msg);
+          w.addMessage(msg);
+        }
+      }
+      w.endBundle();
+    }
+    return bytesOf(w);
+  }
+}
+
+int main()
+{
+  oscpkt::PacketWriter w;
+  oscpkt::Message msg;
+  std::vector<char> blob(12, 'b');
+
+  // One of each argument type
+  w.init().addMessage(msg.init("/all/types").pushBool(true).pushBool(false).pushInt32(-7).pushInt64(1LL << 40)
+                      .pushFloat(1.5f).pushDouble(-2.25).pushStr("hello").pushStr("").pushBlob(blob.data(), blob.size())
+                      .pushBlob(nullptr, 0));
+  const std::vector<char> all_types = bytesOf(w);
+  check(sameReading(all_types, "all types"), "all types");
+
+  // Every truncation, including the ones that aren't a multiple of 4
+  for (size_t n = 0; n < all_types.size(); n++) {
+    sameReading(std::vector<char>(all_types.begin(), all_types.begin() + n), "truncated to " + std::to_string(n));
+  }
+
+  // A blob that claims to be bigger than the packet, by a little and by
+  // enough to wrap a 32 bit pointer sum
+  w.init().addMessage(msg.init("/blob").pushBlob(blob.data(), blob.size()));
+  const std::vector<char> with_blob = bytesOf(w);
+  long blob_len = find(with_blob, std::string("\0\0\0\x0c", 4), 8);
+  check(blob_len > 0, "found the blob length");
+  for (uint32_t len : { 13u, 16u, 0x7fffffffu, 0xfffffffcu, 0xffffffffu }) {
+    std::vector<char> p(with_blob);
+    p[blob_len] = char(len >> 24); p[blob_len + 1] = char(len >> 16);
+    p[blob_len + 2] = char(len >> 8); p[blob_len + 3] = char(len);
+    sameReading(p, "blob length " + std::to_string(len));
+  }
+
+  // A string whose terminating NUL (and padding) has been overwritten,
+  // so it runs to the end of the packet
+  w.init().addMessage(msg.init("/str").pushStr("abc"));
+  const std::vector<char> with_str = bytesOf(w);
+  long str = find(with_str, std::string("abc\0", 4), 8);
+  check(str > 0, "found the string");
+  {
+    std::vector<char> p(with_str);
+    p[str + 3] = 'd';
+    sameReading(p, "string with no NUL");
+  }
+  {
+    std::vector<char> p(with_str.begin(), with_str.begin() + str + 3);
+    p.push_back('d');
+    sameReading(p, "string cut off before its NUL");
+  }
+
+  // Bundles whose element sizes lie
+  w.init().startBundle().addMessage(msg.init("/in/bundle").pushInt32(1)).endBundle();
+  const std::vector<char> bundle = bytesOf(w);
+  for (uint32_t size : { 0u, 3u, 4u, 1024u, 0xfffffffcu }) {
+    std::vector<char> p(bundle);
+    p[16] = char(size >> 24); p[17] = char(size >> 16); p[18] = char(size >> 8); p[19] = char(size);
+    sameReading(p, "bundle element size " + std::to_string(size));
+  }
+
+  // Random packets, then random damage to them. A fixed seed, so a
+  // failure here always reproduces
+  std::mt19937 rng(20211018);
+  const int sweep = 50000;
+  for (int i = 0; i < sweep && failures < 20; i++) {
+    std::vector<char> p = randomPacket(rng);
+    std::string name = "random packet " + std::to_string(i);
+    sameReading(p, name);
+    if (p.empty()) {
+      continue;
+    }
+
+    std::uniform_int_distribution<size_t> at(0, p.size() - 1);
+    std::vector<char> corrupted(p);
+    for (int n = int(rng() % 4) + 1; n > 0; n--) {
+      switch (rng() % 4) {
+        case 0: corrupted[at(rng)] = char(rng()); break;
+        case 1: corrupted[at(rng)] = 0; break;
+        case 2: corrupted[at(rng)] ^= char(1 << (rng() % 8)); break;
+        default: corrupted[at(rng)] = char(0xff);
+      }
+    }
+    sameReading(corrupted, name + " corrupted");
+    sameReading(std::vector<char>(p.begin(), p.begin() + at(rng)), name + " truncated");
+  }
+  std::cout << "checked " << sweep << " random packets" << std::endl;
+
+  std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+// Checks that oscpkt::CompiledPattern gives exactly the same answers as
+// the interpreted fullPatternMatch/partialPatternMatch, quirks and all,
+// on known awkward patterns and on a seeded random sweep. Exits non-zero
+// if any check fails.
+
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "api/osc/oscpkt.hh"
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const std::string &what) {
+    if (!ok) {
+      std::cout << "FAIL - " << what << std::endl;
+      failures++;
+    }
+  }
+
+  // Both entry points of both matchers, for one pattern and path
+  bool sameAnswers(const std::string &pattern, const std::string &path) {
+    oscpkt::CompiledPattern compiled(pattern);
+    bool ok = true;
+    if (compiled.fullMatch(path) != oscpkt::fullPatternMatch(pattern, path)) {
+      check(false, "fullMatch(\"" + pattern + "\", \"" + path + "\")");
+      ok = false;
+    }
+    if (compiled.partialMatch(path) != oscpkt::partialPatternMatch(pattern, path)) {
+      check(false, "partialMatch(\"" + pattern + "\", \"" + path + "\")");
+      ok = false;
+    }
+    // The std::string overloads take a different route for literals
+    if (compiled.fullMatch(path.c_str()) != compiled.fullMatch(path)) {
+      check(false, "fullMatch overloads disagree on \"" + pattern + "\", \"" + path + "\"");
+      ok = false;
+    }
+    return ok;
+  }
+
+  std::string randomString(std::mt19937 &rng, const std::string &alphabet, int max_len) {
+    std::uniform_int_distribution<int> len(0, max_len);
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::string s;
+    for (int n = len(rng); n > 0; n--) {
+      s += alphabet[pick(rng)];
+    }
+    return s;
+  }
+}
+
+int main()
+{
+  const char *paths[] = {
+    "", "/", "//", "/a", "/b", "/ab", "/a/b", "/a/b/c", "/foo/bar", "/foo//bar", "/a-b", "/]", "/,", "/{", "/}"
+  };
+
+  const char *patterns[] = {
+    // plain literals, and the prefixes partialMatch has to accept
+    "", "/", "/a", "/a/b", "/foo/bar",
+    // unterminated [ gets stuck where it starts
+    "/[", "/[a", "/[a-", "/[!a", "/a[b", "/[a]/[b",
+    // ranges, negation and a trailing -
+    "/[a-b]", "/[!a-b]", "/[ab-]", "/[]", "/[!]", "/[]]",
+    // { without } is a syntax error
+    "/{", "/{a", "/{a,b", "/a{b,c", "/{a,b}/{",
+    // empty alternatives match nothing, so always win
+    "/{}", "/{,}", "/{,a}", "/{a,}", "/a{}b", "/{,}/b", "/{a,,b}",
+    // // followed by * and other wildcards
+    "//*", "//*/b", "///*", "//?", "//[a-b]", "//{a,b}", "/a//*", "//", "///",
+    // stars
+    "/*", "/**", "/*/*", "/a*", "/*b", "/*/b*", "*", "*/b",
+    // ? at the ends
+    "/?", "/??", "/a?", "?",
+  };
+
+  int pairs = 0;
+  for (const char *pattern : patterns) {
+    for (const char *path : paths) {
+      sameAnswers(pattern, path);
+      pairs++;
+    }
+  }
+  std::cout << "checked " << pairs << " fixed pattern/path pairs" << std::endl;
+
+  // A fixed seed, so a failure here always reproduces
+  std::mt19937 rng(20211018);
+  const std::string pattern_chars = "/ab*?[]!-{},";
+  const std::string path_chars = "/ab-,";
+  const int sweep = 200000;
+  int mismatched = 0;
+  for (int i = 0; i < sweep && mismatched < 20; i++) {
+    std::string pattern = randomString(rng, pattern_chars, 10);
+    std::string path = randomString(rng, path_chars, 8);
+    if (!sameAnswers(pattern, path)) {
+      mismatched++;
+    }
+  }
+  std::cout << "checked " << sweep << " random pattern/path pairs" << std::endl;
+
+  // The cache must hand back a pattern that behaves like the original
+  oscpkt::PatternCache cache(4);
+  for (const char *pattern : patterns) {
+    std::shared_ptr<const oscpkt::CompiledPattern> cached = cache.get(pattern);
+    for (const char *path : paths) {
+      check(cached->fullMatch(path) == oscpkt::fullPatternMatch(pattern, path),
+            std::string("cached fullMatch(\"") + pattern + "\", \"" + path + "\")");
+    }
+  }
+  check(cache.size() <= 4, "cache stays within its bound");
+
+  std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
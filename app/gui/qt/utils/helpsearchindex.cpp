@@ -0,0 +1,263 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include <QPair>
+#include <QtEndian>
+
+#include "helpsearchindex.h"
+
+namespace {
+  const quint32 HEADER_SIZE = 32;
+  const quint32 DOC_SIZE = 8;
+  const quint32 TERM_SIZE = 12;
+  const quint32 POSTING_SIZE = 4;
+
+  // completions of the word being typed rank below exact matches, and
+  // there's no point scoring every term that starts with a short prefix
+  const float PREFIX_SCALE = 0.5f;
+  const int MAX_PREFIX_TERMS = 256;
+
+  bool isWordChar(QChar c) {
+    return c.isLetterOrNumber() || c == '_';
+  }
+}
+
+HelpSearchIndex::HelpSearchIndex()
+  : data(nullptr), size(0), numDocs(0), numTerms(0),
+    docsOffset(0), termsOffset(0), postingsOffset(0), stringsOffset(0)
+{
+}
+
+HelpSearchIndex::~HelpSearchIndex()
+{
+  if (data && buffer.isEmpty()) {
+    file.unmap(const_cast<uchar *>(data));
+  }
+}
+
+bool HelpSearchIndex::load(const QString &path)
+{
+  file.setFileName(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    std::cout << "[GUI] - unable to open help search index " << path.toStdString() << std::endl;
+    return false;
+  }
+
+  size = file.size();
+  data = file.map(0, size);
+  if (!data) {
+    // compressed resources can't be mapped
+    buffer = file.readAll();
+    data = reinterpret_cast<const uchar *>(buffer.constData());
+  }
+
+  bool valid = size >= HEADER_SIZE && memcmp(data, "SPHI", 4) == 0 && u32(4) == 1;
+  if (valid) {
+    numDocs = u32(8);
+    numTerms = u32(12);
+    docsOffset = u32(16);
+    termsOffset = u32(20);
+    postingsOffset = u32(24);
+    stringsOffset = u32(28);
+
+    // strings are last, so as long as the file ends in a NUL every
+    // string in it is terminated
+    valid = (qint64) docsOffset + (qint64) numDocs * DOC_SIZE <= size &&
+      (qint64) termsOffset + (qint64) numTerms * TERM_SIZE <= size &&
+      postingsOffset <= stringsOffset && stringsOffset < size &&
+      data[size - 1] == 0;
+  }
+  if (valid) {
+    qint64 numPostings = (stringsOffset - postingsOffset) / POSTING_SIZE;
+    for (quint32 i = 0; valid && i < numTerms; i++) {
+      quint32 entry = termsOffset + i * TERM_SIZE;
+      valid = (qint64) u32(entry + 4) + u32(entry + 8) <= numPostings;
+    }
+  }
+
+  if (!valid) {
+    std::cout << "[GUI] - invalid help search index " << path.toStdString() << std::endl;
+    if (buffer.isEmpty()) {
+      file.unmap(const_cast<uchar *>(data));
+    }
+    buffer.clear();
+    file.close();
+    data = nullptr;
+    size = 0;
+    return false;
+  }
+
+  enabled.fill(true, numDocs);
+  return true;
+}
+
+bool HelpSearchIndex::isLoaded() const
+{
+  return data != nullptr;
+}
+
+void HelpSearchIndex::restrictTo(const QSet<QString> &urls)
+{
+  for (quint32 doc = 0; doc < numDocs; doc++) {
+    enabled[doc] = urls.contains(QString::fromUtf8(string(u32(docsOffset + doc * DOC_SIZE))));
+  }
+}
+
+QStringList HelpSearchIndex::tokenize(const QString &text)
+{
+  QStringList words;
+  int start = -1;
+  for (int i = 0; i <= text.size(); i++) {
+    if (i < text.size() && isWordChar(text[i])) {
+      if (start < 0) {
+        start = i;
+      }
+    } else if (start >= 0) {
+      if (i - start > 1) {
+        words << text.mid(start, i - start).toLower();
+      }
+      start = -1;
+    }
+  }
+  return words;
+}
+
+QVector<HelpSearchIndex::Result> HelpSearchIndex::search(const QString &query, int maxResults) const
+{
+  QVector<Result> results;
+  QStringList words = tokenize(query);
+  if (!isLoaded() || words.isEmpty()) {
+    return results;
+  }
+
+  // only complete the last word while it's still being typed
+  bool lastIsPrefix = isWordChar(query[query.size() - 1]);
+
+  QHash<quint16, float> matched;
+  for (int i = 0; i < words.size(); i++) {
+    QByteArray key = words[i].toUtf8();
+    QHash<quint16, float> scores;
+    quint32 t = lowerBound(key);
+
+    if (lastIsPrefix && i == words.size() - 1) {
+      for (int n = 0; t < numTerms && n < MAX_PREFIX_TERMS && strncmp(term(t), key.constData(), key.size()) == 0; t++, n++) {
+        addPostings(t, strcmp(term(t), key.constData()) == 0 ? 1.0f : PREFIX_SCALE, scores);
+      }
+    } else if (t < numTerms && strcmp(term(t), key.constData()) == 0) {
+      addPostings(t, 1.0f, scores);
+    }
+
+    if (i == 0) {
+      matched = scores;
+    } else {
+      for (auto it = matched.begin(); it != matched.end(); ) {
+        auto found = scores.constFind(it.key());
+        if (found == scores.constEnd()) {
+          it = matched.erase(it);
+        } else {
+          it.value() += found.value();
+          ++it;
+        }
+      }
+    }
+
+    if (matched.isEmpty()) {
+      return results;
+    }
+  }
+
+  QVector<QPair<float, quint16> > ranked;
+  ranked.reserve(matched.size());
+  for (auto it = matched.constBegin(); it != matched.constEnd(); ++it) {
+    ranked.append(qMakePair(it.value(), it.key()));
+  }
+  int n = std::min(maxResults, ranked.size());
+  std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(),
+      [](const QPair<float, quint16> &a, const QPair<float, quint16> &b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+      });
+
+  results.reserve(n);
+  for (int i = 0; i < n; i++) {
+    quint32 entry = docsOffset + ranked[i].second * DOC_SIZE;
+    Result r;
+    r.url = QString::fromUtf8(string(u32(entry)));
+    r.title = QString::fromUtf8(string(u32(entry + 4)));
+    r.score = ranked[i].first;
+    results.append(r);
+  }
+  return results;
+}
+
+quint32 HelpSearchIndex::u32(quint32 offset) const
+{
+  return qFromLittleEndian<quint32>(data + offset);
+}
+
+quint16 HelpSearchIndex::u16(quint32 offset) const
+{
+  return qFromLittleEndian<quint16>(data + offset);
+}
+
+const char *HelpSearchIndex::string(quint32 offset) const
+{
+  if ((qint64) stringsOffset + offset >= size) {
+    return "";
+  }
+  return reinterpret_cast<const char *>(data + stringsOffset + offset);
+}
+
+const char *HelpSearchIndex::term(quint32 index) const
+{
+  return string(u32(termsOffset + index * TERM_SIZE));
+}
+
+// Index of the first term not less than key - terms are sorted bytewise
+// which is what strcmp gives us for UTF-8
+quint32 HelpSearchIndex::lowerBound(const QByteArray &key) const
+{
+  quint32 lo = 0, hi = numTerms;
+  while (lo < hi) {
+    quint32 mid = lo + (hi - lo) / 2;
+    if (strcmp(term(mid), key.constData()) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// tf-idf, with the title boost already folded into the stored weights
+void HelpSearchIndex::addPostings(quint32 index, float scale, QHash<quint16, float> &scores) const
+{
+  quint32 entry = termsOffset + index * TERM_SIZE;
+  quint32 first = u32(entry + 4);
+  quint32 count = u32(entry + 8);
+  if (count == 0) {
+    return;
+  }
+  float idf = std::log(1.0f + (float) numDocs / count);
+  for (quint32 j = 0; j < count; j++) {
+    quint32 posting = postingsOffset + (first + j) * POSTING_SIZE;
+    quint16 doc = u16(posting);
+    if (doc < numDocs && enabled[doc]) {
+      scores[doc] += scale * u16(posting + 2) * idf;
+    }
+  }
+}
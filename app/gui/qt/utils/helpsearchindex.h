@@ -0,0 +1,84 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+#ifndef HELPSEARCHINDEX_H
+#define HELPSEARCHINDEX_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Full-text search over the help pages using the inverted index that
+// qt-doc.rb writes alongside them. The index is used in place - mapped
+// straight out of the resource where possible - so nothing is parsed
+// at runtime.
+//
+// Layout (all integers little endian):
+//
+//   header    "SPHI" u32 version, num_docs, num_terms, docs_offset,
+//             terms_offset, postings_offset, strings_offset
+//   docs      num_docs x { u32 url, u32 title }
+//   terms     num_terms x { u32 term, u32 first_posting, u32 num_postings }
+//             sorted bytewise by term
+//   postings  { u16 doc, u16 weight } in doc order for each term
+//   strings   NUL terminated UTF-8, referenced by offset
+//
+// Terms are lowercased runs of letters, digits and underscores at least
+// two characters long. Words in a page's title carry extra weight.
+class HelpSearchIndex
+{
+public:
+  struct Result {
+    QString title;
+    QString url;
+    float score;
+  };
+
+  HelpSearchIndex();
+  ~HelpSearchIndex();
+
+  bool load(const QString &path);
+  bool isLoaded() const;
+
+  // Only return pages with these urls - the index covers the tutorial
+  // in every language but only one is loaded into the help tabs
+  void restrictTo(const QSet<QString> &urls);
+
+  // Every word in the query must match. The last word is treated as a
+  // prefix so results can be shown as you type.
+  QVector<Result> search(const QString &query, int maxResults = 50) const;
+
+  static QStringList tokenize(const QString &text);
+
+private:
+  quint32 u32(quint32 offset) const;
+  quint16 u16(quint32 offset) const;
+  const char *string(quint32 offset) const;
+  const char *term(quint32 index) const;
+  quint32 lowerBound(const QByteArray &key) const;
+  void addPostings(quint32 index, float scale, QHash<quint16, float> &scores) const;
+
+  QFile file;
+  QByteArray buffer;
+  const uchar *data;
+  qint64 size;
+  quint32 numDocs, numTerms;
+  quint32 docsOffset, termsOffset, postingsOffset, stringsOffset;
+  QVector<bool> enabled;
+};
+
+#endif
@@ -0,0 +1,290 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include "processreaper.h"
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#else
+#include <signal.h>
+#include <sys/types.h>
+#include <errno.h>
+#endif
+#if defined(Q_OS_MAC)
+#include <sys/sysctl.h>
+#endif
+
+namespace {
+
+#if defined(Q_OS_WIN)
+  typedef HANDLE ProcessRef;
+
+  ProcessRef openProcess(qint64 pid) {
+    return OpenProcess(PROCESS_TERMINATE | SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD) pid);
+  }
+
+  bool isRunning(qint64, ProcessRef ref) {
+    return WaitForSingleObject(ref, 0) == WAIT_TIMEOUT;
+  }
+
+  // Windows has no polite equivalent of SIGTERM for console processes,
+  // so (just like task-clear.rb) we go straight for the jugular.
+  void terminate(qint64, ProcessRef ref) {
+    TerminateProcess(ref, 1);
+  }
+
+  void forceKill(qint64, ProcessRef ref) {
+    TerminateProcess(ref, 1);
+  }
+
+  void closeProcess(ProcessRef ref) {
+    CloseHandle(ref);
+  }
+#else
+  typedef bool ProcessRef;
+
+  ProcessRef openProcess(qint64 pid) {
+    return kill((pid_t) pid, 0) == 0 || errno == EPERM;
+  }
+
+  bool isRunning(qint64 pid, ProcessRef) {
+    return kill((pid_t) pid, 0) == 0 || errno == EPERM;
+  }
+
+  void terminate(qint64 pid, ProcessRef) {
+    kill((pid_t) pid, SIGTERM);
+  }
+
+  void forceKill(qint64 pid, ProcessRef) {
+    kill((pid_t) pid, SIGKILL);
+  }
+
+  void closeProcess(ProcessRef) {}
+#endif
+
+#if defined(Q_OS_WIN)
+  // The same string WMI's Win32_Process.CommandLine (and so
+  // Sys::ProcTable) reports. ProcessCommandLineInformation needs
+  // Windows 8.1; on anything older the query fails and we leave the
+  // process alone.
+  bool readCommandLine(qint64, ProcessRef ref, QByteArray &out) {
+    typedef LONG (WINAPI *QueryFn)(HANDLE, ULONG, PVOID, ULONG, PULONG);
+    struct CommandLineString {
+      USHORT length;
+      USHORT maximum_length;
+      PWSTR buffer;
+    };
+    const ULONG ProcessCommandLineInformation = 60;
+
+    static QueryFn query = (QueryFn) GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "NtQueryInformationProcess");
+    if (!query) {
+      return false;
+    }
+    ULONG size = 0;
+    query(ref, ProcessCommandLineInformation, nullptr, 0, &size);
+    if (size < sizeof(CommandLineString)) {
+      return false;
+    }
+    std::vector<char> info(size);
+    if (query(ref, ProcessCommandLineInformation, info.data(), size, &size) < 0) {
+      return false;
+    }
+    const CommandLineString *cmdline = (const CommandLineString *) info.data();
+    out = QString::fromWCharArray(cmdline->buffer, cmdline->length / sizeof(wchar_t)).toUtf8();
+    return true;
+  }
+#elif defined(Q_OS_MAC)
+  // KERN_PROCARGS2 is argc, the executable path, padding and then the
+  // NUL separated arguments. Unlike ps it works from inside the
+  // hardened runtime for our own processes.
+  bool readCommandLine(qint64 pid, ProcessRef, QByteArray &out) {
+    int argmax = 0;
+    size_t size = sizeof(argmax);
+    int argmax_mib[2] = { CTL_KERN, KERN_ARGMAX };
+    if (sysctl(argmax_mib, 2, &argmax, &size, nullptr, 0) != 0 || argmax <= 0) {
+      return false;
+    }
+    std::vector<char> args(argmax);
+    size = args.size();
+    int mib[3] = { CTL_KERN, KERN_PROCARGS2, (int) pid };
+    if (sysctl(mib, 3, args.data(), &size, nullptr, 0) != 0 || size < sizeof(int)) {
+      return false;
+    }
+    int argc = 0;
+    memcpy(&argc, args.data(), sizeof(argc));
+    size_t pos = sizeof(argc);
+    while (pos < size && args[pos] != '\0') {
+      pos++;
+    }
+    while (pos < size && args[pos] == '\0') {
+      pos++;
+    }
+    out.clear();
+    for (int i = 0; i < argc && pos < size; i++) {
+      size_t start = pos;
+      while (pos < size && args[pos] != '\0') {
+        pos++;
+      }
+      if (i > 0) {
+        out += ' ';
+      }
+      out += QByteArray(args.data() + start, (int) (pos - start));
+      pos++;
+    }
+    return true;
+  }
+#else
+  bool readCommandLine(qint64 pid, ProcessRef, QByteArray &out) {
+    QFile f(QString("/proc/%1/cmdline").arg(pid));
+    if (!f.open(QIODevice::ReadOnly)) {
+      return false;
+    }
+    out = f.readAll();
+    out.replace('\0', ' ');
+    return true;
+  }
+#endif
+
+#if defined(Q_OS_MAC)
+  // task-register.rb can't read command lines from inside the hardened
+  // runtime, so on macOS it records an empty one. Instead we check the
+  // process was already running when its pid file was written: a pid
+  // that has since been reused belongs to a process started later.
+  // Compared in whole seconds as HFS+ only keeps mtimes to the second.
+  bool startedBefore(qint64 pid, const QDateTime &registered) {
+    struct kinfo_proc info;
+    size_t size = sizeof(info);
+    int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PID, (int) pid };
+    if (sysctl(mib, 4, &info, &size, nullptr, 0) != 0 || size == 0) {
+      return false;
+    }
+    return (qint64) info.kp_proc.p_starttime.tv_sec <= registered.toMSecsSinceEpoch() / 1000;
+  }
+#endif
+
+  // Mirrors task-clear.rb, which only kills a pid whose command line
+  // still matches the one task-register.rb recorded for it. A pid can be
+  // reused by anything once the original process has gone, so if the
+  // process can't be confirmed it is left alone.
+  bool isRegisteredProcess(qint64 pid, ProcessRef ref, const QByteArray &recorded, const QDateTime &registered) {
+    if (recorded.trimmed().isEmpty()) {
+#if defined(Q_OS_MAC)
+      return registered.isValid() && startedBefore(pid, registered);
+#else
+      (void) registered;
+      return false;
+#endif
+    }
+    QByteArray cmdline;
+    if (!readCommandLine(pid, ref, cmdline)) {
+      return false;
+    }
+    return cmdline.trimmed() == recorded.trimmed();
+  }
+
+  struct Registered {
+    qint64 pid;
+    ProcessRef ref;
+  };
+}
+
+QString ProcessReaper::pidsStorePath()
+{
+  return QDir::tempPath() + "/sonic-pi-pids";
+}
+
+// Returns the number of processes which were still running when asked
+// to terminate.
+int ProcessReaper::reapRegistered(int timeout_ms)
+{
+  QDir store(pidsStorePath());
+  if (!store.exists()) {
+    std::cout << "[GUI] - no pids store found at " << store.path().toStdString() << std::endl;
+    return 0;
+  }
+
+  std::vector<Registered> running;
+
+  for (const QString &name : store.entryList(QDir::Files)) {
+    bool ok = false;
+    qint64 pid = name.toLongLong(&ok);
+    QString pid_path = store.filePath(name);
+    if (!ok || pid <= 0) {
+      continue;
+    }
+
+    QByteArray recorded;
+    QDateTime registered = QFileInfo(pid_path).lastModified();
+    QFile pid_file(pid_path);
+    if (pid_file.open(QIODevice::ReadOnly)) {
+      recorded = pid_file.readLine();
+      pid_file.close();
+    }
+    QFile::remove(pid_path);
+
+    ProcessRef ref = openProcess(pid);
+    if (!ref) {
+      continue;
+    }
+    if (!isRunning(pid, ref)) {
+      closeProcess(ref);
+      continue;
+    }
+    if (!isRegisteredProcess(pid, ref, recorded, registered)) {
+      std::cout << "[GUI] - not killing " << pid << ", can't confirm it's the process that was registered" << std::endl;
+      closeProcess(ref);
+      continue;
+    }
+
+    std::cout << "[GUI] - politely killing " << pid << std::endl;
+    terminate(pid, ref);
+    running.push_back({pid, ref});
+  }
+
+  // Give everything the same deadline rather than waiting on each
+  // process in turn.
+  QElapsedTimer timer;
+  timer.start();
+  bool any_running = !running.empty();
+  while (any_running && timer.elapsed() < timeout_ms) {
+    QThread::msleep(10);
+    any_running = false;
+    for (const Registered &r : running) {
+      if (isRunning(r.pid, r.ref)) {
+        any_running = true;
+        break;
+      }
+    }
+  }
+
+  for (const Registered &r : running) {
+    if (isRunning(r.pid, r.ref)) {
+      std::cout << "[GUI] - force killing " << r.pid << std::endl;
+      forceKill(r.pid, r.ref);
+    }
+    closeProcess(r.ref);
+  }
+
+  return (int) running.size();
+}
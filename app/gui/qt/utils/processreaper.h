@@ -0,0 +1,32 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/samaaron/sonic-pi
+// License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+#ifndef PROCESSREAPER_H
+#define PROCESSREAPER_H
+
+#include <QString>
+
+// Native equivalent of task-clear.rb. Walks the pid store written by
+// task-register.rb, asks every registered process that is still running
+// to terminate and force kills any that haven't gone within the timeout.
+// As with task-clear.rb, a process is only touched if its command line
+// still matches the one recorded when it was registered. On macOS, where
+// none is recorded, it must instead have started before it was registered.
+class ProcessReaper
+{
+public:
+  static QString pidsStorePath();
+  static int reapRegistered(int timeout_ms);
+};
+
+#endif
@@ -14,6 +14,11 @@
 
 #include <QDir>
 #include <iostream>
+#include <algorithm>
+#include <utility>
+
+#include <Qsci/qscilexer.h>
+#include <Qsci/qsciscintilla.h>
 
 #include "sonicpiapis.h"
 
@@ -40,6 +45,14 @@ SonicPiAPIs::SonicPiAPIs(QsciLexer *lexer)
   keywords[Tuning] << ":just" << ":pythagorean" << ":meantone" << ":equal";
 
   keywords[MidiParam] << "sustain:" << "velocity:" << "vel:" << "velocity_f:" << "vel_f:" << "port:" << "channel:";
+
+  for (int i = 0; i < NContext; i++) {
+    generation[i] = 0;
+    sortKeywords(i);
+  }
+  fuzzyContext = -1;
+  fuzzyGeneration = 0;
+  fuzzyListShown = false;
 }
 
 
@@ -50,10 +63,13 @@ void SonicPiAPIs::loadSamples(QString sample_path) {
   filetypes << "*.wav" << "*.wave" << "*.aif" << "*.aiff" << "*.flac";
   dir.setNameFilters(filetypes);
 
+  // there can be thousands of these so sort once rather than inserting
+  // each in turn
   QFileInfoList files = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
   foreach (QFileInfo file, files) {
-    addSymbol(Sample, file.baseName());
+    keywords[Sample] << QString(":" + file.baseName());
   }
+  sortKeywords(Sample);
 }
 
 void SonicPiAPIs::addSymbol(int context, QString sym) {
@@ -61,7 +77,28 @@ void SonicPiAPIs::addSymbol(int context, QString sym) {
 }
 
 void SonicPiAPIs::addKeyword(int context, QString keyword) {
-  keywords[context] << keyword;
+  insertKeyword(context, keyword);
+}
+
+// Bulk load from one of the static UTF-8 tables generated into
+// ruby_help.h, sorting once at the end
+void SonicPiAPIs::addKeywords(int context, const char * const *words, int len) {
+  keywords[context].reserve(keywords[context].size() + len);
+  for (int i = 0; i < len; i++) {
+    keywords[context] << QString::fromUtf8(words[i]);
+  }
+  sortKeywords(context);
+}
+
+void SonicPiAPIs::sortKeywords(int context) {
+  keywords[context].sort();
+  generation[context]++;
+}
+
+void SonicPiAPIs::insertKeyword(int context, const QString &keyword) {
+  QStringList &words = keywords[context];
+  words.insert(std::upper_bound(words.begin(), words.end(), keyword), keyword);
+  generation[context]++;
 }
 
 void SonicPiAPIs::addFXArgs(QString fx, QStringList args) {
@@ -73,7 +110,7 @@ void SonicPiAPIs::addSynthArgs(QString fx, QStringList args) {
 }
 
 void SonicPiAPIs::addCuePath(QString path) {
-  keywords[CuePath] << path;
+  insertKeyword(CuePath, path);
 }
 
 void SonicPiAPIs::updateMidiOuts(QString port_info) {
@@ -84,10 +121,118 @@ void SonicPiAPIs::updateMidiOuts(QString port_info) {
     {
       keywords[MidiOuts] << QString("\"%1\"").arg(i);
     }
+  sortKeywords(MidiOuts);
+}
+
+void SonicPiAPIs::prefixMatches(int context, const QString &partial, QStringList &list) {
+  const QStringList &words = keywords[context];
+  auto it = std::lower_bound(words.begin(), words.end(), partial);
+  for (; it != words.end() && it->startsWith(partial); ++it) {
+    list << *it;
+  }
+}
+
+// Scores str as a fuzzy match for the lower case pattern. Every character
+// of the pattern must appear in str in order, otherwise there is no match.
+// Runs of consecutive characters and characters at the start of a word
+// (e.g. the b and h of :bd_haus) score highest, gaps are penalised.
+static bool fuzzyScore(const QString &pattern, const QString &str, int &score) {
+  int p = 0;
+  int last = -1;
+  score = 0;
+  for (int i = 0; i < str.length() && p < pattern.length(); i++) {
+    if (str[i].toLower() != pattern[p]) continue;
+    if (last == i - 1) {
+      score += 5;
+    }
+    if (i == 0 || !str[i - 1].isLetterOrNumber()) {
+      score += 10;
+    }
+    score -= (last < 0) ? i : i - last - 1;
+    last = i;
+    p++;
+  }
+  if (p < pattern.length()) return false;
+  // prefer the shorter of two otherwise equal matches
+  score -= (str.length() - last - 1) / 4;
+  return true;
+}
+
+void SonicPiAPIs::fuzzyMatches(int context, const QString &partial, QStringList &list) {
+  static const int maxFuzzyResults = 20;
+  const QStringList &words = keywords[context];
+  QString pattern = partial.toLower();
+
+  // Typing another character can only ever remove candidates, so start
+  // from the previous hits when the user is still typing the same word
+  QVector<int> candidates;
+  if (fuzzyContext == context && fuzzyGeneration == generation[context] &&
+      !fuzzyPartial.isEmpty() && pattern.startsWith(fuzzyPartial)) {
+    candidates.swap(fuzzyHits);
+  } else {
+    candidates.reserve(words.size());
+    for (int i = 0; i < words.size(); i++) {
+      candidates << i;
+    }
+  }
+
+  QVector<std::pair<int, int> > ranked;
+  fuzzyHits.clear();
+  foreach (int i, candidates) {
+    int score;
+    if (fuzzyScore(pattern, words[i], score)) {
+      fuzzyHits << i;
+      ranked << std::make_pair(-score, i);
+    }
+  }
+  fuzzyContext = context;
+  fuzzyGeneration = generation[context];
+  fuzzyPartial = pattern;
+
+  int n = std::min(maxFuzzyResults, ranked.size());
+  std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end());
+  for (int i = 0; i < n; i++) {
+    list << words[ranked[i].second];
+  }
+}
+
+// QsciScintilla sorts whatever updateAutoCompletionList returns and
+// shows it with Scintilla's auto hide on, which closes the list as soon
+// as no entry starts with the typed word - so a list of fuzzy hits would
+// be scrambled and then vanish. Instead we return nothing for fuzzy hits
+// and show them ourselves, in rank order and without auto hide. Down
+// selects the best hit.
+void SonicPiAPIs::showFuzzyMatches(const QString &partial, const QStringList &list) {
+  QsciScintilla *editor = lexer()->editor();
+  if (!editor) return;
+
+  const char separator = '\x03';
+  editor->SendScintilla(QsciScintilla::SCI_AUTOCSETAUTOHIDE, false);
+  editor->SendScintilla(QsciScintilla::SCI_AUTOCSETORDER, QsciScintilla::SC_ORDER_CUSTOM);
+  editor->SendScintilla(QsciScintilla::SCI_AUTOCSETCHOOSESINGLE, false);
+  editor->SendScintilla(QsciScintilla::SCI_AUTOCSETSEPARATOR, separator);
+  QByteArray words = list.join(QChar(separator)).toUtf8();
+  editor->SendScintilla(QsciScintilla::SCI_AUTOCSHOW, (unsigned long) partial.toUtf8().length(), words.constData());
+  fuzzyListShown = true;
+}
+
+// Puts back the defaults QsciScintilla relies on for prefix lists.
+// Scintilla re-checks an open list against the typed word after we
+// return, so with auto hide back on a stale fuzzy list closes itself.
+void SonicPiAPIs::resetFuzzyList() {
+  if (!fuzzyListShown) return;
+  fuzzyListShown = false;
+
+  QsciScintilla *editor = lexer()->editor();
+  if (!editor) return;
+
+  editor->SendScintilla(QsciScintilla::SCI_AUTOCSETAUTOHIDE, true);
+  editor->SendScintilla(QsciScintilla::SCI_AUTOCSETORDER, QsciScintilla::SC_ORDER_PRESORTED);
 }
 
 void SonicPiAPIs::updateAutoCompletionList(const QStringList &context,
 					   QStringList &list) {
+  resetFuzzyList();
   if (context.isEmpty()) return;
 
   // default
@@ -117,7 +262,7 @@ void SonicPiAPIs::updateAutoCompletionList(const QStringList &context,
        << ", partial = " << partial.toStdString() << endl;
   */
 
-  if (last == "sample" || last == "sample_info" || last == "sample_duration" || last == "use_sample_bpm" || last == "sample_buffer" || last == "sample_loaded?" || last == "load_sample" || last == "load_samples") {
+  if (last == "sample" || last == "sample_info" || last == "sample_duration" || last == "sample_tempo" || last == "use_sample_bpm" || last == "sample_buffer" || last == "sample_loaded?" || last == "load_sample" || last == "load_samples") {
     ctx = Sample;
   } else if (last == "sync" || last == "sync:" || last == "cue" || last == "get" || last == "set" || last == "get[" ) {
     ctx = CuePath;
@@ -185,9 +330,14 @@ void SonicPiAPIs::updateAutoCompletionList(const QStringList &context,
   if (partial == "") {
     list << keywords[ctx];
   } else {
-    foreach (const QString &str, keywords[ctx]) {
-      if (str.startsWith(partial)) {
-	list << str;
+    prefixMatches(ctx, partial, list);
+    // Fall back to fuzzy matching for names (samples, synths, cue paths
+    // etc.) but not for bare words which are most likely user variables
+    if (list.isEmpty() && ctx != Func && partial.length() > 1) {
+      QStringList fuzzy;
+      fuzzyMatches(ctx, partial, fuzzy);
+      if (!fuzzy.isEmpty()) {
+        showFuzzyMatches(partial, fuzzy);
       }
     }
   }
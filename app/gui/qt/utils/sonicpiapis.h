@@ -13,6 +13,7 @@
 
 #include <Qsci/qsciabstractapis.h>
 #include <QHash>
+#include <QVector>
 
 class SonicPiAPIs : public QsciAbstractAPIs
 {
@@ -23,6 +24,7 @@ class SonicPiAPIs : public QsciAbstractAPIs
 
   void addSymbol(int context, QString sym);
   void addKeyword(int context, QString keyword);
+  void addKeywords(int context, const char * const *keywords, int len);
   void addFXArgs(QString fx, QStringList args);
   void addSynthArgs(QString fx, QStringList args);
   void addCuePath(QString path);
@@ -40,7 +42,25 @@ class SonicPiAPIs : public QsciAbstractAPIs
 
 
  private:
+  // Each context is kept sorted so that prefix matches are a contiguous
+  // range found by binary search.
   QStringList keywords[NContext];
   QHash<QString, QStringList> fxArgs;
   QHash<QString, QStringList> synthArgs;
+
+  void sortKeywords(int context);
+  void insertKeyword(int context, const QString &keyword);
+  void prefixMatches(int context, const QString &partial, QStringList &list);
+  void fuzzyMatches(int context, const QString &partial, QStringList &list);
+  void showFuzzyMatches(const QString &partial, const QStringList &list);
+  void resetFuzzyList();
+
+  // Fuzzy matching state from the previous keystroke. While the user keeps
+  // typing in the same context, only the previous hits need rescoring.
+  unsigned int generation[NContext];
+  int fuzzyContext;
+  unsigned int fuzzyGeneration;
+  QString fuzzyPartial;
+  QVector<int> fuzzyHits;
+  bool fuzzyListShown;
 };
@@ -0,0 +1,550 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/sonic-pi-net/sonic-pi
+// License: https://github.com/sonic-pi-net/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2021 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+#include "recorder.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#define ENABLE_SNDFILE_WINDOWS_PROTOTYPES 1
+#endif
+#include <sndfile.h>
+
+#include <visualizer/server_shm.hpp>
+#include "profiler.h"
+
+using namespace std::chrono;
+
+namespace
+{
+const int Channels = 2;
+
+// How much audio can queue up for the encoder before we start dropping it
+const size_t RingSeconds = 10;
+
+// Warn when the ring is half full, and say so again once it has drained
+const double BehindFraction = 0.5;
+const double CaughtUpFraction = 0.25;
+
+// The most frames handed to libsndfile in one go
+const size_t EncodeFrames = 4096;
+
+// FLAC's own default level (5 of 8). For Opus libsndfile maps the level
+// onto 6-256kbps per channel, and 0.64 gives 96kbps per channel.
+const double FlacCompression = 5.0 / 8.0;
+const double OpusCompression = 0.64;
+const int OpusSampleRate = 48000;
+
+bool OpusSupportsRate(int rate)
+{
+    return rate == 8000 || rate == 12000 || rate == 16000 || rate == 24000 || rate == 48000;
+}
+
+int Gcd(int a, int b)
+{
+    while (b != 0)
+    {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+} // namespace
+
+// Opus only takes a handful of sample rates, so audio at anything else
+// (usually 44.1kHz) is converted to 48kHz on the encoder thread. This is
+// a rational resampler: up by m_up, down by m_down, through a Blackman
+// windowed sinc with every one of the m_up phases worked out up front.
+class AudioRecorder::Resampler
+{
+public:
+    static const int HalfTaps = 16;
+    static const int Taps = HalfTaps * 2;
+
+    Resampler(int fromRate, int toRate)
+    {
+        int gcd = Gcd(fromRate, toRate);
+        m_up = toRate / gcd;
+        m_down = fromRate / gcd;
+
+        // In cycles per input sample, a little below the lower Nyquist
+        const double pi = 3.14159265358979323846;
+        const double cutoff = 0.45 * std::min(1.0, double(m_up) / double(m_down));
+
+        m_taps.resize(size_t(m_up) * Taps);
+        for (int phase = 0; phase < m_up; phase++)
+        {
+            float* taps = &m_taps[size_t(phase) * Taps];
+            double sum = 0.0;
+            for (int k = 0; k < Taps; k++)
+            {
+                // Distance of this input sample from the output position
+                double t = double(k - (HalfTaps - 1)) - double(phase) / m_up;
+                double x = 2.0 * cutoff * t;
+                double sinc = x == 0.0 ? 1.0 : std::sin(pi * x) / (pi * x);
+                double u = (t + HalfTaps) / Taps;
+                double window = 0.42 - 0.5 * std::cos(2.0 * pi * u) + 0.08 * std::cos(4.0 * pi * u);
+                taps[k] = float(sinc * window);
+                sum += taps[k];
+            }
+            // Unity gain at DC for every phase
+            for (int k = 0; k < Taps; k++)
+            {
+                taps[k] = float(taps[k] / sum);
+            }
+        }
+
+        // The first output is centred on the first input frame
+        m_history.assign(size_t(HalfTaps - 1) * Channels, 0.0f);
+        m_base = -(HalfTaps - 1);
+    }
+
+    // A 44.1kHz -> 48kHz conversion needs a 160 phase table, but odd
+    // pairs of rates can need far more
+    bool Valid() const
+    {
+        return m_up <= 4096;
+    }
+
+    void Process(const float* in, size_t frames, std::vector<float>& out)
+    {
+        m_history.insert(m_history.end(), in, in + frames * Channels);
+        const int64_t available = int64_t(m_history.size() / Channels);
+
+        out.clear();
+        for (;;)
+        {
+            int64_t first = m_pos - (HalfTaps - 1) - m_base;
+            if (first + Taps > available)
+            {
+                break;
+            }
+            const float* taps = &m_taps[size_t(m_phase) * Taps];
+            const float* x = &m_history[size_t(first) * Channels];
+            float left = 0.0f;
+            float right = 0.0f;
+            for (int k = 0; k < Taps; k++)
+            {
+                left += taps[k] * x[k * Channels];
+                right += taps[k] * x[k * Channels + 1];
+            }
+            out.push_back(left);
+            out.push_back(right);
+
+            m_phase += m_down;
+            m_pos += m_phase / m_up;
+            m_phase %= m_up;
+        }
+
+        // Forget input that no later output can reach
+        int64_t unused = m_pos - (HalfTaps - 1) - m_base;
+        if (unused > 0)
+        {
+            unused = std::min(unused, available);
+            m_history.erase(m_history.begin(), m_history.begin() + size_t(unused) * Channels);
+            m_base += unused;
+        }
+    }
+
+    // Pushes the last few frames out through the filter
+    void Flush(std::vector<float>& out)
+    {
+        std::vector<float> silence(size_t(HalfTaps) * Channels, 0.0f);
+        Process(silence.data(), HalfTaps, out);
+    }
+
+private:
+    int m_up = 1;
+    int m_down = 1;
+    std::vector<float> m_taps;
+
+    // Interleaved input, where m_history[0] is input frame m_base
+    std::vector<float> m_history;
+    int64_t m_base = 0;
+
+    // The next output lies at input frame m_pos + m_phase / m_up
+    int64_t m_pos = 0;
+    int m_phase = 0;
+};
+
+AudioRecorder::AudioRecorder(int scsynthPort, QObject* parent)
+    : QObject(parent)
+    , m_scsynthPort(scsynthPort)
+{
+    // The encoder has closed the file by the time this arrives, so the
+    // join doesn't wait on the disk
+    connect(this, &AudioRecorder::finished, this, [this]() { JoinEncoder(false); }, Qt::QueuedConnection);
+}
+
+AudioRecorder::~AudioRecorder()
+{
+    Stop();
+}
+
+bool AudioRecorder::FormatForPath(const QString& path, Format& format)
+{
+    QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "flac")
+    {
+        format = Format::FLAC;
+        return true;
+    }
+    if (suffix == "opus")
+    {
+        format = Format::Opus;
+        return true;
+    }
+    return false;
+}
+
+bool AudioRecorder::IsRecording() const
+{
+    return m_recording;
+}
+
+bool AudioRecorder::Start(const QString& path, Format format, int scopeNum, int sampleRate, int blockFrames, QString& error)
+{
+    if (m_recording)
+    {
+        error = tr("Already recording");
+        return false;
+    }
+
+    if (m_encodeThread.joinable())
+    {
+        error = tr("Still saving the last recording");
+        return false;
+    }
+
+    if (sampleRate <= 0 || blockFrames <= 0)
+    {
+        error = tr("The audio server didn't say what it is playing at");
+        return false;
+    }
+
+    SF_INFO info = {};
+    info.channels = Channels;
+    info.samplerate = sampleRate;
+    double compression = FlacCompression;
+
+    m_resampler.reset();
+    if (format == Format::FLAC)
+    {
+        info.format = SF_FORMAT_FLAC | SF_FORMAT_PCM_24;
+    }
+    else
+    {
+        info.format = SF_FORMAT_OGG | SF_FORMAT_OPUS;
+        compression = OpusCompression;
+        if (!OpusSupportsRate(sampleRate))
+        {
+            m_resampler.reset(new Resampler(sampleRate, OpusSampleRate));
+            if (!m_resampler->Valid())
+            {
+                m_resampler.reset();
+                error = tr("Can't record Opus at %1Hz, try FLAC instead").arg(sampleRate);
+                return false;
+            }
+            info.samplerate = OpusSampleRate;
+        }
+    }
+
+    try
+    {
+        m_shmClient.reset(new server_shared_memory_client(m_scsynthPort));
+    }
+    catch (const std::exception& e)
+    {
+        m_resampler.reset();
+        error = tr("Could not connect to the audio server: %1").arg(e.what());
+        return false;
+    }
+
+#ifdef _WIN32
+    m_file = sf_wchar_open(reinterpret_cast<LPCWSTR>(path.utf16()), SFM_WRITE, &info);
+#else
+    m_file = sf_open(QFile::encodeName(path).constData(), SFM_WRITE, &info);
+#endif
+    if (!m_file)
+    {
+        m_resampler.reset();
+        m_shmClient.reset();
+        error = tr("Could not open %1 for recording: %2").arg(path, sf_strerror(nullptr));
+        return false;
+    }
+
+    // Integer formats wrap around rather than clip without this
+    sf_command(m_file, SFC_SET_CLIPPING, nullptr, SF_TRUE);
+    if (m_resampler)
+    {
+        int originalRate = sampleRate;
+        sf_command(m_file, SFC_SET_ORIGINAL_SAMPLERATE, &originalRate, sizeof(originalRate));
+    }
+    sf_command(m_file, SFC_SET_COMPRESSION_LEVEL, &compression, sizeof(compression));
+
+    m_path = path;
+    m_scopeNum = scopeNum;
+    m_sampleRate = sampleRate;
+    m_blockFrames = blockFrames;
+
+    m_ringFrames = size_t(sampleRate) * RingSeconds;
+    m_ring.assign(m_ringFrames * Channels, 0.0f);
+    m_writePos.store(0);
+    m_readPos.store(0);
+
+    m_stopCapture.store(false);
+    m_captureDone.store(false);
+    m_encodeDone.store(false);
+    m_failed.store(false);
+    m_behind = false;
+    m_bufferedMs.Set(0);
+
+    m_captureThread = std::thread(&AudioRecorder::CaptureLoop, this);
+    m_encodeThread = std::thread(&AudioRecorder::EncodeLoop, this);
+    m_recording = true;
+    return true;
+}
+
+void AudioRecorder::Stop()
+{
+    Finish();
+
+    // The encoder finishes once it has drained the ring
+    JoinEncoder(true);
+}
+
+void AudioRecorder::Finish()
+{
+    if (!m_recording)
+    {
+        return;
+    }
+
+    // The capture thread polls every few ms, so this is quick
+    m_stopCapture.store(true);
+    m_captureThread.join();
+    m_shmClient.reset();
+    m_recording = false;
+}
+
+void AudioRecorder::JoinEncoder(bool wait)
+{
+    // Unless asked to wait, only join an encoder that has said it's done.
+    // A finished queued from an earlier recording (one Stop already
+    // joined) mustn't hold up the GUI on the current one
+    if (!m_encodeThread.joinable() || (!wait && !m_encodeDone.load(std::memory_order_acquire)))
+    {
+        return;
+    }
+    m_encodeThread.join();
+
+    m_resampler.reset();
+    m_ring.clear();
+    m_ring.shrink_to_fit();
+    m_bufferedMs.Set(0);
+}
+
+size_t AudioRecorder::Buffered() const
+{
+    return size_t(m_writePos.load(std::memory_order_relaxed) - m_readPos.load(std::memory_order_relaxed));
+}
+
+void AudioRecorder::CaptureLoop()
+{
+    SP_SetThreadName("Recorder capture");
+
+    // The tap publishes a block at a time through a triple buffer. If a
+    // second block is published before we've read the first, the first
+    // is lost, so poll well inside a block and count it when we don't.
+    const duration<double> blockTime(double(m_blockFrames) / double(m_sampleRate));
+    const milliseconds pollInterval(5);
+
+    scope_buffer_reader reader = m_shmClient->get_scope_buffer_reader(m_scopeNum);
+
+    uint64_t droppedFrames = 0;
+    auto lastDropReport = steady_clock::now() - seconds(2);
+    auto lastPoll = steady_clock::now();
+    bool seenData = false;
+
+    while (!m_stopCapture.load() && !m_failed.load())
+    {
+        std::this_thread::sleep_for(pollInterval);
+
+        auto now = steady_clock::now();
+        if (seenData && now - lastPoll > blockTime)
+        {
+            m_stalls.Add();
+        }
+        lastPoll = now;
+
+        // The tap allocates its buffer when it first runs
+        if (!reader.valid())
+        {
+            continue;
+        }
+
+        // pull() reports the last block's size whether or not a new one
+        // has arrived; a new block is read from a different region
+        unsigned int frames = 0;
+        const float* previous = reader.data();
+        if (!reader.pull(frames) || reader.data() == previous)
+        {
+            continue;
+        }
+
+        SP_ZoneScopedN("Recorder capture");
+        seenData = true;
+
+        const float* data = reader.data();
+        const unsigned int maxFrames = reader.max_frames();
+        const unsigned int channels = reader.channels();
+
+        const uint64_t write = m_writePos.load(std::memory_order_relaxed);
+        const uint64_t read = m_readPos.load(std::memory_order_acquire);
+        if (write - read + frames > m_ringFrames)
+        {
+            // The encoder is a whole ring behind, so this block is lost
+            m_dropped.Add(frames);
+            droppedFrames += frames;
+            if (now - lastDropReport > seconds(1))
+            {
+                lastDropReport = now;
+                emit framesDropped(double(droppedFrames) / double(m_sampleRate));
+            }
+        }
+        else
+        {
+            // Channels are stored one after the other in the scope buffer
+            for (unsigned int i = 0; i < frames; i++)
+            {
+                size_t slot = size_t((write + i) % m_ringFrames) * Channels;
+                m_ring[slot] = data[i];
+                m_ring[slot + 1] = channels > 1 ? data[maxFrames + i] : data[i];
+            }
+            m_writePos.store(write + frames, std::memory_order_release);
+            m_captured.Add(frames);
+        }
+
+        const size_t buffered = Buffered();
+        const int percent = int(buffered * 100 / m_ringFrames);
+        m_bufferedMs.Set(int64_t(buffered * 1000 / size_t(m_sampleRate)));
+        SP_Plot("Recorder buffered (%)", int64_t(percent));
+        if (!m_behind && buffered > m_ringFrames * BehindFraction)
+        {
+            m_behind = true;
+            emit backpressureChanged(true, percent);
+        }
+        else if (m_behind && buffered < m_ringFrames * CaughtUpFraction)
+        {
+            m_behind = false;
+            emit backpressureChanged(false, percent);
+        }
+    }
+
+    m_captureDone.store(true, std::memory_order_release);
+}
+
+void AudioRecorder::EncodeLoop()
+{
+    SP_SetThreadName("Recorder encode");
+
+    std::vector<float> block(EncodeFrames * Channels);
+    std::vector<float> resampled;
+
+    for (;;)
+    {
+        // Check for the end first, so a block captured just before it
+        // isn't left behind
+        const bool done = m_captureDone.load(std::memory_order_acquire);
+        const uint64_t read = m_readPos.load(std::memory_order_relaxed);
+        const uint64_t write = m_writePos.load(std::memory_order_acquire);
+        const size_t available = size_t(write - read);
+        if (available == 0)
+        {
+            if (done || m_failed.load())
+            {
+                break;
+            }
+            std::this_thread::sleep_for(milliseconds(20));
+            continue;
+        }
+
+        const size_t count = std::min(available, EncodeFrames);
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t slot = size_t((read + i) % m_ringFrames) * Channels;
+            block[i * Channels] = m_ring[slot];
+            block[i * Channels + 1] = m_ring[slot + 1];
+        }
+        m_readPos.store(read + count, std::memory_order_release);
+
+        bool ok;
+        if (m_resampler)
+        {
+            m_resampler->Process(block.data(), count, resampled);
+            ok = Write(resampled.data(), resampled.size() / Channels);
+        }
+        else
+        {
+            ok = Write(block.data(), count);
+        }
+
+        if (!ok)
+        {
+            m_failed.store(true);
+            break;
+        }
+    }
+
+    if (m_resampler && !m_failed.load())
+    {
+        m_resampler->Flush(resampled);
+        Write(resampled.data(), resampled.size() / Channels);
+    }
+
+    sf_close(m_file);
+    m_file = nullptr;
+
+    m_encodeDone.store(true, std::memory_order_release);
+    emit finished(m_path, !m_failed.load());
+}
+
+bool AudioRecorder::Write(const float* frames, size_t count)
+{
+    if (count == 0)
+    {
+        return true;
+    }
+
+    SP_ZoneScopedN("Recorder write");
+    auto start = steady_clock::now();
+    sf_count_t written = sf_writef_float(m_file, frames, sf_count_t(count));
+    m_writeMs.Record(duration<double, std::milli>(steady_clock::now() - start).count());
+
+    if (written != sf_count_t(count))
+    {
+        emit failed(tr("Recording stopped, could not write to the file: %1").arg(sf_strerror(m_file)));
+        return false;
+    }
+    m_encoded.Add(count);
+    return true;
+}
@@ -0,0 +1,123 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/sonic-pi-net/sonic-pi
+// License: https://github.com/sonic-pi-net/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2021 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "api/metrics.h"
+
+namespace detail_server_shm {
+class server_shared_memory_client;
+}
+typedef struct SNDFILE_tag SNDFILE;
+
+// Records what scsynth is playing straight to a compressed file.
+//
+// The server runs a second scope synth (the recording tap) that copies
+// its output into a scope buffer in shared memory, a block at a time.
+// A capture thread copies each new block into a ring buffer, and an
+// encoder thread drains the ring through libsndfile to the file the
+// user picked, so nothing uncompressed ever reaches the disk.
+//
+// The ring holds RingSeconds of audio, so a slow disk only delays the
+// encoder. If it falls further behind than that, whole blocks are
+// dropped rather than stalling the capture, and both are reported.
+class AudioRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Format
+    {
+        FLAC,
+        Opus
+    };
+
+    AudioRecorder(int scsynthPort, QObject* parent = nullptr);
+    ~AudioRecorder();
+
+    // Opens the file and starts both threads, with the details the
+    // server sent back when it started the tap
+    bool Start(const QString& path, Format format, int scopeNum, int sampleRate, int blockFrames, QString& error);
+
+    // Stops capturing straight away. The encoder carries on with what
+    // is already buffered, closes the file and then emits finished, so
+    // a slow disk doesn't hold up the caller
+    void Finish();
+
+    // As Finish, but waits for the file to be closed
+    void Stop();
+
+    // True while capturing, not while the last file is still finishing
+    bool IsRecording() const;
+
+    static bool FormatForPath(const QString& path, Format& format);
+
+signals:
+    // These are emitted from the recorder's threads
+    void backpressureChanged(bool behind, int percentBuffered);
+    void framesDropped(double seconds);
+    void failed(QString error);
+    // Emitted from the encoder once the file is closed. saved is false if
+    // writing failed part way through
+    void finished(QString path, bool saved);
+
+private:
+    void JoinEncoder(bool wait);
+    void CaptureLoop();
+    void EncodeLoop();
+    bool Write(const float* frames, size_t count);
+    size_t Buffered() const;
+
+    int m_scsynthPort;
+    QString m_path;
+    int m_scopeNum = 0;
+    int m_sampleRate = 0;
+    int m_blockFrames = 0;
+
+    std::unique_ptr<detail_server_shm::server_shared_memory_client> m_shmClient;
+    SNDFILE* m_file = nullptr;
+
+    class Resampler;
+    std::unique_ptr<Resampler> m_resampler;
+
+    // Interleaved stereo, written by the capture thread and read by the
+    // encoder. The positions only ever grow and are taken modulo the
+    // ring size.
+    std::vector<float> m_ring;
+    size_t m_ringFrames = 0;
+    std::atomic<uint64_t> m_writePos = { 0 };
+    std::atomic<uint64_t> m_readPos = { 0 };
+
+    std::thread m_captureThread;
+    std::thread m_encodeThread;
+    std::atomic<bool> m_stopCapture = { false };
+    std::atomic<bool> m_captureDone = { false };
+    std::atomic<bool> m_encodeDone = { false };
+    std::atomic<bool> m_failed = { false };
+    bool m_recording = false;
+    bool m_behind = false;
+
+    SonicPi::Metrics::Counter& m_captured { SonicPi::Metrics::GetCounter("recorder.frames_captured") };
+    SonicPi::Metrics::Counter& m_encoded { SonicPi::Metrics::GetCounter("recorder.frames_encoded") };
+    SonicPi::Metrics::Counter& m_dropped { SonicPi::Metrics::GetCounter("recorder.frames_dropped") };
+    SonicPi::Metrics::Counter& m_stalls { SonicPi::Metrics::GetCounter("recorder.capture_stalls") };
+    SonicPi::Metrics::Gauge& m_bufferedMs { SonicPi::Metrics::GetGauge("recorder.buffered_ms") };
+    SonicPi::Metrics::Histogram& m_writeMs { SonicPi::Metrics::GetHistogram("recorder.write_ms", SonicPi::Metrics::Histogram::LatencyMsBounds()) };
+};
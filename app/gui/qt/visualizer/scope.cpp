@@ -34,6 +34,7 @@
 #include "dpi.h"
 
 #include "kiss_fft/kiss_fft.h"
+#include "api/metrics.h"
 
 namespace
 {
@@ -59,7 +60,10 @@ inline std::vector<float> createWindow(uint32_t size)
 } // namespace
 
 AudioProcessingThread::AudioProcessingThread(int synthPort)
-    : m_scsynthPort(synthPort)
+    : m_arena(64 * 1024)
+    , m_scsynthPort(synthPort)
+    , m_spectrumPartitions(SonicPi::Memory::ArenaAllocator<float>(m_arena))
+    , m_processedAudio(m_arena)
 {
     SetupFFT();
 }
@@ -90,6 +94,11 @@ void AudioProcessingThread::SetupFFT()
     m_processedAudio.m_spectrum[0].resize(FrameSamples / 2, (0));
     m_processedAudio.m_spectrum[1].resize(FrameSamples / 2, (0));
 
+    // There are at most FrameSamples / 16 buckets, see CalculateFFT
+    m_processedAudio.m_spectrumQuantized[0].reserve(FrameSamples / 16);
+    m_processedAudio.m_spectrumQuantized[1].reserve(FrameSamples / 16);
+    m_spectrumPartitions.reserve(FrameSamples / 16 + 2);
+
     // Hamming window
     m_window = createWindow(FrameSamples);
     m_totalWin = 0.0f;
@@ -159,6 +168,7 @@ void AudioProcessingThread::GenLinSpace(uint32_t limit, uint32_t n)
 void AudioProcessingThread::CalculateFFT(ProcessedAudio& audio)
 {
     SP_ZoneScopedN("FFT");
+    SonicPi::Memory::RealtimeScope realtime;
 
     if (!m_calculateFFT.load())
     {
@@ -265,6 +275,10 @@ void AudioProcessingThread::ResetConnection()
 
 void AudioProcessingThread::run()
 {
+    auto& frameCount = SonicPi::Metrics::GetCounter("scope.frames");
+    auto& droppedFrames = SonicPi::Metrics::GetCounter("scope.frames_dropped");
+    auto& emptyReads = SonicPi::Metrics::GetCounter("scope.empty_reads");
+
     for (;;)
     {
         // We are done
@@ -300,6 +314,7 @@ void AudioProcessingThread::run()
         // We want to try again pretty soon, but we don't want to spin while the UI is doing its thing
         if (!m_processedAudio.m_consumed.load())
         {
+            droppedFrames.Add();
             std::this_thread::sleep_until(nextTime);
             continue;
         }
@@ -312,6 +327,7 @@ void AudioProcessingThread::run()
             {
                 {
                     SP_ZoneScopedN("Shared Memory");
+                    SonicPi::Memory::RealtimeScope realtime;
                     m_emptyFrames = 0;
                     float* data = m_shmReader.data();
                     for (unsigned int j = 0; j < 2; ++j)
@@ -347,12 +363,14 @@ void AudioProcessingThread::run()
                 CalculateFFT(m_processedAudio);
 
                 m_processedAudio.m_consumed.store(false);
+                frameCount.Add();
 
                 // Tell the UI to update
                 emit update();
             }
             else
             {
+                emptyReads.Add();
                 ++m_emptyFrames;
                 if (m_emptyFrames > 10)
                 {
@@ -27,6 +27,7 @@
 
 #include "kiss_fft/kiss_fft.h"
 #include "profiler.h"
+#include "api/arena.h"
 
 QT_FORWARD_DECLARE_CLASS(QPaintEvent)
 QT_FORWARD_DECLARE_CLASS(QResizeEvent)
@@ -68,9 +69,16 @@ struct Panel
 // This is the processed audio data from the thread
 struct ProcessedAudio
 {
+    explicit ProcessedAudio(SonicPi::Memory::Arena& arena)
+        : m_spectrumQuantized{ SonicPi::Memory::ArenaVector<float>(SonicPi::Memory::ArenaAllocator<float>(arena)),
+                               SonicPi::Memory::ArenaVector<float>(SonicPi::Memory::ArenaAllocator<float>(arena)) }
+    {
+    }
+
     SP_Lockable(std::mutex, m_mutex);
     std::vector<float> m_spectrum[2];
-    std::vector<float> m_spectrumQuantized[2];
+    // Resized with the window, from the audio thread
+    SonicPi::Memory::ArenaVector<float> m_spectrumQuantized[2];
     std::vector<std::vector<double>> m_samples;
     std::vector<double> m_monoSamples;
     std::atomic<bool> m_consumed = {true};
@@ -102,6 +110,11 @@ private:
     void CalculateFFT(ProcessedAudio& audio);
 
 private:
+    // Backs the containers the audio thread resizes as it runs, so the
+    // pull and FFT never touch the global heap. Declared first, as the
+    // containers below allocate from it.
+    SonicPi::Memory::Arena m_arena;
+
     std::unique_ptr<server_shared_memory_client> m_shmClient;
     scope_buffer_reader m_shmReader;
 
@@ -119,7 +132,7 @@ private:
     std::vector<std::complex<float>> m_fftOut[2];
     std::vector<float> m_fftMag[2];
     std::vector<float> m_window;
-    std::vector<float> m_spectrumPartitions;
+    SonicPi::Memory::ArenaVector<float> m_spectrumPartitions;
     std::pair<uint32_t, uint32_t> m_lastSpectrumPartitions = { 0, 0 };
 
     // Output data, double buffered
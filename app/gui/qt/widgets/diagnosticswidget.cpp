@@ -0,0 +1,112 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/sonic-pi-net/sonic-pi
+// License: https://github.com/sonic-pi-net/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2021 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+#include <QHeaderView>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include "diagnosticswidget.h"
+#include "api/metrics.h"
+
+DiagnosticsWidget::DiagnosticsWidget(QWidget *parent) : QWidget(parent)
+{
+    tree = new QTreeWidget;
+    tree->setColumnCount(3);
+    tree->setHeaderLabels(QStringList() << tr("Metric") << tr("Value") << tr("Change/s"));
+    tree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    tree->setRootIsDecorated(true);
+    tree->setUniformRowHeights(true);
+    tree->setFocusPolicy(Qt::NoFocus);
+
+    QVBoxLayout *layout = new QVBoxLayout;
+    layout->setMargin(0);
+    layout->addWidget(tree);
+    setLayout(layout);
+
+    // The GUI's own metrics are read straight from the registry, and only
+    // while the pane is showing
+    timer = new QTimer(this);
+    timer->setInterval(1000);
+    connect(timer, SIGNAL(timeout()), this, SLOT(refreshLocal()));
+
+    clock.start();
+}
+
+void DiagnosticsWidget::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    refreshLocal();
+    timer->start();
+    emit subscriptionChanged(true);
+}
+
+void DiagnosticsWidget::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    timer->stop();
+    emit subscriptionChanged(false);
+}
+
+void DiagnosticsWidget::refreshLocal()
+{
+    for (const auto& sample : SonicPi::Metrics::Registry::Global().Snapshot())
+    {
+        setMetric("gui", QString::fromStdString(sample.name), sample.value);
+    }
+}
+
+void DiagnosticsWidget::updateMetrics(QString source, QStringList names, QVariantList values)
+{
+    if (!isVisible())
+    {
+        return;
+    }
+    for (int i = 0; i < names.size() && i < values.size(); i++)
+    {
+        setMetric(source, names[i], values[i].toDouble());
+    }
+}
+
+void DiagnosticsWidget::setMetric(const QString &source, const QString &name, double value)
+{
+    qint64 now = clock.elapsed();
+    QString key = source + "/" + name;
+    auto it = rows.find(key);
+    if (it == rows.end())
+    {
+        QTreeWidgetItem *parent = sources.value(source);
+        if (!parent)
+        {
+            parent = new QTreeWidgetItem(tree, QStringList() << source);
+            parent->setExpanded(true);
+            sources.insert(source, parent);
+        }
+        Row row { new QTreeWidgetItem(parent, QStringList() << name), value, now };
+        row.item->setTextAlignment(1, Qt::AlignRight);
+        row.item->setTextAlignment(2, Qt::AlignRight);
+        row.item->setText(1, QString::number(value, 'g', 6));
+        rows.insert(key, row);
+        parent->sortChildren(0, Qt::AscendingOrder);
+        return;
+    }
+
+    Row &row = it.value();
+    row.item->setText(1, QString::number(value, 'g', 6));
+    if (now > row.updatedMs)
+    {
+        double rate = (value - row.value) * 1000.0 / (now - row.updatedMs);
+        row.item->setText(2, rate == 0.0 ? QString() : QString::number(rate, 'f', 1));
+    }
+    row.value = value;
+    row.updatedMs = now;
+}
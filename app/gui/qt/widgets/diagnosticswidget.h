@@ -0,0 +1,66 @@
+//--
+// This file is part of Sonic Pi: http://sonic-pi.net
+// Full project source: https://github.com/sonic-pi-net/sonic-pi
+// License: https://github.com/sonic-pi-net/sonic-pi/blob/main/LICENSE.md
+//
+// Copyright 2021 by Sam Aaron (http://sam.aaron.name).
+// All rights reserved.
+//
+// Permission is granted for use, copying, modification, and
+// distribution of modified versions of this work as long as this
+// notice is included.
+//++
+
+#ifndef DIAGNOSTICSWIDGET_H
+#define DIAGNOSTICSWIDGET_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVariantList>
+#include <QWidget>
+
+class QTimer;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+// Shows the GUI's own metrics alongside those published by the Ruby
+// server and sp_midi, with how fast each is changing so that a growing
+// backlog stands out.
+class DiagnosticsWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit DiagnosticsWidget(QWidget *parent = 0);
+
+signals:
+    // The server only publishes metrics while the pane is visible
+    void subscriptionChanged(bool subscribed);
+
+public slots:
+    void updateMetrics(QString source, QStringList names, QVariantList values);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void refreshLocal();
+
+private:
+    struct Row
+    {
+        QTreeWidgetItem *item;
+        double value;
+        qint64 updatedMs;
+    };
+
+    void setMetric(const QString &source, const QString &name, double value);
+
+    QTreeWidget *tree;
+    QTimer *timer;
+    QElapsedTimer clock;
+    QHash<QString, QTreeWidgetItem *> sources;
+    QHash<QString, Row> rows;
+};
+
+#endif // DIAGNOSTICSWIDGET_H
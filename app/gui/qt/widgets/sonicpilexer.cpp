@@ -18,8 +18,8 @@
 
 SonicPiLexer::SonicPiLexer(SonicPiTheme *theme) : QsciLexerRuby() {
     this->theme = theme;
-    this->setDefaultColor(theme->color("Foreground"));
-    this->setDefaultPaper(theme->color("Background"));
+    this->setDefaultColor(theme->color(SonicPiTheme::Foreground));
+    this->setDefaultPaper(theme->color(SonicPiTheme::Background));
 }
 
 static char default_font[] = "Hack";
@@ -31,43 +31,36 @@ QStringList SonicPiLexer::autoCompletionWordSeparators() const {
   return seps;
 }
 
-void SonicPiLexer::highlightAll()
-{
-    setPaper(theme->color("SelectionBackground"), -1);
-    setColor(theme->color("SelectionForeground"), -1);
-    this->setDefaultPaper(theme->color("Background"));
-}
-
 void SonicPiLexer::unhighlightAll()
 {
-    setPaper(theme->color("Background"));
-    setColor(theme->color("Foreground"));
-
-    setColor(theme->color("DefaultForeground"), Default);
-    setColor(theme->color("CommentForeground"),Comment);
-    setColor(theme->color("PODForeground"),POD);
-    setColor(theme->color("NumberForeground"),Number);
-    setColor(theme->color("FunctionMethodNameForeground"),FunctionMethodName);
-    setColor(theme->color("KeywordForeground"),Keyword);
-    setColor(theme->color("DemotedKeywordForeground"),DemotedKeyword);
-    setColor(theme->color("DoubleQuotedStringForeground"),DoubleQuotedString);
-    setColor(theme->color("SingleQuotedStringForeground"),SingleQuotedString);
-    setColor(theme->color("HereDocumentForeground"),HereDocument);
-    setColor(theme->color("PercentStringqForeground"),PercentStringq);
-    setColor(theme->color("PercentStringQForeground"),PercentStringQ);
-    setColor(theme->color("ClassNameForeground"),ClassName);
-    setColor(theme->color("RegexForeground"),Regex);
-    setColor(theme->color("HereDocumentDelimiterForeground"),HereDocumentDelimiter);
-    setColor(theme->color("PercentStringrForeground"),PercentStringr);
-    setColor(theme->color("PercentStringwForeground"),PercentStringw);
-    setColor(theme->color("GlobalForeground"),Global);
-    setColor(theme->color("SymbolForeground"),Symbol);
-    setColor(theme->color("ModuleNameForeground"),ModuleName);
-    setColor(theme->color("InstanceVariableForeground"),InstanceVariable);
-    setColor(theme->color("ClassVariableForeground"),ClassVariable);
-    setColor(theme->color("BackticksForeground"),Backticks);
-    setColor(theme->color("PercentStringxForeground"),PercentStringx);
-    setColor(theme->color("DataSectionForeground"),DataSection);
+    setPaper(theme->color(SonicPiTheme::Background));
+    setColor(theme->color(SonicPiTheme::Foreground));
+
+    setColor(theme->color(SonicPiTheme::DefaultForeground), Default);
+    setColor(theme->color(SonicPiTheme::CommentForeground),Comment);
+    setColor(theme->color(SonicPiTheme::PODForeground),POD);
+    setColor(theme->color(SonicPiTheme::NumberForeground),Number);
+    setColor(theme->color(SonicPiTheme::FunctionMethodNameForeground),FunctionMethodName);
+    setColor(theme->color(SonicPiTheme::KeywordForeground),Keyword);
+    setColor(theme->color(SonicPiTheme::DemotedKeywordForeground),DemotedKeyword);
+    setColor(theme->color(SonicPiTheme::DoubleQuotedStringForeground),DoubleQuotedString);
+    setColor(theme->color(SonicPiTheme::SingleQuotedStringForeground),SingleQuotedString);
+    setColor(theme->color(SonicPiTheme::HereDocumentForeground),HereDocument);
+    setColor(theme->color(SonicPiTheme::PercentStringqForeground),PercentStringq);
+    setColor(theme->color(SonicPiTheme::PercentStringQForeground),PercentStringQ);
+    setColor(theme->color(SonicPiTheme::ClassNameForeground),ClassName);
+    setColor(theme->color(SonicPiTheme::RegexForeground),Regex);
+    setColor(theme->color(SonicPiTheme::HereDocumentDelimiterForeground),HereDocumentDelimiter);
+    setColor(theme->color(SonicPiTheme::PercentStringrForeground),PercentStringr);
+    setColor(theme->color(SonicPiTheme::PercentStringwForeground),PercentStringw);
+    setColor(theme->color(SonicPiTheme::GlobalForeground),Global);
+    setColor(theme->color(SonicPiTheme::SymbolForeground),Symbol);
+    setColor(theme->color(SonicPiTheme::ModuleNameForeground),ModuleName);
+    setColor(theme->color(SonicPiTheme::InstanceVariableForeground),InstanceVariable);
+    setColor(theme->color(SonicPiTheme::ClassVariableForeground),ClassVariable);
+    setColor(theme->color(SonicPiTheme::BackticksForeground),Backticks);
+    setColor(theme->color(SonicPiTheme::PercentStringxForeground),PercentStringx);
+    setColor(theme->color(SonicPiTheme::DataSectionForeground),DataSection);
 }
 
 QColor SonicPiLexer::defaultColor(int style) const
@@ -75,55 +68,55 @@ QColor SonicPiLexer::defaultColor(int style) const
     switch (style)
     {
     case Default:
-      return theme->color("DefaultForeground");
+      return theme->color(SonicPiTheme::DefaultForeground);
     case Comment:
-      return theme->color("CommentForeground");
+      return theme->color(SonicPiTheme::CommentForeground);
     case POD:
-      return theme->color("PODForeground");
+      return theme->color(SonicPiTheme::PODForeground);
     case Number:
-      return theme->color("NumberForeground");
+      return theme->color(SonicPiTheme::NumberForeground);
     case FunctionMethodName:
-      return theme->color("FunctionMethodNameForeground");
+      return theme->color(SonicPiTheme::FunctionMethodNameForeground);
     case Keyword:
-      return theme->color("KeywordForeground");
+      return theme->color(SonicPiTheme::KeywordForeground);
     case DemotedKeyword:
-      return theme->color("DemotedKeywordForeground");
+      return theme->color(SonicPiTheme::DemotedKeywordForeground);
     case DoubleQuotedString:
-      return theme->color("DoubleQuotedStringForeground");
+      return theme->color(SonicPiTheme::DoubleQuotedStringForeground);
     case SingleQuotedString:
-      return theme->color("SingleQuotedStringForeground");
+      return theme->color(SonicPiTheme::SingleQuotedStringForeground);
     case HereDocument:
-      return theme->color("HereDocumentForeground");
+      return theme->color(SonicPiTheme::HereDocumentForeground);
     case PercentStringq:
-      return theme->color("PercentStringqForeground");
+      return theme->color(SonicPiTheme::PercentStringqForeground);
     case PercentStringQ:
-      return theme->color("PercentStringQForeground");
+      return theme->color(SonicPiTheme::PercentStringQForeground);
     case ClassName:
-      return theme->color("ClassNameForeground");
+      return theme->color(SonicPiTheme::ClassNameForeground);
     case Regex:
-      return theme->color("RegexForeground");
+      return theme->color(SonicPiTheme::RegexForeground);
     case HereDocumentDelimiter:
-      return theme->color("HereDocumentDelimiterForeground");
+      return theme->color(SonicPiTheme::HereDocumentDelimiterForeground);
     case PercentStringr:
-      return theme->color("PercentStringrForeground");
+      return theme->color(SonicPiTheme::PercentStringrForeground);
     case PercentStringw:
-      return theme->color("PercentStringwForeground");
+      return theme->color(SonicPiTheme::PercentStringwForeground);
     case Global:
-      return theme->color("GlobalForeground");
+      return theme->color(SonicPiTheme::GlobalForeground);
     case Symbol:
-      return theme->color("SymbolForeground");
+      return theme->color(SonicPiTheme::SymbolForeground);
     case ModuleName:
-      return theme->color("ModuleNameForeground");
+      return theme->color(SonicPiTheme::ModuleNameForeground);
     case InstanceVariable:
-      return theme->color("InstanceVariableForeground");
+      return theme->color(SonicPiTheme::InstanceVariableForeground);
     case ClassVariable:
-      return theme->color("ClassVariableForeground");
+      return theme->color(SonicPiTheme::ClassVariableForeground);
     case Backticks:
-      return theme->color("BackticksForeground");
+      return theme->color(SonicPiTheme::BackticksForeground);
     case PercentStringx:
-      return theme->color("PercentStringxForeground");
+      return theme->color(SonicPiTheme::PercentStringxForeground);
     case DataSection:
-      return theme->color("DataSectionForeground");
+      return theme->color(SonicPiTheme::DataSectionForeground);
     }
 
     return QsciLexer::defaultColor(style);
@@ -136,63 +129,63 @@ QColor SonicPiLexer::defaultPaper(int style) const
   switch (style)
   {
     case Default:
-      return theme->color("DefaultBackground");
+      return theme->color(SonicPiTheme::DefaultBackground);
     case Comment:
-       return theme->color("CommentBackground");
+       return theme->color(SonicPiTheme::CommentBackground);
     case Error:
-      return theme->color("ErrorBackground");
+      return theme->color(SonicPiTheme::ErrorBackground);
     case POD:
-      return theme->color("PODBackground");
+      return theme->color(SonicPiTheme::PODBackground);
     case Regex:
-      return theme->color("RegexBackground");
+      return theme->color(SonicPiTheme::RegexBackground);
     case PercentStringr:
-      return theme->color("PercentStringrBackground");
+      return theme->color(SonicPiTheme::PercentStringrBackground);
     case Backticks:
-      return theme->color("BackticksBackground");
+      return theme->color(SonicPiTheme::BackticksBackground);
     case PercentStringx:
-      return theme->color("PercentStringxBackground");
+      return theme->color(SonicPiTheme::PercentStringxBackground);
     case DataSection:
-      return theme->color("DataSectionBackground");
+      return theme->color(SonicPiTheme::DataSectionBackground);
     case HereDocumentDelimiter:
-      return theme->color("DocumentDelimiterBackground");
+      return theme->color(SonicPiTheme::DocumentDelimiterBackground);
     case HereDocument:
-      return theme->color("HereDocumentBackground");
+      return theme->color(SonicPiTheme::HereDocumentBackground);
     case PercentStringw:
-      return theme->color("PercentStringwBackground");
+      return theme->color(SonicPiTheme::PercentStringwBackground);
     case Stdin:
-      return theme->color("StdinBackground");
+      return theme->color(SonicPiTheme::StdinBackground);
     case Stdout:
-      return theme->color("StdoutBackground");
+      return theme->color(SonicPiTheme::StdoutBackground);
     case Stderr:
-      return theme->color("StderrBackground");
+      return theme->color(SonicPiTheme::StderrBackground);
     case FunctionMethodName:
-      return theme->color("FunctionMethodNameBackground");
+      return theme->color(SonicPiTheme::FunctionMethodNameBackground);
     case Number:
-     return theme->color("NumberBackground");
+     return theme->color(SonicPiTheme::NumberBackground);
     case Keyword:
-      return theme->color("KeywordBackground");
+      return theme->color(SonicPiTheme::KeywordBackground);
     case DemotedKeyword:
-      return theme->color("DemotedKeywordBackground");
+      return theme->color(SonicPiTheme::DemotedKeywordBackground);
     case DoubleQuotedString:
-      return theme->color("DoubleQuotedStringBackground");
+      return theme->color(SonicPiTheme::DoubleQuotedStringBackground);
     case SingleQuotedString:
-      return theme->color("SingleQuotedStringBackground");
+      return theme->color(SonicPiTheme::SingleQuotedStringBackground);
     case PercentStringq:
-      return theme->color("PercentStringqBackground");
+      return theme->color(SonicPiTheme::PercentStringqBackground);
     case PercentStringQ:
-      return theme->color("PercentStringQBackground");
+      return theme->color(SonicPiTheme::PercentStringQBackground);
     case ClassName:
-      return theme->color("ClassNameBackground");
+      return theme->color(SonicPiTheme::ClassNameBackground);
     case Global:
-      return theme->color("GlobalBackground");
+      return theme->color(SonicPiTheme::GlobalBackground);
     case Symbol:
-      return theme->color("SymbolBackground");
+      return theme->color(SonicPiTheme::SymbolBackground);
     case ModuleName:
-      return theme->color("ModuleNameBackground");
+      return theme->color(SonicPiTheme::ModuleNameBackground);
     case InstanceVariable:
-      return theme->color("InstanceVariableBackground");
+      return theme->color(SonicPiTheme::InstanceVariableBackground);
     case ClassVariable:
-      return theme->color("ClassVariableBackground");
+      return theme->color(SonicPiTheme::ClassVariableBackground);
   }
   return QsciLexer::defaultPaper(style);
 }
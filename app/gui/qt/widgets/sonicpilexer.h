@@ -31,6 +31,5 @@ private:
   SonicPiTheme *theme;
 
 public slots:
-  void highlightAll();
   void unhighlightAll();
 };
@@ -18,6 +18,8 @@
 #include <vector>
 #include "model/sonicpitheme.h"
 #include <QScrollBar>
+#include "profiler.h"
+#include "api/metrics.h"
 
 SonicPiLog::SonicPiLog(QWidget *parent) : QPlainTextEdit(parent)
 {
@@ -76,20 +78,29 @@ void SonicPiLog::appendPlainText(QString text)
 
 void SonicPiLog::handleMultiMessage(SonicPiLog::MultiMessage mm)
 {
+    SP_ZoneScopedN("SonicPiLog::handleMultiMessage");
+    // log.backlog is incremented by OscHandler as each message is queued
+    static auto& backlog = SonicPi::Metrics::GetGauge("log.backlog");
+    static auto& latency = SonicPi::Metrics::GetHistogram("log.latency_ms", SonicPi::Metrics::Histogram::LatencyMsBounds());
+    double latencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mm.received).count();
+    backlog.Add(-1);
+    latency.Record(latencyMs);
+    SP_Plot("Log queue depth", backlog.Get());
+    SP_Plot("Log queue latency (ms)", latencyMs);
     int msg_count = int(mm.messages.size());
     SonicPiTheme *theme = mm.theme;
 
     QTextCharFormat tf;
     QString ss;
 
-    tf.setForeground(theme->color("LogForeground"));
-    tf.setBackground(theme->color("LogBackground"));
+    tf.setForeground(theme->color(SonicPiTheme::LogForeground));
+    tf.setBackground(theme->color(SonicPiTheme::LogBackground));
     setCurrentCharFormat(tf);
 
     ss.append("{run: ").append(QString::number(mm.job_id));
-    ss.append(", time: ").append(QString::fromStdString(mm.runtime));
+    ss.append(", time: ").append(mm.runtime);
     if(! (mm.thread_name == "\"\"")) {
-      ss.append(", thread: ").append(QString::fromStdString(mm.thread_name));
+      ss.append(", thread: ").append(mm.thread_name);
     }
     ss.append("}");
     appendPlainText(ss);
@@ -97,11 +108,11 @@ void SonicPiLog::handleMultiMessage(SonicPiLog::MultiMessage mm)
     for(int i = 0 ; i < msg_count ; i++) {
       ss = "";
       int msg_type = mm.messages[i].msg_type;
-      std::string s = mm.messages[i].s;
+      const QString &s = mm.messages[i].s;
 
-      QStringList lines = QString::fromUtf8(s.c_str()).split(QRegExp("\\n"));
+      QStringList lines = s.split(QChar('\n'));
 
-      if (s.empty()) {
+      if (s.isEmpty()) {
           ss.append(QString::fromUtf8(" │"));
         }
       else if(i == (msg_count - 1)) {
@@ -112,47 +123,45 @@ void SonicPiLog::handleMultiMessage(SonicPiLog::MultiMessage mm)
 
       appendPlainText(ss);
 
-      for (int j = 0; j < lines.size(); ++j) {
-        switch(msg_type)
-          {
-          case 0:
-             tf.setForeground(theme->color("LogForeground"));
-             tf.setBackground(theme->color("LogBackground"));
-            break;
-          case 1:
-            tf.setForeground(theme->color("LogForeground_1"));
-            tf.setBackground(theme->color("LogBackground_1"));
-            break;
-          case 2:
-            tf.setForeground(theme->color("LogForeground_2"));
-            tf.setBackground(theme->color("LogBackground_2"));
-            break;
-          case 3:
-            tf.setForeground(theme->color("LogForeground_3"));
-            tf.setBackground(theme->color("LogBackground_3"));
-            break;
-          case 4:
-            tf.setForeground(theme->color("LogForeground_4"));
-            tf.setBackground(theme->color("LogBackground_4"));
-            break;
-          case 5:
-            tf.setForeground(theme->color("LogForeground_5"));
-            tf.setBackground(theme->color("LogBackground_5"));
-            break;
-          case 6:
-            tf.setForeground(theme->color("LogForeground_6"));
-            tf.setBackground(theme->color("LogBackground_6"));
-            break;
-          default:
-            tf.setForeground(theme->color("LogForeground"));
-            tf.setBackground(theme->color("LogBackground"));
-
-          }
+      SonicPiTheme::Color fg, bg;
+      switch(msg_type)
+        {
+        case 1:
+          fg = SonicPiTheme::LogForeground_1;
+          bg = SonicPiTheme::LogBackground_1;
+          break;
+        case 2:
+          fg = SonicPiTheme::LogForeground_2;
+          bg = SonicPiTheme::LogBackground_2;
+          break;
+        case 3:
+          fg = SonicPiTheme::LogForeground_3;
+          bg = SonicPiTheme::LogBackground_3;
+          break;
+        case 4:
+          fg = SonicPiTheme::LogForeground_4;
+          bg = SonicPiTheme::LogBackground_4;
+          break;
+        case 5:
+          fg = SonicPiTheme::LogForeground_5;
+          bg = SonicPiTheme::LogBackground_5;
+          break;
+        case 6:
+          fg = SonicPiTheme::LogForeground_6;
+          bg = SonicPiTheme::LogBackground_6;
+          break;
+        default:
+          fg = SonicPiTheme::LogForeground;
+          bg = SonicPiTheme::LogBackground;
+        }
 
+      for (int j = 0; j < lines.size(); ++j) {
+        tf.setForeground(theme->color(fg));
+        tf.setBackground(theme->color(bg));
         setCurrentCharFormat(tf);
         insertPlainText(lines.at(j));
         if ((j + 1) < lines.size()) {
-          tf.setForeground(theme->color("LogForeground"));
+          tf.setForeground(theme->color(SonicPiTheme::LogForeground));
           setCurrentCharFormat(tf);
           if (i == (msg_count - 1)) {
             // we are the last message
@@ -164,8 +173,8 @@ void SonicPiLog::handleMultiMessage(SonicPiLog::MultiMessage mm)
         }
       }
 
-      tf.setForeground(theme->color("LogForeground"));
-      tf.setBackground(theme->color("LogBackground"));
+      tf.setForeground(theme->color(SonicPiTheme::LogForeground));
+      tf.setBackground(theme->color(SonicPiTheme::LogBackground));
       setCurrentCharFormat(tf);
     }
     appendPlainText(QString::fromStdString(" "));
@@ -15,6 +15,7 @@
 #define SONICPILOG_H
 
 #include <QPlainTextEdit>
+#include <chrono>
 
 class SonicPiTheme;
 
@@ -28,7 +29,7 @@ public:
     struct Message
     {
         int msg_type;
-        std::string s;
+        QString s;
     };
     typedef std::vector<Message> Messages;
 
@@ -36,9 +37,10 @@ public:
     {
         SonicPiTheme *theme;
         int job_id;
-        std::string thread_name;
-        std::string runtime;
+        QString thread_name;
+        QString runtime;
         Messages messages;
+        std::chrono::steady_clock::time_point received;
     };
 
 signals:
@@ -22,7 +22,10 @@
 #include <QDropEvent>
 #include <Qsci/qscicommandset.h>
 #include <Qsci/qscilexer.h>
+#include <Qsci/qscilexerruby.h>
 #include <QCheckBox>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QTimer>
 
 SonicPiScintilla::SonicPiScintilla(SonicPiLexer *lexer, SonicPiTheme *theme, QString fileName, OscSender *oscSender, bool autoIndent)
   : QsciScintilla()
@@ -117,23 +120,23 @@ SonicPiScintilla::SonicPiScintilla(SonicPiLexer *lexer, SonicPiTheme *theme, QSt
 
   standardCommands()->readSettings(settings);
 
-  this->setMatchedBraceBackgroundColor(theme->color("MatchedBraceBackground"));
-  this->setMatchedBraceForegroundColor(theme->color("MatchedBraceForeground"));
+  this->setMatchedBraceBackgroundColor(theme->color(SonicPiTheme::MatchedBraceBackground));
+  this->setMatchedBraceForegroundColor(theme->color(SonicPiTheme::MatchedBraceForeground));
 
   setIndentationWidth(ScaleHeightForDPI(2));
   setIndentationGuides(true);
-  setIndentationGuidesForegroundColor(theme->color("IndentationGuidesForeground"));
+  setIndentationGuidesForegroundColor(theme->color(SonicPiTheme::IndentationGuidesForeground));
   setBraceMatching( SonicPiScintilla::SloppyBraceMatch);
 
   //TODO: add preference toggle for this:
   //this->setFolding(SonicPiScintilla::CircledTreeFoldStyle, 2);
   setCaretLineVisible(true);
-  setCaretLineBackgroundColor(theme->color("CaretLineBackground"));
-  setFoldMarginColors(theme->color("FoldMarginForeground"),theme->color("FoldMarginForeground"));
+  setCaretLineBackgroundColor(theme->color(SonicPiTheme::CaretLineBackground));
+  setFoldMarginColors(theme->color(SonicPiTheme::FoldMarginForeground),theme->color(SonicPiTheme::FoldMarginForeground));
   setMarginLineNumbers(0, true);
 
-  setMarginsBackgroundColor(theme->color("MarginBackground"));
-  setMarginsForegroundColor(theme->color("MarginForeground"));
+  setMarginsBackgroundColor(theme->color(SonicPiTheme::MarginBackground));
+  setMarginsForegroundColor(theme->color(SonicPiTheme::MarginForeground));
   setMarginsFont(QFont("Hack", 15, -1, true));
   setUtf8(true);
   setText("# Loading previous buffer contents. Please wait...");
@@ -141,47 +144,98 @@ SonicPiScintilla::SonicPiScintilla(SonicPiLexer *lexer, SonicPiTheme *theme, QSt
 
   markerDefine(QImage(":/images/marker-error.png").scaled(QSize(ScaleHeightForDPI(30), ScaleHeightForDPI(21))), 8);
 
-  setMarkerBackgroundColor(theme->color("MarkerBackground"), 8);
+  setMarkerBackgroundColor(theme->color(SonicPiTheme::MarkerBackground), 8);
 
   setAutoCompletionThreshold(1);
   setAutoCompletionSource(SonicPiScintilla::AcsAPIs);
   setAutoCompletionCaseSensitivity(false);
 
-  setSelectionBackgroundColor(theme->color("SelectionBackground"));
-  setSelectionForegroundColor(theme->color("SelectionForeground"));
+  setSelectionBackgroundColor(theme->color(SonicPiTheme::SelectionBackground));
+  setSelectionForegroundColor(theme->color(SonicPiTheme::SelectionForeground));
   setCaretWidth(ScaleHeightForDPI(5));
-  setCaretForegroundColor(theme->color("CaretForeground"));
+  setCaretForegroundColor(theme->color(SonicPiTheme::CaretForeground));
   setEolMode(EolUnix);
 
   SendScintilla(SCI_SETWORDCHARS, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789:_?!");
 
-
+  // Run feedback is drawn as indicators over the text rather than by
+  // restyling, so flashing doesn't get slower as the buffer grows
+  runFlashBackIndicator = indicatorDefine(FullBoxIndicator);
+  runFlashForeIndicator = indicatorDefine(TextColorIndicator);
+  setIndicatorDrawUnder(true, runFlashBackIndicator);
+  setRunFlashColors();
+  runFlashTimer = new QTimer(this);
+  runFlashTimer->setSingleShot(true);
+  connect(runFlashTimer, SIGNAL(timeout()), this, SLOT(unflashRun()));
+
+  revision = 0;
+  beautifyRevision = 0;
+  beautifyWatcher = new QFutureWatcher<IndentChanges>(this);
+  connect(beautifyWatcher, SIGNAL(finished()), this, SLOT(applyBeautify()));
+  connect(this, SIGNAL(textChanged()), this, SLOT(bumpRevision()));
+
+  // Only style what's on screen synchronously - the rest of the buffer
+  // is styled in the background so opening and scrolling large
+  // generated files doesn't stall the UI
+  SendScintilla(SCI_SETIDLESTYLING, SC_IDLESTYLING_AFTERVISIBLE);
+  largeBufferMode = false;
+  SendScintilla(SCI_SETLAYOUTCACHE, SC_CACHE_PAGE);
+  connect(this, SIGNAL(textChanged()), this, SLOT(updateLargeBufferMode()));
 }
 
 void SonicPiScintilla::redraw(){
     SP_ZoneScopedN("Scintilla Redraw");
   mutex->lock();
-  setMarginsBackgroundColor(theme->color("MarginBackground"));
-  setMarginsForegroundColor(theme->color("MarginForeground"));
-  setSelectionBackgroundColor(theme->color("SelectionBackground"));
-  setSelectionForegroundColor(theme->color("SelectionForeground"));
-  setCaretLineBackgroundColor(theme->color("CaretLineBackground"));
-  setFoldMarginColors(theme->color("FoldMarginForeground"),theme->color("FoldMarginForeground"));
-  setIndentationGuidesForegroundColor(theme->color("IndentationGuidesForeground"));
-  setMatchedBraceBackgroundColor(theme->color("MatchedBraceBackground"));
-  setMatchedBraceForegroundColor(theme->color("MatchedBraceForeground"));
+  setMarginsBackgroundColor(theme->color(SonicPiTheme::MarginBackground));
+  setMarginsForegroundColor(theme->color(SonicPiTheme::MarginForeground));
+  setSelectionBackgroundColor(theme->color(SonicPiTheme::SelectionBackground));
+  setSelectionForegroundColor(theme->color(SonicPiTheme::SelectionForeground));
+  setCaretLineBackgroundColor(theme->color(SonicPiTheme::CaretLineBackground));
+  setFoldMarginColors(theme->color(SonicPiTheme::FoldMarginForeground),theme->color(SonicPiTheme::FoldMarginForeground));
+  setIndentationGuidesForegroundColor(theme->color(SonicPiTheme::IndentationGuidesForeground));
+  setMatchedBraceBackgroundColor(theme->color(SonicPiTheme::MatchedBraceBackground));
+  setMatchedBraceForegroundColor(theme->color(SonicPiTheme::MatchedBraceForeground));
+  setRunFlashColors();
+  mutex->unlock();
+}
+
+void SonicPiScintilla::setRunFlashColors(){
+  setIndicatorForegroundColor(theme->color(SonicPiTheme::SelectionBackground), runFlashBackIndicator);
+  setIndicatorOutlineColor(theme->color(SonicPiTheme::SelectionBackground), runFlashBackIndicator);
+  setIndicatorForegroundColor(theme->color(SonicPiTheme::SelectionForeground), runFlashForeIndicator);
+}
+
+void SonicPiScintilla::flashRun(){
+  mutex->lock();
+  long len = SendScintilla(SCI_GETLENGTH);
+  SendScintilla(SCI_SETINDICATORCURRENT, runFlashBackIndicator);
+  SendScintilla(SCI_INDICATORFILLRANGE, 0, len);
+  SendScintilla(SCI_SETINDICATORCURRENT, runFlashForeIndicator);
+  SendScintilla(SCI_INDICATORFILLRANGE, 0, len);
+  // hitting run again whilst flashing just extends the flash
+  runFlashTimer->start(500);
+  mutex->unlock();
+}
+
+void SonicPiScintilla::unflashRun(){
+  mutex->lock();
+  long len = SendScintilla(SCI_GETLENGTH);
+  SendScintilla(SCI_SETINDICATORCURRENT, runFlashBackIndicator);
+  SendScintilla(SCI_INDICATORCLEARRANGE, 0, len);
+  SendScintilla(SCI_SETINDICATORCURRENT, runFlashForeIndicator);
+  SendScintilla(SCI_INDICATORCLEARRANGE, 0, len);
   mutex->unlock();
 }
 
 void SonicPiScintilla::highlightCurrentLine(){
   mutex->lock();
-  setCaretLineBackgroundColor(theme->color("SelectionBackground"));
+  setCaretLineBackgroundColor(theme->color(SonicPiTheme::SelectionBackground));
   mutex->unlock();
 }
 
 void SonicPiScintilla::unhighlightCurrentLine(){
   mutex->lock();
-  setCaretLineBackgroundColor(theme->color("CaretLineBackground"));
+  setCaretLineBackgroundColor(theme->color(SonicPiTheme::CaretLineBackground));
   mutex->unlock();
 }
 
@@ -598,19 +652,223 @@ void SonicPiScintilla::completeListOrNewlineAndIndent(){
 
 void SonicPiScintilla::newlineAndIndent() {
   mutex->lock();
-  int point_line, point_index, first_line;
+  int point_line, point_index;
   getCursorPosition(&point_line, &point_index);
-  first_line = firstVisibleLine();
 
-  std::string code = text().toStdString();
+  beginUndoAction();
+  SendScintilla(QsciCommand::Newline);
+  // The line we left may now start with an end/else etc. that has just
+  // been completed, so fix that up too
+  reindentLine(point_line);
+  reindentLine(point_line + 1);
+  endUndoAction();
+  mutex->unlock();
+}
+
+// The lexer styles and folds lazily, make sure it has caught up with the
+// given line before its fold level is read.
+void SonicPiScintilla::styleToLine(int line) {
+  long end = SendScintilla(SCI_GETLINEENDPOSITION, (unsigned long) line);
+  long styled = SendScintilla(SCI_GETENDSTYLED);
+  if (styled <= end) {
+    SendScintilla(SCI_COLOURISE, styled, end + 1);
+  }
+}
+
+SonicPiScintilla::IndentLine SonicPiScintilla::indentLine(int line) {
+  IndentLine l;
+  l.text = text(line);
+  // number of blocks and brackets still open at the start of the line
+  l.depth = (SendScintilla(SCI_GETFOLDLEVEL, (unsigned long) line) & SC_FOLDLEVELNUMBERMASK) - SC_FOLDLEVELBASE;
+
+  // leave the contents of multi-line strings, heredocs and =begin/=end
+  // comments alone - check the newline which ends the previous line
+  l.inString = false;
+  if (line > 0) {
+    long pos = SendScintilla(SCI_POSITIONFROMLINE, (unsigned long) line);
+    switch (SendScintilla(SCI_GETSTYLEAT, (unsigned long) (pos - 1))) {
+    case QsciLexerRuby::POD:
+    case QsciLexerRuby::DoubleQuotedString:
+    case QsciLexerRuby::SingleQuotedString:
+    case QsciLexerRuby::HereDocument:
+    case QsciLexerRuby::PercentStringq:
+    case QsciLexerRuby::PercentStringQ:
+    case QsciLexerRuby::PercentStringx:
+    case QsciLexerRuby::PercentStringr:
+    case QsciLexerRuby::PercentStringw:
+    case QsciLexerRuby::Regex:
+    case QsciLexerRuby::Backticks:
+    case QsciLexerRuby::DataSection:
+      l.inString = true;
+      break;
+    default:
+      break;
+    }
+  }
+  return l;
+}
+
+// Returns the number of spaces the line should be indented by, or -1 if
+// it should be left alone.
+int SonicPiScintilla::targetIndent(const IndentLine &line) {
+  if (line.inString) return -1;
+
+  QString code = line.text.trimmed();
+  if (code.isEmpty()) return -1;
+
+  int depth = line.depth;
+
+  // lines which close a block (or open the next part of one) sit at the
+  // same level as the line which opened it
+  static const char *dedenters[] = {"end", "else", "elsif", "when", "rescue", "ensure", 0};
+  QChar first = code[0];
+  bool dedent = (first == ')' || first == ']' || first == '}');
+  for (int i = 0; !dedent && dedenters[i]; i++) {
+    QLatin1String word(dedenters[i]);
+    int len = word.size();
+    if (code.startsWith(word) &&
+        (code.length() == len || !(code[len].isLetterOrNumber() || code[len] == '_' || code[len] == ':' || code[len] == '?' || code[len] == '!'))) {
+      dedent = true;
+    }
+  }
+  if (dedent) depth--;
+  if (depth < 0) depth = 0;
+
+  return depth * 2;
+}
+
+SonicPiScintilla::IndentChanges SonicPiScintilla::computeIndentChanges(QVector<IndentLine> lines) {
+  IndentChanges changes;
+  for (int i = 0; i < lines.size(); i++) {
+    int target = targetIndent(lines[i]);
+    if (target < 0) continue;
+
+    const QString &t = lines[i].text;
+    int ws = 0;
+    while (ws < t.length() && (t[ws] == ' ' || t[ws] == '\t')) ws++;
+    bool same = (ws == target);
+    for (int j = 0; same && j < ws; j++) {
+      same = (t[j] == ' ');
+    }
+    if (!same) {
+      changes << qMakePair(i, target);
+    }
+  }
+  return changes;
+}
 
-  // TODO: fix this:
-  std::string id = "foobar";
+void SonicPiScintilla::reindentLine(int line) {
+  if (line < 0 || line >= lines()) return;
+  styleToLine(line);
 
-  oscSender->bufferNewlineAndIndent(point_line, point_index, first_line, code, fileName.toStdString(), id);
+  IndentLine l = indentLine(line);
+  int target = targetIndent(l);
+  int ws = 0;
+  while (ws < l.text.length() && (l.text[ws] == ' ' || l.text[ws] == '\t')) ws++;
+
+  int point_line, point_index;
+  getCursorPosition(&point_line, &point_index);
+
+  if (target < 0) {
+    // blank line: still put the cursor where the next line of code goes
+    if (!l.inString && point_line == line && l.text.trimmed().isEmpty()) {
+      target = l.depth * 2;
+    } else {
+      return;
+    }
+  }
+
+  if (ws != target || l.text.left(ws) != QString(ws, ' ')) {
+    long start = SendScintilla(SCI_POSITIONFROMLINE, (unsigned long) line);
+    QByteArray spaces(target, ' ');
+    SendScintilla(SCI_SETTARGETSTART, start);
+    SendScintilla(SCI_SETTARGETEND, start + ws);
+    SendScintilla(SCI_REPLACETARGET, spaces.size(), spaces.constData());
+  }
+
+  if (point_line == line) {
+    // keep the cursor on the same code, but never inside the indentation
+    int index = point_index + (target - ws);
+    setCursorPosition(line, index < target ? target : index);
+  }
+}
+
+void SonicPiScintilla::beautify() {
+  mutex->lock();
+  // Reading the fold levels needs the lexer so stays on the GUI thread,
+  // working out what to change doesn't.
+  int n = lines();
+  styleToLine(n - 1);
+  QVector<IndentLine> snapshot;
+  snapshot.reserve(n);
+  for (int i = 0; i < n; i++) {
+    snapshot << indentLine(i);
+  }
+  beautifyRevision = revision;
+  beautifyWatcher->setFuture(QtConcurrent::run(&SonicPiScintilla::computeIndentChanges, snapshot));
   mutex->unlock();
 }
 
+void SonicPiScintilla::applyBeautify() {
+  mutex->lock();
+  // the buffer was edited whilst we were working - try again
+  if (beautifyRevision != revision) {
+    mutex->unlock();
+    beautify();
+    return;
+  }
+
+  IndentChanges changes = beautifyWatcher->result();
+  if (!changes.isEmpty()) {
+    int point_line, point_index;
+    getCursorPosition(&point_line, &point_index);
+    int first_line = firstVisibleLine();
+
+    beginUndoAction();
+    foreach (const auto &change, changes) {
+      int line = change.first;
+      QString t = text(line);
+      int ws = 0;
+      while (ws < t.length() && (t[ws] == ' ' || t[ws] == '\t')) ws++;
+      long start = SendScintilla(SCI_POSITIONFROMLINE, (unsigned long) line);
+      QByteArray spaces(change.second, ' ');
+      SendScintilla(SCI_SETTARGETSTART, start);
+      SendScintilla(SCI_SETTARGETEND, start + ws);
+      SendScintilla(SCI_REPLACETARGET, spaces.size(), spaces.constData());
+      if (line == point_line) {
+        point_index = qMax(change.second, point_index + (change.second - ws));
+      }
+    }
+    endUndoAction();
+
+    setCursorPosition(point_line, point_index);
+    setFirstVisibleLine(first_line);
+  }
+  mutex->unlock();
+}
+
+void SonicPiScintilla::bumpRevision() {
+  revision++;
+}
+
+// Large buffers keep the layout of every line they've laid out rather
+// than just the visible page, trading memory for not re-laying out
+// lines each time they scroll back into view.
+void SonicPiScintilla::updateLargeBufferMode() {
+  bool large = SendScintilla(SCI_GETLINECOUNT) >= LARGE_BUFFER_LINES;
+  if (large == largeBufferMode) {
+    return;
+  }
+  largeBufferMode = large;
+  if (large) {
+    SendScintilla(SCI_SETLAYOUTCACHE, SC_CACHE_DOCUMENT);
+    SendScintilla(SCI_SETPOSITIONCACHE, LARGE_BUFFER_POSITION_CACHE);
+  } else {
+    SendScintilla(SCI_SETLAYOUTCACHE, SC_CACHE_PAGE);
+    SendScintilla(SCI_SETPOSITIONCACHE, DEFAULT_POSITION_CACHE);
+  }
+}
+
 void SonicPiScintilla::dragEnterEvent(QDragEnterEvent *event) {
   mutex->lock();
   if (event->mimeData()->hasFormat("text/uri-list")) {
@@ -16,9 +16,13 @@
 #include "osc/oscsender.h"
 #include "widgets/sonicpilog.h"
 #include <QCheckBox>
+#include <QFutureWatcher>
+#include <QPair>
+#include <QVector>
 
 class SonicPiLexer;
 class QSettings;
+class QTimer;
 
 class SonicPiScintilla : public QsciScintilla
 {
@@ -64,12 +68,15 @@ class SonicPiScintilla : public QsciScintilla
     void downcaseWordOrSelection();
     void highlightCurrentLine();
     void unhighlightCurrentLine();
+    void flashRun();
+    void unflashRun();
     void zoomFontIn();
     void zoomFontOut();
     void newLine();
     void replaceBuffer(QString content, int line, int index, int first_line);
     void newlineAndIndent();
     void completeListOrNewlineAndIndent();
+    void beautify();
 
     void sp_paste();
     void sp_cut();
@@ -85,4 +92,36 @@ class SonicPiScintilla : public QsciScintilla
     bool autoIndent;
     QMutex *mutex;
 
+    // Native Ruby indentation driven by LexRuby's fold levels
+    struct IndentLine {
+      QString text;
+      int depth;
+      bool inString;
+    };
+    typedef QVector<QPair<int, int> > IndentChanges;
+    static int targetIndent(const IndentLine &line);
+    static IndentChanges computeIndentChanges(QVector<IndentLine> lines);
+    void styleToLine(int line);
+    IndentLine indentLine(int line);
+    void reindentLine(int line);
+    QFutureWatcher<IndentChanges> *beautifyWatcher;
+
+    int runFlashBackIndicator;
+    int runFlashForeIndicator;
+    QTimer *runFlashTimer;
+    void setRunFlashColors();
+
+    unsigned int revision;
+    unsigned int beautifyRevision;
+
+    static const int LARGE_BUFFER_LINES = 2000;
+    static const int LARGE_BUFFER_POSITION_CACHE = 4096;
+    static const int DEFAULT_POSITION_CACHE = 1024;
+    bool largeBufferMode;
+
+  private slots:
+    void bumpRevision();
+    void updateLargeBufferMode();
+    void applyBeautify();
+
 };
@@ -12,8 +12,10 @@ echo "Warning: Unix build scripts are still a work in progress!"
 echo "Copying external dependencies to the server..."
 mkdir -p "${SCRIPT_DIR}/server/erlang/sonic_pi_server/priv/"
 cp ${SCRIPT_DIR}/external/build/sp_midi-prefix/src/sp_midi-build/*.so ${SCRIPT_DIR}/server/erlang/sonic_pi_server/priv/
+cp ${SCRIPT_DIR}/external/build/sp_osc-prefix/src/sp_osc-build/*.so ${SCRIPT_DIR}/server/erlang/sonic_pi_server/priv/
 
 cp "${SCRIPT_DIR}/external/build/aubio-prefix/src/aubio-build/aubio_onset" "${SCRIPT_DIR}/server/native/"
+cp "${SCRIPT_DIR}/external/build/aubio-prefix/src/aubio-build/aubio_tempo" "${SCRIPT_DIR}/server/native/"
 
 #dont remove ruby-aubio-prerelease, as needed in linux build
 #it is removed in the windows-prebuild
@@ -19,12 +19,13 @@ fi
 "${SCRIPT_DIR}/external/mac_build_externals.sh"
 # mkdir -p "${SCRIPT_DIR}/server/native/lib"
  cp "${SCRIPT_DIR}/external/build/aubio-prefix/src/aubio-build/aubio_onset" "${SCRIPT_DIR}/server/native/"
+cp "${SCRIPT_DIR}/external/build/aubio-prefix/src/aubio-build/aubio_tempo" "${SCRIPT_DIR}/server/native/"
 
 
 # Install dependencies to server
 echo "Copying external dependencies to the server..."
 mkdir -p "${SCRIPT_DIR}/server/erlang/sonic_pi_server/priv/"
-for f in ${SCRIPT_DIR}/external/build/sp_midi-prefix/src/sp_midi-build/*.dylib; do
+for f in ${SCRIPT_DIR}/external/build/sp_midi-prefix/src/sp_midi-build/*.dylib ${SCRIPT_DIR}/external/build/sp_osc-prefix/src/sp_osc-build/*.dylib; do
     cp $f ${SCRIPT_DIR}/server/erlang/sonic_pi_server/priv/$(basename $f .dylib).so
 done
 
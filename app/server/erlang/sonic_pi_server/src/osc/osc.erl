@@ -13,7 +13,11 @@
 
 -module(osc).
 
--export([now/0, encode/1, decode/1, pack_ts/2, osc_time_to_local/1]).
+-export([now/0, encode/1, decode/1, pack_ts/2, osc_time_to_local/1,
+         readdress/3, retime/2]).
+
+%% the pure Erlang codec, used by sp_osc when its NIF isn't loaded
+-export([erl_decode/1, erl_readdress/3, erl_retime/2]).
 
 %% Note: not all tags are implemented yet
 %%       not super well tested - appears to work :-)
@@ -75,7 +79,7 @@ encode_binary(Bin) ->
     SizeOfBin = size(Bin),
     OSCBlob = <<SizeOfBin:32,Bin/binary>>,
     Pad = (4 - (size(OSCBlob) rem 4)) rem 4,
-    <<OSCBlob/binary, 0:((4-Pad)*8)>>.
+    <<OSCBlob/binary, 0:(Pad*8)>>.
 
 
 encode_flags(L) when is_list(L) ->
@@ -85,6 +89,7 @@ encode_flags(L) when is_list(L) ->
     encode_string([$,|L1]).
 
 encode_flag({int64,_})            -> $h;
+encode_flag({double,_})           -> $d;
 encode_flag({time,_})             -> $t;
 encode_flag(I) when is_integer(I) -> $i;
 encode_flag(X) when is_list(X)    -> $s;
@@ -97,6 +102,7 @@ encode_arg(X) when is_atom(X)    -> encode_string(atom_to_list(X));
 encode_arg(X) when is_integer(X) -> <<X:32>>;
 encode_arg(X) when is_float(X)   -> <<X:32/float>>; %
 encode_arg({int64,X})            -> <<X:64/unsigned-little-integer>>;
+encode_arg({double,X})           -> <<X:64/float>>;
 encode_arg(X) when is_binary(X)  -> encode_binary(X).
 
 %% bundles
@@ -114,11 +120,41 @@ pack_ts(Time, Data) ->
     %% io:format("decoded:~p ~p~n",[T1,E1]),
     B.
 
+%% readdress(Bin, Address, Prefix) gives message Bin the new Address and
+%% puts the arguments in Prefix in front of its own. retime(Bin, Time)
+%% gives bundle Bin a new time tag. Neither decodes the existing arguments
+%% or bundle elements, they are copied across as they are.
+
+readdress(Bin, Address, Prefix) when is_binary(Bin) ->
+    sp_osc:readdress(Bin, Address, Prefix).
+
+retime(Bin, Time) when is_binary(Bin) ->
+    sp_osc:retime(Bin, Time).
+
+erl_readdress(B0, Address, Prefix) ->
+    {Verb, B1} = get_string(B0),
+    "#bundle" =/= Verb orelse erlang:error(badarg),
+    {[$,|Flags], Data} = get_string(B1),
+    list_to_binary([encode_string(Address),
+                    encode_string([$,|[encode_flag(I) || I <- Prefix] ++ Flags]),
+                    [encode_arg(I) || I <- Prefix],
+                    Data]).
+
+erl_retime(<<"#bundle",0,_:8/binary,Rest/binary>>, Time) ->
+    BTime = encode_time(Time),
+    <<"#bundle",0,BTime/binary,Rest/binary>>.
+
 %%----------------------------------------------------------------------
 %% Decoding
 %%----------------------------------------------------------------------
 
+%% Decoded by the sp_osc NIF in one pass where it's available. Blobs and
+%% bundle elements may then be sub-binaries of B0.
+
 decode(B0) when is_binary(B0) ->
+    sp_osc:decode(B0).
+
+erl_decode(B0) when is_binary(B0) ->
     {Verb,  B1}      = get_string(B0),
     %% io:format("Verb: ~p~n",[Verb]),
     case Verb of
@@ -73,3 +73,22 @@ test3() ->
 
     gen_udp:close(Socket),
     Result.
+
+%% checks the sp_osc NIF agrees with the Erlang codec
+test4() ->
+    Msgs = [osc:encode(["/foo", "bar", 1, -2, 3.5, <<1,2,3>>, {int64, 42}, baz]),
+            osc:encode(["/empty"]),
+            osc:pack_ts(osc:now() + 10, ["/forward", "localhost", 6000, "/x", 1]),
+            <<"/x",0,0,",d",0,0,64,9,33,251,84,68,45,24>>],
+    Decoded = [osc:decode(B) =:= osc:erl_decode(B) || B <- Msgs],
+    In = osc:encode(["/trigger", 1, "on"]),
+    Cue = ["/external-osc-cue", "127.0.0.1", 4560, "/trigger", 1, "on"],
+    Readdressed = [osc:decode(osc:readdress(In, "/external-osc-cue",
+                                            ["127.0.0.1", 4560]))
+                   =:= {cmd, Cue},
+                   osc:readdress(In, "/a", [1, "b", {double, 1.5}])
+                   =:= osc:erl_readdress(In, "/a", [1, "b", {double, 1.5}])],
+    Bundle = osc:pack_ts(osc:now(), ["/x", 1]),
+    Retimed = [osc:retime(Bundle, 1000.5) =:= osc:erl_retime(Bundle, 1000.5)],
+    io:format("NIF loaded: ~p~n", [sp_osc:is_loaded()]),
+    lists:all(fun(X) -> X end, Decoded ++ Readdressed ++ Retimed).
@@ -120,6 +120,11 @@ loop(State) ->
                     MIDIServer = maps:get(midi_server, State),
                     MIDIServer ! {flush},
                     ?MODULE:loop(State);
+                {cmd, ["/midi-metrics"]=Cmd} ->
+                    debug_cmd(Cmd),
+                    MIDIServer = maps:get(midi_server, State),
+                    MIDIServer ! {metrics},
+                    ?MODULE:loop(State);
                 {cmd, ["/flush", Tag]=Cmd} ->
                     debug_cmd(Cmd),
                     {Tracker, NewState} = tracker_pid(Tag, State),
@@ -133,6 +138,10 @@ loop(State) ->
                     debug_cmd(Cmd),
                     send_to_cue({enabled, Flag =:= 1}, State),
                     ?MODULE:loop(State);
+                {cmd, ["/raw-cue-forwarding", Flag]=Cmd} ->
+                    debug_cmd(Cmd),
+                    send_to_cue({raw_cues, Flag =:= 1}, State),
+                    ?MODULE:loop(State);
                 {cmd, ["/stop-start-midi-cues", Flag]=Cmd} ->
                     debug_cmd(Cmd),
                     send_to_cue({midi_enabled, Flag =:= 1}, State),
@@ -47,6 +47,7 @@ init(Parent) ->
     Internal = application:get_env(?APPLICATION, internal, true),
     Enabled = application:get_env(?APPLICATION, enabled, true),
     MIDIEnabled = application:get_env(?APPLICATION, midi_enabled, true),
+    RawCues = application:get_env(?APPLICATION, raw_cues, false),
     io:format("~n"
               "+--------------------------------------+~n"
               "    This is the Sonic Pi OSC Server     ~n"
@@ -73,6 +74,7 @@ init(Parent) ->
     State = #{parent => Parent,
               enabled => Enabled,
               midi_enabled => MIDIEnabled,
+              raw_cues => RawCues,
               cue_host => CueHost,
               cue_port => CuePort,
               internal => Internal,
@@ -104,6 +106,33 @@ loop(State) ->
             update_midi_out_ports(CueHost, CuePort, InSocket, Outs),
             ?MODULE:loop(State);
 
+        {midi_metrics, Metrics} ->
+            CueHost = maps:get(cue_host, State),
+            CuePort = maps:get(cue_port, State),
+            InSocket = maps:get(in_socket, State),
+            forward_midi_metrics(CueHost, CuePort, InSocket, Metrics),
+            ?MODULE:loop(State);
+
+        {udp, InSocket, Ip, Port, Bin} when map_get(raw_cues, State) ->
+            Time = osc:now(),
+            debug(3, "cue server got UDP on ~p:~p~n", [Ip, Port]),
+            case State of
+                #{enabled := true,
+                  cue_host := CueHost,
+                  cue_port := CuePort} ->
+                    case valid_address(Bin) of
+                        true ->
+                            forward_raw_cue(CueHost, CuePort, InSocket,
+                                            Ip, Port, Time, Bin);
+                        false ->
+                            log("Ignoring invalid OSC cue: ~p~n", [Bin])
+                    end,
+                    ?MODULE:loop(State);
+                #{enabled := false} ->
+                    debug("OSC forwarding disabled - ignored: ~p~n", [Bin]),
+                    ?MODULE:loop(State)
+            end;
+
         {udp, InSocket, Ip, Port, Bin} ->
             debug(3, "cue server got UDP on ~p:~p~n", [Ip, Port]),
             try osc:decode(Bin) of
@@ -115,7 +144,7 @@ loop(State) ->
                           cue_port := CuePort} ->
                             debug("got incoming OSC: ~p~n", [Cmd]),
                             forward_cue(CueHost, CuePort,
-                                        InSocket, Ip, Port, Cmd),
+                                        InSocket, Ip, Port, Bin),
                             ?MODULE:loop(State);
                         #{enabled := false} ->
                             debug("OSC forwarding disabled - ignored: ~p~n", [Cmd]),
@@ -165,6 +194,14 @@ loop(State) ->
             log("Disabling cue forwarding ~n"),
             ?MODULE:loop(State#{enabled := false});
 
+        {raw_cues, true} ->
+            log("Forwarding OSC cues without decoding~n"),
+            ?MODULE:loop(State#{raw_cues := true});
+
+        {raw_cues, false} ->
+            log("Decoding OSC cues before forwarding~n"),
+            ?MODULE:loop(State#{raw_cues := false});
+
         {midi_enabled, true} ->
             log("Enabling midi cue forwarding ~n"),
             ?MODULE:loop(State#{midi_enabled := true});
@@ -229,6 +266,11 @@ update_midi_out_ports(CueHost, CuePort, InSocket, Args) ->
     debug("forwarded new MIDI outs to ~p:~p~n", [CueHost, CuePort]),
     ok.
 
+forward_midi_metrics(CueHost, CuePort, InSocket, Metrics) ->
+    Bin = osc:encode(["/midi-metrics", "erlang" | Metrics]),
+    send_udp(InSocket, CueHost, CuePort, Bin),
+    ok.
+
 forward_midi_cue(CueHost, CuePort, InSocket, Path, Args) ->
     Bin = osc:encode(["/midi-cue", "erlang", Path | Args]),
     send_udp(InSocket, CueHost, CuePort, Bin),
@@ -236,12 +278,31 @@ forward_midi_cue(CueHost, CuePort, InSocket, Path, Args) ->
     ok.
 
 
-forward_cue(CueHost, CuePort, InSocket, Ip, Port, Cmd) ->
-    Bin = osc:encode(["/external-osc-cue", inet:ntoa(Ip), Port] ++ Cmd),
-    send_udp(InSocket, CueHost, CuePort, Bin),
+%% The incoming message has already been validated by osc:decode, so
+%% rather than encoding it again from scratch we just swap in our address
+%% and the sender's details, keeping the original arguments byte for byte
+forward_cue(CueHost, CuePort, InSocket, Ip, Port, Bin) ->
+    Cue = osc:readdress(Bin, "/external-osc-cue", [inet:ntoa(Ip), Port]),
+    send_udp(InSocket, CueHost, CuePort, Cue),
     debug("forwarded OSC cue to ~p:~p~n", [CueHost, CuePort]),
     ok.
 
+%% In raw mode the cue is passed on exactly as it arrived, along with the
+%% sender and the time we received it, and only the runtime decodes it
+forward_raw_cue(CueHost, CuePort, InSocket, Ip, Port, Time, Bin) ->
+    Cue = osc:encode(["/external-osc-cue-raw", inet:ntoa(Ip), Port,
+                      {double, Time}, Bin]),
+    send_udp(InSocket, CueHost, CuePort, Cue),
+    debug("forwarded raw OSC cue to ~p:~p~n", [CueHost, CuePort]),
+    ok.
+
+%% Just enough checking to route the cue - a terminated OSC address.
+%% Bundles aren't forwarded in either mode.
+valid_address(<<$/, _/binary>> = Bin) ->
+    binary:match(Bin, <<0>>) =/= nomatch;
+valid_address(_) ->
+    false.
+
 
 %% sys module callbacks
 
@@ -96,6 +96,10 @@ loop(State) ->
             sp_midi:midi_flush(),
             debug("Flushing MIDI", []),
             ?MODULE:loop(State);
+        {metrics} ->
+            Metrics = lists:append([[Name, Value] || {Name, Value} <- sp_midi:midi_metrics()]),
+            maps:get(cue_server, State) ! {midi_metrics, Metrics},
+            ?MODULE:loop(State);
         {midi_in, PortName, <<Bin/binary>>} ->
             case pi_server_midi_in:info(PortName, Bin) of
                 {tau, error, _Reason, _Source, _Args}=Event ->
@@ -1,6 +1,7 @@
 -module(sp_midi).
 -export([midi_init/0, midi_deinit/0, midi_send/2, midi_flush/0, midi_ins/0, midi_outs/0, have_my_pid/0,
-        set_this_pid/1, set_log_level/1, schedule_callback/3, get_current_time_microseconds/0]).
+        set_this_pid/1, set_log_level/1, schedule_callback/3, get_current_time_microseconds/0,
+        midi_metrics/0]).
 -on_load(init/0).
 
 -define(APPLICATION, sonic_pi_server).
@@ -42,3 +43,5 @@ set_this_pid(_) ->
     exit(nif_library_not_loaded).
 schedule_callback(_, _, _) ->
     exit(nif_library_not_loaded).
+midi_metrics() ->
+    exit(nif_library_not_loaded).
@@ -0,0 +1,55 @@
+%% OSC codec NIF
+%% --
+%% This file is part of Sonic Pi: http://sonic-pi.net
+%% Full project source: https://github.com/samaaron/sonic-pi
+%% License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+%%
+%% Copyright 2021 by Sam Aaron (http://sam.aaron.name).
+%% All rights reserved.
+%%
+%% Permission is granted for use, copying, modification, and
+%% distribution of modified versions of this work as long as this
+%% notice is included.
+%% ++
+
+-module(sp_osc).
+-export([decode/1, readdress/3, retime/2, is_loaded/0]).
+-on_load(init/0).
+
+-define(APPLICATION, sonic_pi_server).
+-define(LIBNAME, "libsp_osc").
+
+%% Unlike sp_midi, the server works fine without this library: every
+%% function below falls back to the pure Erlang codec in osc.erl, so a
+%% failed load is reported and otherwise ignored.
+
+init() ->
+    SoName = case code:priv_dir(?APPLICATION) of
+        {error, bad_name} ->
+            case filelib:is_dir(filename:join(["..", priv])) of
+                true ->
+                    filename:join(["..", priv, ?LIBNAME]);
+                _ ->
+                    filename:join([priv, ?LIBNAME])
+            end;
+        Dir ->
+            filename:join(Dir, ?LIBNAME)
+    end,
+    case erlang:load_nif(SoName, 0) of
+        ok ->
+            ok;
+        {error, {Reason, Text}} ->
+            io:format("OSC NIF not loaded, using Erlang codec: ~p ~s~n",
+                      [Reason, Text]),
+            ok
+    end.
+
+is_loaded() ->
+    false.
+
+decode(Bin) ->
+    osc:erl_decode(Bin).
+readdress(Bin, Address, Prefix) ->
+    osc:erl_readdress(Bin, Address, Prefix).
+retime(Bin, Time) ->
+    osc:erl_retime(Bin, Time).
@@ -40,12 +40,16 @@ FileUtils.mkdir_p native_dir
 
 # Rugged is used for storing the user's ruby music scripts in Git
 # FFI is used for MIDI lib support
+# sp_osc is the native OSC encoder/decoder
+# sp_event_history is the native EventHistory store
 native_ext_dirs = [
   File.expand_path(File.dirname(__FILE__) + '/../vendor/rugged-0.28.4.1/ext/rugged'),
   File.expand_path(File.dirname(__FILE__) + '/../vendor/ffi-1.11.3/ext/ffi_c/'),
   File.expand_path(File.dirname(__FILE__) + '/../vendor/atomic/ext'),
   File.expand_path(File.dirname(__FILE__) + '/../vendor/ruby-prof-0.15.8/ext/ruby_prof/'),
-  File.expand_path(File.dirname(__FILE__) + '/../vendor/interception/ext/')
+  File.expand_path(File.dirname(__FILE__) + '/../vendor/interception/ext/'),
+  File.expand_path(File.dirname(__FILE__) + '/../vendor/sp_osc/ext/'),
+  File.expand_path(File.dirname(__FILE__) + '/../vendor/sp_event_history/ext/')
 ]
 
 
@@ -41,6 +41,8 @@ FileUtils::mkdir "#{qt_gui_path}/book/"
 
 docs = []
 filenames = []
+search_docs = []
+tab_keywords = {}
 count = 0
 
 options = {}
@@ -62,8 +64,9 @@ make_tab = lambda do |name, doc_items, titleize=false, should_sort=true, with_ke
   docs << "\n"
   docs << "  // #{name} info\n"
 
-  docs << "  struct help_page #{help_pages}[] = {\n"
+  docs << "  static const struct help_page #{help_pages}[] = {\n"
   doc_items = doc_items.sort if should_sort
+  tab_keywords[name] = doc_items.map { |n, _| n.downcase } if with_keyword
 
   book = ""
   toc = "<ul class=\"toc\">\n"
@@ -96,11 +99,7 @@ make_tab = lambda do |name, doc_items, titleize=false, should_sort=true, with_ke
     toc << "<li><a href=\"\##{item_var}\">#{title.gsub(/"/, '&quot;')}</a></li>\n"
 
     docs << "    { "
-
-    docs << "QString::fromUtf8(" unless title.ascii_only?
     docs << "\"#{title.gsub(/"/, '\\"')}\""
-    docs << ")" unless title.ascii_only?
-
     docs << ", "
 
     if with_keyword then
@@ -114,6 +113,7 @@ make_tab = lambda do |name, doc_items, titleize=false, should_sort=true, with_ke
     docs << "},\n"
 
     filenames << filename
+    search_docs << ["qrc:///#{filename}", title.strip, doc.dup]
 
     File.open("#{qt_gui_path}/#{filename}", 'w') do |f|
       f << "#{doc}"
@@ -236,6 +236,20 @@ make_tab.call("fx", SonicPi::Synths::SynthInfo.fx_doc_html_map, :titleize, true,
 make_tab.call("samples", SonicPi::Synths::SynthInfo.samples_doc_html_map, false, true, false, true)
 make_tab.call("lang", SonicPi::Lang::Core.docs_html_map.merge(SonicPi::Lang::Sound.docs_html_map).merge(ruby_html_map), false, true, true, false)
 
+# Autocompletion symbols are loaded straight from static tables rather
+# than being picked out of the help pages as they're added
+{"synths" => ["Synth", ":"], "fx" => ["FX", ":"], "lang" => ["Func", ""]}.each do |name, (context, prefix)|
+  keywords = tab_keywords[name]
+  next if keywords.nil? || keywords.empty?
+  docs << "  // #{name} autocompletion\n"
+  docs << "  static const char * const #{name}Autocomplete[] = {\n"
+  keywords.each do |k|
+    docs << "    \"#{prefix}#{k.gsub(/"/, '\\"')}\",\n"
+  end
+  docs << "  };\n"
+  docs << "  autocomplete->addKeywords(SonicPiAPIs::#{context}, #{name}Autocomplete, #{keywords.length});\n\n"
+end
+
 docs << "  // FX arguments for autocompletion\n"
 docs << "  QStringList fxtmp;\n"
 SonicPi::Synths::SynthInfo.get_all.each do |k, v|
@@ -285,9 +299,76 @@ File.open(cpp, 'w') do |f|
   f << new_content.join
 end
 
+
+###
+# Generate the help search index
+###
+
+# An inverted index over the text of every help page so that the GUI
+# can search them as you type without parsing any HTML at runtime. The
+# layout is documented in utils/helpsearchindex.h - all integers are
+# little endian and every term's postings are in page order.
+search_index_filename = "help/search.idx"
+search_title_weight = 10
+search_terms = Hash.new { |h, k| h[k] = Hash.new(0) }
+
+raise "Too many help pages to index" if search_docs.length > 0xFFFF
+
+search_docs.each_with_index do |(url, title, html), doc_id|
+  text = CGI.unescapeHTML(html.gsub(/<[^>]*>/, ' '))
+  text.downcase.scan(/[[:alnum:]_]+/) do |term|
+    search_terms[term][doc_id] += 1 if term.length > 1
+  end
+  title.downcase.scan(/[[:alnum:]_]+/) do |term|
+    search_terms[term][doc_id] += search_title_weight if term.length > 1
+  end
+end
+
+search_strings = "".b
+add_search_string = lambda do |s|
+  offset = search_strings.bytesize
+  search_strings << s.b << "\0"
+  offset
+end
+
+search_doc_table = search_docs.map do |url, title, _|
+  [add_search_string.call(url), add_search_string.call(title)].pack("V2")
+end.join
+
+search_term_table = "".b
+search_postings = "".b
+num_postings = 0
+search_terms.keys.sort_by(&:b).each do |term|
+  postings = search_terms[term]
+  search_term_table << [add_search_string.call(term), num_postings, postings.size].pack("V3")
+  postings.each do |doc_id, weight|
+    search_postings << [doc_id, [weight, 0xFFFF].min].pack("v2")
+  end
+  num_postings += postings.size
+end
+
+search_header_size = 32
+search_docs_offset = search_header_size
+search_terms_offset = search_docs_offset + search_doc_table.bytesize
+search_postings_offset = search_terms_offset + search_term_table.bytesize
+search_strings_offset = search_postings_offset + search_postings.bytesize
+
+File.open("#{qt_gui_path}/#{search_index_filename}", 'wb') do |f|
+  f << "SPHI"
+  f << [1, search_docs.length, search_terms.size,
+        search_docs_offset, search_terms_offset,
+        search_postings_offset, search_strings_offset].pack("V7")
+  f << search_doc_table
+  f << search_term_table
+  f << search_postings
+  f << search_strings
+end
+
 File.open("#{qt_gui_path}/help_files.qrc", 'w') do |f|
   f << "<RCC>\n  <qresource prefix=\"/\">\n"
   f << filenames.map{|n| "    <file>#{n}</file>\n"}.join
+  # left uncompressed so it can be mapped straight out of the binary
+  f << "    <file compress=\"0\">#{search_index_filename}</file>\n"
   f << "  </qresource>\n</RCC>\n"
 end
 
@@ -374,14 +374,14 @@ end
 register_api = lambda do |server|
   server.add_method("/run-code") do |args|
     gui_id = args[0]
-    code = args[1].force_encoding("utf-8")
+    code = args[1].dup.force_encoding("utf-8")
     sp.__spider_eval code
   end
 
   server.add_method("/save-and-run-buffer") do |args|
     gui_id = args[0]
     buffer_id = args[1]
-    code = args[2].force_encoding("utf-8")
+    code = args[2].dup.force_encoding("utf-8")
     workspace = args[3]
     sp.__save_buffer(buffer_id, code)
     sp.__spider_eval code, {workspace: workspace}
@@ -390,7 +390,7 @@ register_api = lambda do |server|
   server.add_method("/save-buffer") do |args|
     gui_id = args[0]
     buffer_id = args[1]
-    code = args[2].force_encoding("utf-8")
+    code = args[2].dup.force_encoding("utf-8")
     sp.__save_buffer(buffer_id, code)
   end
 
@@ -412,7 +412,7 @@ register_api = lambda do |server|
   server.add_method("/buffer-newline-and-indent") do |args|
     gui_id = args[0]
     id = args[1]
-    buf = args[2].force_encoding("utf-8")
+    buf = args[2].dup.force_encoding("utf-8")
     point_line = args[3]
     point_index = args[4]
     first_line = args[5]
@@ -422,7 +422,7 @@ register_api = lambda do |server|
   server.add_method("/buffer-section-complete-snippet-or-indent-selection") do |args|
     gui_id = args[0]
     id = args[1]
-    buf = args[2].force_encoding("utf-8")
+    buf = args[2].dup.force_encoding("utf-8")
     start_line = args[3]
     finish_line = args[4]
     point_line = args[5]
@@ -433,7 +433,7 @@ register_api = lambda do |server|
   server.add_method("/buffer-indent-selection") do |args|
     gui_id = args[0]
     id = args[1]
-    buf = args[2].force_encoding("utf-8")
+    buf = args[2].dup.force_encoding("utf-8")
     start_line = args[3]
     finish_line = args[4]
     point_line = args[5]
@@ -444,7 +444,7 @@ register_api = lambda do |server|
   server.add_method("/buffer-section-toggle-comment") do |args|
     gui_id = args[0]
     id = args[1]
-    buf = args[2].force_encoding("utf-8")
+    buf = args[2].dup.force_encoding("utf-8")
     start_line = args[3]
     finish_line = args[4]
     point_line = args[5]
@@ -455,7 +455,7 @@ register_api = lambda do |server|
   server.add_method("/buffer-beautify") do |args|
     gui_id = args[0]
     id = args[1]
-    buf = args[2].force_encoding("utf-8")
+    buf = args[2].dup.force_encoding("utf-8")
     line = args[3]
     index = args[4]
     first_line = args[5]
@@ -490,6 +490,21 @@ register_api = lambda do |server|
     sp.recording_save(filename)
   end
 
+  server.add_method("/start-recording-tap") do |args|
+    gui_id = args[0]
+    tap = sp.recording_tap_start
+    if tap
+      gui.send("/recording-tap", tap[:scope_num], tap[:sample_rate], tap[:frames])
+    else
+      gui.send("/recording-tap", -1, 0, 0)
+    end
+  end
+
+  server.add_method("/stop-recording-tap") do |args|
+    gui_id = args[0]
+    sp.recording_tap_stop
+  end
+
   server.add_method("/reload") do |args|
     gui_id = args[0]
     dir = File.dirname("#{File.absolute_path(__FILE__)}")
@@ -589,6 +604,16 @@ register_api = lambda do |server|
     sp.__update_midi_outs(outs)
   end
 
+  server.add_method("/metrics-subscribe") do |args|
+    gui_id = args[0]
+    sp.__metrics_subscribe(args[1] == 1)
+  end
+
+  # Sent by the Erlang MIDI server in reply to /midi-metrics
+  server.add_method("/midi-metrics") do |args|
+    sp.__update_midi_metrics(args[1..-1])
+  end
+
   server.add_method("/midi-start") do |args|
     gui_id = args[0]
     silent = args[1] == 1
@@ -642,6 +667,18 @@ register_api = lambda do |server|
     osc_args = args[3..-1]
     sp.__register_external_osc_cue_event(Time.now, ip, port, address, osc_args)
   end
+
+  # Sent by the Erlang cue server in raw forwarding mode - the incoming
+  # message arrives untouched as a blob, along with its sender and the
+  # time the cue server received it, so it's only ever decoded here.
+  raw_cue_decoder = SonicPi::OSC.new_decoder
+  server.add_method("/external-osc-cue-raw") do |args|
+    ip = args[0]
+    port = args[1]
+    time = Time.at(args[2])
+    address, osc_args = raw_cue_decoder.decode_single_message(args[3])
+    sp.__register_external_osc_cue_event(time, ip, port, address, osc_args)
+  end
 end
 
 register_api.call(osc_server)
@@ -672,6 +709,8 @@ out_t = Thread.new do
           gui.send("/midi/out-ports", message[:val])
         when :midi_in_ports
           gui.send("/midi/in-ports", message[:val])
+        when :metrics
+          gui.send("/metrics", message[:source], *message[:val])
         when :info
           gui.send("/log/info", message[:style] || 0, message[:val] || "")
         when :syntax_error
@@ -758,4 +797,12 @@ puts "-----------------------------------\n\n"
 
 STDOUT.flush
 
+# Tell the GUI we're ready straight away rather than leaving it to
+# discover this via its next /ping
+begin
+  gui.send("/booted")
+rescue Errno::EPIPE => e
+  STDOUT.puts "GUI not listening."
+end
+
 out_t.join
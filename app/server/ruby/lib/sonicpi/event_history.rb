@@ -13,6 +13,13 @@
 
 require_relative "cueevent"
 
+begin
+  # Built by bin/compile-extensions.rb from vendor/sp_event_history
+  require 'sp_event_history'
+rescue LoadError
+  # Fall back to the EventHistoryNode tree below
+end
+
 module SonicPi
 
   module EventMatcherUtil
@@ -34,13 +41,12 @@ module SonicPi
       @events = []
     end
 
-    def count_nodes(node_total=0, event_total=0)
-
-      node_total += 1
-      event_total += @events.size
+    def count_nodes
+      node_total = 1
+      event_total = @events.size
 
-      @children.map do |k, n|
-        nt, et = n.count_nodes(node_total, event_total)
+      @children.each_value do |n|
+        nt, et = n.count_nodes
         node_total += nt
         event_total += et
       end
@@ -52,10 +58,26 @@ module SonicPi
   class EventMatcher
     include EventMatcherUtil
 
-    attr_reader :handle, :prom, :ce
+    # Building the Regexp for a pattern costs far more than matching
+    # against it and the same handful of patterns get synced on over and
+    # over, so compiled patterns are shared between matchers.
+    COMPILED_CACHE_SIZE = 1024
+    @compiled = {}
+    @compiled_mut = Mutex.new
+
+    attr_reader :handle, :prom, :ce, :prefix
+
+    def self.compile(path)
+      @compiled_mut.synchronize do
+        compiled = @compiled[path]
+        return compiled if compiled
+        @compiled.clear if @compiled.size >= COMPILED_CACHE_SIZE
+        @compiled[path] = [compile_regexp(path), literal_prefix(path)].freeze
+      end
+    end
 
-    def initialize(ce, val_matcher=nil, handle=nil, prom=nil)
-      path = String.new(ce.path)
+    def self.compile_regexp(path)
+      path = String.new(path)
 
       # get rid of white space
       path.strip!
@@ -93,8 +115,28 @@ module SonicPi
       # convert to a regexp
       matcher_str = "\\A/?#{path}/?\\Z"
 
-      @matcher = Regexp.new(matcher_str)
+      Regexp.new(matcher_str)
+    end
+
+    # The leading path segments which contain no wildcards. Any path the
+    # pattern matches must start with exactly these segments, which is
+    # what lets EventMatchers file matchers in a trie.
+    def self.literal_prefix(path)
+      path = path.strip
+      path = path[1..-1] if path.start_with?('/')
+      # a further leading / is made optional by the regexp
+      return [].freeze if path.start_with?('/')
+
+      prefix = []
+      path.split('/').each do |segment|
+        break if segment =~ /[*?\[{,]/
+        prefix << segment.freeze
+      end
+      prefix.freeze
+    end
 
+    def initialize(ce, val_matcher=nil, handle=nil, prom=nil)
+      @matcher, @prefix = EventMatcher.compile(ce.path)
       @val_matcher = val_matcher
       @alive = true
       @prom = prom
@@ -121,21 +163,64 @@ module SonicPi
   end
 
 
+  # Waiting matchers are filed in a trie under the literal segments at
+  # the start of their pattern, so an incoming event is only tested
+  # against the matchers along its own path rather than every waiter.
   class EventMatchers
-    attr_reader :matchers
+    class Node
+      attr_reader :children, :matchers
+
+      def initialize
+        @children = {}
+        @matchers = []
+      end
+
+      def empty?
+        @matchers.empty? && @children.empty?
+      end
+    end
 
     def initialize
-      @matchers = []
+      @root = Node.new
+    end
+
+    def matchers
+      res = []
+      each_node(@root) { |n| res.concat(n.matchers) }
+      res
     end
 
     def put(ce, val_matcher, thread_id, prom)
       matcher = EventMatcher.new(ce, val_matcher, thread_id, prom)
-      @matchers << matcher
+      node = @root
+      matcher.prefix.each do |segment|
+        node = (node.children[segment] ||= Node.new)
+      end
+      node.matchers << matcher
       return matcher
     end
 
     def match(ce)
-      @matchers.delete_if do |matcher|
+      path = ce.path
+      path = path[1..-1] if path.start_with?('/')
+      node = @root
+      match_node(node, ce)
+      path.split('/').each do |segment|
+        node = node.children[segment]
+        return unless node
+        match_node(node, ce)
+      end
+    end
+
+    def prune(handle_to_remove)
+      prune_node(@root, handle_to_remove)
+    end
+
+    private
+
+    def match_node(node, ce)
+      return if node.matchers.empty?
+      node.matchers.delete_if do |matcher|
         if matcher.path_match(ce.path, ce.val) && ce > matcher.ce
           matcher.prom.deliver! true if matcher.prom
           matched = true
@@ -146,8 +231,17 @@ module SonicPi
       end
     end
 
-    def prune(handle_to_remove)
-      @matchers.delete_if { |m| m.dead? || m.handle == handle_to_remove }
+    def prune_node(node, handle_to_remove)
+      node.matchers.delete_if { |m| m.dead? || m.handle == handle_to_remove }
+      node.children.delete_if do |_, child|
+        prune_node(child, handle_to_remove)
+        child.empty?
+      end
+    end
+
+    def each_node(node, &blk)
+      blk.call(node)
+      node.children.each_value { |child| each_node(child, &blk) }
     end
   end
 
@@ -159,11 +253,16 @@ module SonicPi
 
     attr_accessor :event_matchers
 
-    def initialize(all_threads=nil, thread_mut=nil)
+    def self.native_store?
+      SonicPi.const_defined?(:NativeEventStore, false)
+    end
+
+    def initialize(all_threads=nil, thread_mut=nil, native=EventHistory.native_store?)
       @trim_history = true
       @min_history_size = 20
       @history_depth = 32
-      @state = EventHistoryNode.new
+      @native = native
+      @state = @native ? NativeEventStore.new(@min_history_size, @history_depth, @trim_history) : EventHistoryNode.new
       @event_matchers = EventMatchers.new
       @process_mut = Mutex.new
       @matcher_mut = Mutex.new
@@ -172,8 +271,15 @@ module SonicPi
       @get_mut = Mutex.new
     end
 
+    # [nodes, events] currently held
+    def counts
+      @process_mut.synchronize do
+        @native ? @state.count : @state.count_nodes
+      end
+    end
+
     def size_info
-      s = @state.count_nodes
+      s = counts
       "nodes: #{s[0]}, events: #{s[1]}"
     end
 
@@ -197,7 +303,11 @@ module SonicPi
     def set(t, p, i, d, b, m, path, val)
       ce = CueEvent.new(t, p, i, d, b, m, path, val)
       @process_mut.synchronize do
-        __insert_event!(ce)
+        if @native
+          @state.insert(ce)
+        else
+          __insert_event!(ce)
+        end
       end
       @matcher_mut.synchronize do
         @event_matchers.match(ce)
@@ -252,6 +362,14 @@ module SonicPi
     @@split_path_cache = Hash.new
     private
     def get_w_mutex(ge, val_matcher, get_next=false)
+      if @native
+        # the native store normalises and caches the path itself
+        path = ge.path.start_with?('/') ? ge.path : "/#{ge.path}"
+        @process_mut.synchronize do
+          return @state.get(ge, path, val_matcher, get_next)
+        end
+      end
+
       # get value or return default
       if ge.path.start_with? '/'
         if ge.path.include?('/**/**')
@@ -577,22 +695,14 @@ module SonicPi
       # lambda representing an arg matching fn. This will then be used
       # asqo a constraint over the val when finding a given event.
 
-      # Find the first event that's less than the time t, d.
+      # Find the first event that's less than the time t, d. The events
+      # before it are all later, so walk back from there towards the
+      # start of the list for the earliest one that also matches val.
 
-      idx = events.find_index { |e| e <= ge }
-      if idx && idx > 0
-        return events[idx - 1] unless val_matcher
-        while idx > 0
-          idx -= 1
-          return events[idx] if safe_matcher_call(val_matcher, events[idx].val)
-        end
-      end
-
-      last = events.last
-      if val_matcher
-        return last if last && (last > ge) && safe_matcher_call(val_matcher, last.val)
-      else
-        return last if last && (last > ge)
+      idx = events.find_index { |e| e <= ge } || events.size
+      while idx > 0
+        idx -= 1
+        return events[idx] if !val_matcher || safe_matcher_call(val_matcher, events[idx].val)
       end
       return nil
     end
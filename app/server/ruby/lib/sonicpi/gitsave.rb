@@ -16,6 +16,10 @@ begin
 
   module SonicPi
     class GitSave
+      # Number of autosave commits between incremental repacks of the
+      # loose objects they create
+      PACK_INTERVAL = 100
+      PACKED_REF = "refs/sonic-pi/packed"
 
       def initialize(path)
         path = path.encode('utf-8')
@@ -31,12 +35,19 @@ begin
             @repo = Rugged::Repository.init_at path, false
           end
         end
+
+        # Start with a full pack if this repo has never been packed so
+        # that any existing backlog of loose objects is cleared
+        @commits_since_pack = @repo.references.exist?(PACKED_REF) ? 0 : PACK_INTERVAL
       end
 
       def save!(filename, content, msgpre="")
         oid = @repo.write(content, :blob)
         index = @repo.index
         index.reload
+        entry = index[filename]
+        # Nothing to commit if the content is unchanged since the last save
+        return if entry && entry[:oid] == oid && !@repo.empty?
         index.add(:path => filename, :oid => oid, :mode => 0100644)
 
         options = {}
@@ -48,9 +59,29 @@ begin
         options[:parents] = @repo.empty? ? [] : [ @repo.head.target ].compact
         options[:update_ref] = 'HEAD'
 
-        Rugged::Commit.create(@repo, options)
+        res = Rugged::Commit.create(@repo, options)
+        @commits_since_pack += 1
+        res
+      end
+
+      def pack_needed?
+        # pack_loose_objects is only available in the vendored rugged
+        @commits_since_pack >= PACK_INTERVAL && @repo.respond_to?(:pack_loose_objects)
       end
 
+      # Move the loose objects created by autosaves into a packfile. Only
+      # objects added since the last pack are included, so each pack is
+      # small and existing packs are never rewritten.
+      def pack!
+        return 0 if @repo.empty?
+        since = @repo.references[PACKED_REF]
+        since = since.target_id if since
+        head = @repo.head.target_id
+        removed = @repo.pack_loose_objects(since)
+        @repo.references.create(PACKED_REF, head, force: true)
+        @commits_since_pack = 0
+        removed
+      end
 
     end
   end
@@ -64,6 +95,14 @@ rescue LoadError
 
       def save!(*args)
       end
+
+      def pack_needed?
+        false
+      end
+
+      def pack!
+        0
+      end
     end
   end
 end
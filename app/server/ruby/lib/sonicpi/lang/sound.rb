@@ -541,6 +541,7 @@ end"]
       def use_sample_bpm(sample_name, *args)
         args_h = resolve_synth_opts_hash_or_array(args)
         num_beats = args_h[:num_beats] || 1
+        num_beats = sample_detected_num_beats(sample_name) || 1 if num_beats == :auto
 
         # Don't use sample_duration as that is stretched to the current
         # bpm!
@@ -555,7 +556,7 @@ end"]
           summary:        "Sample-duration-based bpm modification",
           doc:            "Modify bpm so that sleeping for 1 will sleep for the duration of the sample.",
           args:           [[:string_or_number, :sample_name_or_duration]],
-          opts:           {:num_beats => "The number of beats within the sample. By default this is 1."},
+          opts:           {:num_beats => "The number of beats within the sample. By default this is 1. Use `:auto` to count the beats using the tempo detected by `sample_tempo`."},
           accepts_block:  false,
           examples:       ["use_sample_bpm :loop_amen  #Set bpm based on :loop_amen duration
 
@@ -584,6 +585,7 @@ end"]
         raise "with_sample_bpm must be called with a do/end block" unless block
         args_h = resolve_synth_opts_hash_or_array(args)
         num_beats = args_h[:num_beats] || 1
+        num_beats = sample_detected_num_beats(sample_name) || 1 if num_beats == :auto
         # Don't use sample_duration as that is stretched to the current
         # bpm!
         sd = sample_buffer(sample_name).duration
@@ -594,7 +596,7 @@ end"]
           summary:        "Block-scoped sample-duration-based bpm modification",
           doc:            "Block-scoped modification of bpm so that sleeping for 1 will sleep for the duration of the sample.",
           args:           [[:string_or_number, :sample_name_or_duration]],
-          opts:           {:num_beats => "The number of beats within the sample. By default this is 1."},
+          opts:           {:num_beats => "The number of beats within the sample. By default this is 1. Use `:auto` to count the beats using the tempo detected by `sample_tempo`."},
           accepts_block:  true,
           requires_block: true,
           examples:       ["
@@ -1001,6 +1003,48 @@ play 50 # Plays with supersaw synth
 
 
 
+      def recording_tap_start
+        if @mod_sound_studio.recording?
+          __info "Already recording..."
+          nil
+        else
+          __info "Start recording"
+          @mod_sound_studio.recording_tap_start
+        end
+      end
+      doc name:          :recording_tap_start,
+          introduced:    Version.new(3,4,0),
+          summary:       "Start streaming audio to the GUI's recorder",
+          doc:           "Copies all sound into shared memory for the GUI to encode to a FLAC or Opus file as it plays. Returns the scope buffer, sample rate and block size for the GUI to read with, or nil if already recording.",
+          args:          [],
+          opts:          nil,
+          accepts_block: false,
+          examples:      [],
+          hide:          true
+
+
+
+
+      def recording_tap_stop
+        if @mod_sound_studio.recording_tap_stop
+          __info "Stop recording"
+        else
+          __info "Recording already stopped"
+        end
+      end
+      doc name:          :recording_tap_stop,
+          introduced:    Version.new(3,4,0),
+          summary:       "Stop streaming audio to the GUI's recorder",
+          doc:           "Stops the copy started by `recording_tap_start`.",
+          args:          [],
+          opts:          nil,
+          accepts_block: false,
+          examples:      [],
+          hide:          true
+
+
+
+
       def reset_mixer!()
         @mod_sound_studio.mixer_reset
       end
@@ -2394,6 +2438,30 @@ sample :loop_amen                    # starting it again
 
       ]
 
+      def sample_tempo(*args)
+        sample_buffer(*args).tempo_data
+      end
+      doc name:          :sample_tempo,
+          introduced:    Version.new(3,4,0),
+          summary:       "Detect the tempo and beat grid of a sample",
+          doc:           "Analyses the sample with a beat tracking algorithm and returns a map containing the detected `bpm:`, a `confidence:` value for that estimate, the times in seconds of each detected beat as a ring in `beats:` and the index into `beats:` of the most likely downbeat (assuming 4 beats per bar) in `downbeat:`. The analysis is performed once per sample and then cached. If no tempo could be detected the `bpm:` will be 0.
+
+The detected tempo is used by `beat_stretch: :auto` on `sample` and `num_beats: :auto` on `use_sample_bpm`.",
+          args:          [[:path, :string]],
+          returns:       :SPMap,
+          opts:          nil,
+          accepts_block: false,
+          examples:      ["
+puts sample_tempo(:loop_amen)   # => (map bpm: 136.0, confidence: 0.23, downbeat: 0, beats: (ring 0.0, 0.44, ...))",
+"
+live_loop :amen do
+  sample :loop_amen, beat_stretch: :auto   # play the loop in time with the current BPM
+  sleep sample_duration(:loop_amen, beat_stretch: :auto)
+end"]
+
+
+
+
       def sample_split_filts_and_opts(args)
         idx = args.find_index {|el| el.is_a?(Hash)}
         if idx
@@ -2529,7 +2597,7 @@ By combining commands which add to the candidates and then filtering those candi
 
           args:          [[:name_or_path, :symbol_or_string]],
           opts:          {:rate          => "Rate with which to play back the sample. Higher rates mean an increase in pitch and a decrease in duration. Default is 1.",
-                          :beat_stretch  => "Stretch (or shrink) the sample to last for exactly the specified number of beats. Please note - this does *not* keep the pitch constant and is essentially the same as modifying the rate directly.",
+                          :beat_stretch  => "Stretch (or shrink) the sample to last for exactly the specified number of beats. Please note - this does *not* keep the pitch constant and is essentially the same as modifying the rate directly. Use `:auto` to stretch the sample so that its detected tempo (see `sample_tempo`) matches the current BPM.",
                           :pitch_stretch => "Stretch (or shrink) the sample to last for exactly the specified number of beats. This attempts to keep the pitch constant using the `pitch:` opt. Note, it's very likely you'll need to experiment with the `window_size:`, `pitch_dis:` and `time_dis:` opts depending on the sample and the amount you'd like to stretch/shrink from original size.",
                           :attack        => "Time to reach full volume. Default is 0.",
                           :sustain       => "Time to stay at full volume. Default is to stretch to length of sample (minus attack and release times).",
@@ -3633,6 +3701,13 @@ Also, if you wish your synth to work with Sonic Pi's automatic stereo sound infr
         end
       end
 
+      def sample_detected_num_beats(path)
+        buf = sample_buffer(path)
+        bpm = buf.tempo_data[:bpm]
+        return nil unless bpm > 0
+        [1, (buf.duration * bpm / 60.0).round].max
+      end
+
       def normalise_and_resolve_sample_args(path, args_h, info, combine_tls=false)
         purge_nil_vals!(args_h)
         defaults = info ? info.arg_defaults : {}
@@ -3642,8 +3717,13 @@ Also, if you wish your synth to work with Sonic Pi's automatic stereo sound infr
         end
 
         stretch_duration = args_h[:beat_stretch]
+        if stretch_duration == :auto
+          stretch_duration = sample_detected_num_beats(path)
+          raise "beat_stretch: :auto was unable to detect a tempo for sample with path #{path}" unless stretch_duration
+          args_h[:beat_stretch] = stretch_duration
+        end
         if stretch_duration
-          raise "beat_stretch: opt needs to be a positive number. Got: #{stretch_duration.inspect}" unless stretch_duration.is_a?(Numeric) && stretch_duration > 0
+          raise "beat_stretch: opt needs to be a positive number or :auto. Got: #{stretch_duration.inspect}" unless stretch_duration.is_a?(Numeric) && stretch_duration > 0
           stretch_duration = stretch_duration.to_f
           rate = args_h[:rate] || 1
           dur = sample_buffer(path).duration
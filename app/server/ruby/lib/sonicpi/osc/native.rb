@@ -0,0 +1,35 @@
+#--
+# This file is part of Sonic Pi: http://sonic-pi.net
+# Full project source: https://github.com/samaaron/sonic-pi
+# License: https://github.com/samaaron/sonic-pi/blob/main/LICENSE.md
+#
+# Copyright 2013, 2014, 2015, 2016 by Sam Aaron (http://sam.aaron.name).
+# All rights reserved.
+#
+# Permission is granted for use, copying, modification, and
+# distribution of modified versions of this work as long as this
+# notice is included.
+#++
+
+begin
+  # Built by bin/compile-extensions.rb from vendor/sp_osc
+  require 'sp_osc'
+rescue LoadError
+  # Fall back to the pure Ruby OscEncode and OscDecode
+end
+
+module SonicPi
+  module OSC
+    def self.native_codec?
+      const_defined?(:NativeOscEncode, false)
+    end
+
+    def self.new_encoder
+      native_codec? ? NativeOscEncode.new : OscEncode.new(true)
+    end
+
+    def self.new_decoder
+      native_codec? ? NativeOscDecode.new : OscDecode.new(true)
+    end
+  end
+end
@@ -11,6 +11,8 @@
 # notice is included.
 #++
 
+require_relative 'native'
+
 module SonicPi
   module OSC
     class OscDecode
@@ -43,14 +45,15 @@ module SonicPi
         ## cost of method dispatch. Apologies if this makes it harder to
         ## read & understand. See http://opensoundcontrol.org for spec.
 
-        m.force_encoding(@binary_encoding)
+        # Blobs from other messages are already binary and frozen
+        m.force_encoding(@binary_encoding) unless m.encoding == Encoding::BINARY
 
         args, idx = [], 0
 
         # Get OSC address e.g. /foo
         orig_idx = idx
         idx = m.index(@string_terminator, orig_idx)
-        address, idx =  m[orig_idx...idx], idx + 1 + ((4 - ((idx + 1) % 4)) % 4)
+        address, idx =  m[orig_idx...idx].freeze, idx + 1 + ((4 - ((idx + 1) % 4)) % 4)
 
         sep, idx = m[idx], idx + 1
 
@@ -95,7 +98,7 @@ module SonicPi
               # string
               orig_idx = idx
               idx = m.index(@string_terminator, orig_idx)
-              arg, idx =  m[orig_idx...idx], idx + 1 + ((4 - ((idx + 1) % 4)) % 4)
+              arg, idx =  m[orig_idx...idx].freeze, idx + 1 + ((4 - ((idx + 1) % 4)) % 4)
             when @d_tag
               # double64
               arg, idx = m[idx, 8].unpack(@cap_g)[0], idx + 8
@@ -106,7 +109,7 @@ module SonicPi
               # binary blob
               l = m[idx, 4].unpack(@cap_n)[0]
               idx += 4
-              arg = m[idx, l]
+              arg = m[idx, l].freeze
               idx += l
               #Skip Padding
               idx += ((4 - (idx % 4)) % 4)
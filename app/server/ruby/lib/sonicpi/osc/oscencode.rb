@@ -11,6 +11,8 @@
 # notice is included.
 #++
 
+require_relative 'native'
+
 module SonicPi
   module OSC
     class OscEncode
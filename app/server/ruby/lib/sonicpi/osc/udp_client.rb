@@ -23,7 +23,7 @@ module SonicPi
       def initialize(host, port, opts={})
         @host = host
         @port = port
-        @encoder = OscEncode.new(true)
+        @encoder = OSC.new_encoder
         @so = UDPSocket.new
         @so.connect(host, port)
       end
@@ -32,8 +32,8 @@ module SonicPi
         end
         @matchers = {}
         @global_matcher = global_method
-        @decoder = OscDecode.new(true)
-        @encoder = OscEncode.new(true)
+        @decoder = OSC.new_decoder
+        @encoder = OSC.new_encoder
         @listener_thread = Thread.new {start_listener}
       end
 
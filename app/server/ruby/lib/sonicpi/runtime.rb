@@ -104,7 +104,7 @@ module SonicPi
       d = 0
       b = 0
       m = 60
-      @register_cue_event_lambda.call(Time.now, p, @system_init_thread_id, d, b, m, address, args, 0)
+      @register_cue_event_lambda.call(time, p, @system_init_thread_id, d, b, m, address, args, 0)
     end
 
     def __gui_heartbeat(id)
@@ -444,6 +444,45 @@ module SonicPi
       desc = outs.join("\n")
       __msg_queue.push({:type => :midi_out_ports, :val => desc})
     end
+
+    # The GUI subscribes while its diagnostics pane is open. Nothing is
+    # collected or sent the rest of the time.
+    def __metrics_subscribe(enabled)
+      @metrics_mut.synchronize do
+        if enabled && !@metrics_t
+          @metrics_t = Thread.new do
+            __system_thread_locals.set_local(:sonic_pi_local_thread_group, :metrics_loop)
+            Kernel.loop do
+              __publish_metrics
+              Kernel.sleep 1
+            end
+          end
+        elsif !enabled && @metrics_t
+          @metrics_t.kill
+          @metrics_t = nil
+        end
+      end
+    end
+
+    # Flat list of name, value pairs, in the same shape as the GUI's and
+    # sp_midi's metrics
+    def __metrics_snapshot
+      nodes, events = @event_history.counts
+      ["event_history.events", events,
+       "event_history.nodes", nodes,
+       "msg_queue.size", __msg_queue.size,
+       "threads", Thread.list.size]
+    end
+
+    def __publish_metrics
+      __msg_queue.push({:type => :metrics, :source => "ruby", :val => __metrics_snapshot})
+      # sp_midi's metrics come back from the Erlang server as /midi-metrics
+      @osc_client.send("/midi-metrics")
+    end
+
+    def __update_midi_metrics(metrics)
+      __msg_queue.push({:type => :metrics, :source => "midi", :val => metrics})
+    end
     def __osc_flush!
       @osc_client.send("/flush", "default")
     end
@@ -726,7 +765,24 @@ module SonicPi
     end
 
     def __save_buffer(id, content)
-      @save_queue << [id, content]
+      # Never block the caller - only the latest content for each buffer
+      # is kept until the save thread gets round to writing it
+      @save_mut.synchronize do
+        @save_pending[id] = content
+        @save_cv.signal
+      end
+    end
+
+    def __flush_saves(timeout=nil)
+      deadline = timeout && (Time.now + timeout)
+      @save_mut.synchronize do
+        while @save_in_progress || !@save_pending.empty?
+          remaining = deadline && (deadline - Time.now)
+          return false if remaining && remaining <= 0
+          @save_done_cv.wait(@save_mut, remaining)
+        end
+      end
+      true
     end
 
     def __disable_update_checker
@@ -897,6 +953,10 @@ module SonicPi
       log "Runtime - shutting down..."
       log "Runtime - stopping all jobs..."
       __stop_jobs
+      # Any /save-buffer messages sent before /exit have already been
+      # queued, so once these are written the GUI's buffers are safe.
+      log "Runtime - flushing buffer saves..."
+      log "Runtime - timed out waiting for buffer saves" unless __flush_saves(5)
       __msg_queue.push({:type => :exit, :jobid => __current_job_id, :jobinfo => __current_job_info})
       log "Runtime - shutdown completed."
     end
@@ -1390,28 +1450,57 @@ module SonicPi
 
       @gui_heartbeats = {}
       @gui_last_heartbeat = nil
+      @metrics_mut = Mutex.new
+      @metrics_t = nil
       begin
         @gitsave = GitSave.new(project_path)
       rescue
         @gitsave = nil
       end
-      @save_queue = SizedQueue.new(20)
+      @save_mut = Mutex.new
+      @save_cv = ConditionVariable.new
+      @save_pending = {}
+      @save_in_progress = false
+      @save_done_cv = ConditionVariable.new
 
       @save_t = Thread.new do
         __system_thread_locals.set_local(:sonic_pi_local_thread_group, :save_loop)
         Kernel.loop do
-          event = @save_queue.pop
-          id, content = *event
-          filename = id + '.spi'
-          path = project_path + "/" + filename
-          content = filter_for_save(content)
-          begin
-            File.open(path, 'w') {|f| f.write(content) }
-            @gitsave.save!(filename, content, "#{@version} -- #{@session_id} -- ")
-          rescue Exception => e
-            log "Exception saving buffer #{filename}:\n#{e.inspect}"
-            ##TODO: remove this and ensure that git saving actually works
-            ##instead of cowardly hiding the issue!
+          pending = @save_mut.synchronize do
+            @save_cv.wait(@save_mut) while @save_pending.empty?
+            @save_in_progress = true
+            res = @save_pending
+            @save_pending = {}
+            res
+          end
+
+          pending.each do |id, content|
+            filename = id + '.spi'
+            path = project_path + "/" + filename
+            content = filter_for_save(content)
+            begin
+              File.open(path, 'w') {|f| f.write(content) }
+              @gitsave.save!(filename, content, "#{@version} -- #{@session_id} -- ")
+            rescue Exception => e
+              log "Exception saving buffer #{filename}:\n#{e.inspect}"
+              ##TODO: remove this and ensure that git saving actually works
+              ##instead of cowardly hiding the issue!
+            end
+          end
+
+          @save_mut.synchronize do
+            @save_in_progress = false
+            @save_done_cv.broadcast
+          end
+
+          # Only repack once there are no more saves waiting
+          if @gitsave && @gitsave.pack_needed? && @save_mut.synchronize { @save_pending.empty? }
+            begin
+              removed = @gitsave.pack!
+              log "Packed #{removed} loose objects in #{project_path}"
+            rescue Exception => e
+              log "Exception packing project repo:\n#{e.inspect}"
+            end
           end
         end
       end
@@ -116,6 +116,36 @@ module SonicPi
       return @aubio_onset_data
     end
 
+    def tempo_data
+      return @aubio_tempo_data if @aubio_tempo_data
+      @aubio_sem.synchronize do
+        return @aubio_tempo_data if @aubio_tempo_data
+        __no_kill_block do
+
+          # The aubio_tempo binary decodes the sample once and prints a
+          # summary line of "bpm confidence downbeat_index" followed by
+          # the time of each detected beat in seconds.
+
+          begin
+            aubio_tempo_command = "\"#{aubio_tempo_path}\" \"#{@path}\""
+            lines = `#{aubio_tempo_command}`.lines
+            bpm, confidence, downbeat = lines.shift.to_s.split
+            beats = lines.map(&:to_f)
+          rescue Exception => e
+            log_exception e
+            bpm, confidence, downbeat, beats = nil, nil, nil, []
+          end
+
+          @aubio_tempo_data = SonicPi::Core::SPMap.new(
+            bpm: bpm.to_f,
+            confidence: confidence.to_f,
+            downbeat: downbeat.to_i,
+            beats: beats.ring)
+        end
+      end
+      return @aubio_tempo_data
+    end
+
     def onsets(stretch=1)
       return @aubio_onsets[stretch] if @aubio_onsets[stretch]
       data = onset_data
@@ -43,6 +43,8 @@ module SonicPi
       @rebooting = false
       @cent_tuning = 0
       @sample_format = "int16"
+      @recording_tap_scope_num = 1 # scope_num 0 is the GUI's scope
+      @recording_tap_frames = 4096
       @paused = false
       @register_cue_event_lambda = register_cue_event_lambda
       @erlang_pid = nil
@@ -68,7 +70,7 @@ module SonicPi
       return @erlang_pid if @erlang_pid
       # Start Erlang (initially with cue forwarding disabled)
       begin
-        erlang_cmd = __exec_path("#{erlang_boot_path} +C multi_time_warp -noshell -pz \"#{erlang_server_path}\" -sonic_pi_server api_port #{@erlang_port} in_port #{@osc_cues_port} cue_port #{@server_port} enabled false -s pi_server start")
+        erlang_cmd = __exec_path("#{erlang_boot_path} +C multi_time_warp -noshell -pz \"#{erlang_server_path}\" -sonic_pi_server api_port #{@erlang_port} in_port #{@osc_cues_port} cue_port #{@server_port} enabled false raw_cues true -s pi_server start")
         STDOUT.puts erlang_cmd
         @erlang_pid = spawn erlang_cmd, out: erlang_log_path, err: erlang_log_path
         register_process(@erlang_pid)
@@ -155,6 +157,7 @@ module SonicPi
 
 
       @recorders = {}
+      @recording_tap = nil
       @recording_mutex = Mutex.new
 
       rand_buf.wait_for_allocation
@@ -372,7 +375,7 @@ module SonicPi
     end
 
     def recording?
-      ! @recorders.empty?
+      ! @recorders.empty? || !! @recording_tap
     end
 
     def bit_depth=(depth)
@@ -431,6 +434,38 @@ module SonicPi
       end
     end
 
+    # The GUI's FLAC/Opus recorder reads the output from a scope buffer
+    # in shared memory rather than having scsynth write a WAV. This
+    # starts a second scope synth to feed it, on its own scope buffer
+    # and with blocks big enough that the reader can't miss one.
+    # Returns what the reader needs, or nil if a tap is already running.
+    def recording_tap_start(bus=0)
+      check_for_server_rebooting!(:recording_tap_start)
+      return nil if @recording_tap
+      @recording_mutex.synchronize do
+        return nil if @recording_tap
+        @recording_tap = @server.trigger_synth :head, @monitor_group, "sonic-pi-scope", {"bus" => bus.to_i, "scope_num" => @recording_tap_scope_num, "max_frames" => @recording_tap_frames}, nil, true
+        {:scope_num => @recording_tap_scope_num,
+         :sample_rate => @server.scsynth_info[:sample_rate].to_i,
+         :frames => @recording_tap_frames}
+      end
+    end
+
+    def recording_tap_stop
+      check_for_server_rebooting!(:recording_tap_stop)
+      return false unless @recording_tap
+      @recording_mutex.synchronize do
+        return false unless @recording_tap
+        @recording_tap.kill(true)
+        @recording_tap = nil
+
+        # ensure nodes are all paused if we are in a paused state
+        @server.node_pause(0, true) if @paused
+
+        true
+      end
+    end
+
     def shutdown
       @server_reboot.kill
       begin
@@ -413,6 +413,15 @@ module SonicPi
       end
     end
 
+    def aubio_tempo_path
+      case os
+      when :windows
+        File.absolute_path("#{native_path}/aubio_tempo.exe")
+      else
+        File.absolute_path("#{native_path}/aubio_tempo")
+      end
+    end
+
     def sox_path
       File.join(native_path, "sox", __exe_fix("sox"))
     end
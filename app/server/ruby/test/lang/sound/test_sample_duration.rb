@@ -32,6 +32,7 @@ module SonicPi
       @mock_samp.stubs(:duration).returns(8)
       @mock_samp.stubs(:onset_slices).returns([{:start => 0, :finish => 0.125}, {:start => 0.125, :finish => 1}])
       @mock_samp.stubs(:slices).returns([{:start => 0, :finish => 0.5}, {:start => 0.5, :finish => 1}])
+      @mock_samp.stubs(:tempo_data).returns({:bpm => 90.0, :confidence => 0.5, :downbeat => 0, :beats => []})
 
       @lang.mod_sound_studio.stubs(:load_sample).returns(@mock_samp)
     end
@@ -50,6 +51,7 @@ module SonicPi
         assert_equal 8,  sample_duration(:foo, rate: 1, sustain: -1, release: 12)
         assert_equal 4,  sample_duration(:foo, rate: 1, rpitch: 12)
         assert_equal 3,  sample_duration(:foo, rate: 1, beat_stretch: 3)
+        assert_equal 12, sample_duration(:foo, rate: 1, beat_stretch: :auto)
         assert_equal 1,  sample_duration(:foo, rate: 1, pitch_stretch: 1)
         assert_equal 4,  sample_duration(:foo, rate: 1, start: 0.5), 4
         assert_equal 2,  sample_duration(:foo, rate: 1, start: 0.5, finish: 0.75)
@@ -413,6 +413,35 @@ module SonicPi
       assert m.path_match("/foo/bar/bazz", nil)
     end
 
+    def test_event_matchers_trie_matches_linear_scan
+      rng = Random.new(7)
+      segments = ["foo", "bar", "b*", "*", "**", "{foo,bar}", "?oo", "[a-f]ar", "baz"]
+      addresses = ["/foo", "/bar", "/foo/bar", "/foo/baz", "/bar/foo/baz", "foo/bar/", "/foo/bar/baz/quux", "//foo"]
+      patterns = 300.times.map { "/" + Array.new(1 + rng.rand(4)) { segments[rng.rand(segments.size)] }.join("/") }
+      patterns += ["//foo", "/foo/", " /foo/bar ", "/foo,bar"]
+
+      addresses.each do |address|
+        matchers = EventMatchers.new
+        patterns.each { |pattern| matchers.put(make_cue_event(pattern), nil, ThreadId.new(5), nil) }
+        ce = CueEvent.new(Time.now + 1, 0, 0, 0, 0, 60, address, [])
+        expected = matchers.matchers.select { |m| m.path_match(ce.path) }
+        matchers.match(ce)
+        remaining = matchers.matchers
+        assert_equal patterns.size - expected.size, remaining.size, address
+        expected.each { |m| refute_includes remaining, m, address }
+      end
+    end
+
+    def test_event_matchers_prune_empties_trie
+      matchers = EventMatchers.new
+      matchers.put(make_cue_event("/foo/bar/baz"), nil, ThreadId.new(5), nil)
+      matchers.put(make_cue_event("/foo/*"), nil, ThreadId.new(6), nil)
+      matchers.prune(ThreadId.new(5))
+      assert_equal ["/foo/*"], matchers.matchers.map { |m| m.ce.path }
+      matchers.prune(ThreadId.new(6))
+      assert_equal [], matchers.matchers
+    end
+
     def test_sync_with_existing_event
       history = EventHistory.new
       i = ThreadId.new(5)
@@ -613,5 +642,76 @@ module SonicPi
       v = history.get(1496358140.6955268, -100, i1, 0, 0.2, m, n)
       assert_equal 5, v.val
     end
+
+    def test_counts
+      [false, EventHistory.native_store?].uniq.each do |native|
+        history = EventHistory.new(nil, nil, native)
+        i = ThreadId.new(1)
+        assert_equal [1, 0], history.counts
+        history.set(1, 0, i, 0, 0, 60, "/foo/bar", [1])
+        history.set(2, 0, i, 0, 0, 60, "/foo/bar", [2])
+        history.set(3, 0, i, 0, 0, 60, "/foo/baz", [3])
+        assert_equal [4, 3], history.counts
+      end
+    end
+
+    def test_native_store_matches_ruby
+      skip "native event store not built" unless EventHistory.native_store?
+
+      rng = Random.new(42)
+      native = EventHistory.new(nil, nil, true)
+      ruby = EventHistory.new(nil, nil, false)
+      segments = ["foo", "bar", "baz", "quux"]
+      threads = [ThreadId.new(1), ThreadId.new(1, 0), ThreadId.new(2)]
+      patterns = ["/foo/bar", "/*/bar", "/**", "/foo/**", "/**/baz", "/{foo,ba?}/*",
+                  "/[a-f]*/quux", "/[!f]*/**/bar", "/f*/**/b*", "/quux"]
+      even = lambda { |v| v.first.even? }
+
+      500.times do |n|
+        path = "/" + Array.new(rng.rand(1..3)) { segments[rng.rand(segments.size)] }.join("/")
+        args = [rng.rand(8), rng.rand(2), threads[rng.rand(threads.size)], rng.rand(3), 0, 60]
+        [native, ruby].each { |h| h.set(*args, path, [n]) }
+
+        get = [rng.rand(8) + rng.rand(2) * 0.5, rng.rand(2), threads[rng.rand(threads.size)], rng.rand(3), 0, 60, patterns[rng.rand(patterns.size)]]
+        [nil, even].each do |matcher|
+          assert_equal ruby.get(*get, matcher)&.val, native.get(*get, matcher)&.val, "get #{get.inspect}"
+          assert_equal ruby.get_next(*get, matcher)&.val, native.get_next(*get, matcher)&.val, "get_next #{get.inspect}"
+        end
+      end
+    end
+
+    FakeThreadId = Struct.new(:ids)
+    FakeEvent = Struct.new(:time, :priority, :ids, :delta, :val, :split_path) do
+      def time_r
+        time.to_r
+      end
+
+      def thread_id
+        FakeThreadId.new(ids)
+      end
+    end
+
+    def test_native_store_survives_ruby_errors
+      skip "native event store not built" unless EventHistory.native_store?
+
+      store = NativeEventStore.new(20, 32, true)
+      good = FakeEvent.new(1, 0, [1], 0, [1], ["foo"])
+      store.insert(good)
+
+      # raised half way through reading the thread ids and the path
+      assert_raises(TypeError) { store.insert(FakeEvent.new(2, 0, [1, :bad], 0, [2], ["foo"])) }
+      assert_raises(TypeError) { store.insert(FakeEvent.new(2, 0, [1], 0, [2], ["foo", 3])) }
+      assert_raises(TypeError) { store.get(FakeEvent.new(2, 0, [1, :bad], 0, nil, nil), "/foo", nil, false) }
+
+      # a throw rather than an exception
+      thrower = FakeEvent.new(2, 0, [1], 0, [2], ["foo"])
+      def thrower.split_path
+        throw :out
+      end
+      catch(:out) { store.insert(thrower) }
+
+      assert_equal [2, 1], store.count
+      assert_same good, store.get(FakeEvent.new(2, 0, [1], 0, nil, nil), "/foo", nil, false)
+    end
   end
 end
@@ -45,5 +45,79 @@ module SonicPi
         assert_equal(args, d_args)
       end
     end
+
+    def test_decoded_strings_are_frozen
+      decoder = ::SonicPi::OSC::OscDecode.new(true)
+      encoder = ::SonicPi::OSC::OscEncode.new(true)
+
+      d_address, d_args = decoder.decode_single_message(encoder.encode_single_message("/foo", ["bar", 1]))
+      assert(d_address.frozen?)
+      assert(d_args[0].frozen?)
+    end
+
+    def test_decodes_raw_cue_blob
+      decoder = ::SonicPi::OSC::OscDecode.new(true)
+      encoder = ::SonicPi::OSC::OscEncode.new(true)
+
+      # as sent by the Erlang cue server in raw forwarding mode
+      cue = encoder.encode_single_message("/trigger", [1, "on"]).b
+      raw = "/external-osc-cue-raw\0\0\0,sidb\0\0\0" + "127.0.0.1\0\0\0" + [4560, 1600000000.25, cue.size].pack("NGN") + cue
+      _, (ip, port, time, blob) = decoder.decode_single_message(raw.b)
+      assert_equal(["127.0.0.1", 4560, 1600000000.25], [ip, port, time])
+      assert(blob.frozen?)
+      assert_equal(["/trigger", [1, "on"]], decoder.decode_single_message(blob))
+    end
+
+    def test_native_codec_matches_ruby
+      skip "native OSC codec not built" unless ::SonicPi::OSC.native_codec?
+
+      ruby_encoder = ::SonicPi::OSC::OscEncode.new(true)
+      ruby_decoder = ::SonicPi::OSC::OscDecode.new(true)
+      native_encoder = ::SonicPi::OSC::NativeOscEncode.new
+      native_decoder = ::SonicPi::OSC::NativeOscDecode.new
+
+      args_to_test = [[], [1], [-1], [2**31 - 1], [-2**31], [2**32 + 5], [1.5, -0.25], [Rational(1, 4)], [:foo, "bar"], ["", "abc", "abcd"], [::SonicPi::OSC::Blob.new("xyz")], ["eggs", 0, -1, 2.0, -2000, :beans]]
+
+      args_to_test.each do |args|
+        m = ruby_encoder.encode_single_message("/foo/bar", args)
+        assert_equal(m.b, native_encoder.encode_single_message("/foo/bar", args))
+        assert_equal(ruby_decoder.decode_single_message(m.dup), native_decoder.decode_single_message(m))
+
+        ts = Time.at(1600000000.123456)
+        assert_equal(ruby_encoder.encode_single_bundle(ts, "/foo", args).b, native_encoder.encode_single_bundle(ts, "/foo", args))
+      end
+
+      d_address, d_args = native_decoder.decode_single_message(native_encoder.encode_single_message("/foo", ["bar"]))
+      assert(d_address.frozen?)
+      assert(d_args[0].frozen?)
+
+      assert_raises(ArgumentError) { native_decoder.decode_single_message("/foo") }
+      assert_raises(RuntimeError) { native_encoder.encode_single_message("/foo", [Object.new]) }
+    end
+
+    # Fetching a blob's binary runs Ruby code, which can switch threads
+    # half way through an encode on a shared encoder
+    class YieldingBlob < ::SonicPi::OSC::Blob
+      def binary
+        Thread.pass
+        super
+      end
+    end
+
+    def test_native_encoder_shared_between_threads
+      skip "native OSC codec not built" unless ::SonicPi::OSC.native_codec?
+
+      ruby_encoder = ::SonicPi::OSC::OscEncode.new(true)
+      native_encoder = ::SonicPi::OSC::NativeOscEncode.new
+
+      threads = 4.times.map do |i|
+        Thread.new do
+          args = ["thread#{i}", i, YieldingBlob.new("x" * (600 * (i + 1))), i * 2]
+          expected = ruby_encoder.encode_single_message("/thread/#{i}", args).b
+          200.times.all? { native_encoder.encode_single_message("/thread/#{i}", args) == expected }
+        end
+      end
+      assert(threads.map(&:value).all?)
+    end
   end
 end
@@ -11,12 +11,14 @@ rmdir server\native\plugins /s /q
 
 @echo Copying aubio to the server...
 copy external\build\aubio-prefix\src\aubio-build\Release\aubio_onset.exe server\native\
+copy external\build\aubio-prefix\src\aubio-build\Release\aubio_tempo.exe server\native\
 
 @echo Copying all other native files to server...
 xcopy /Y /I /R /E ..\prebuilt\windows\x64\*.* server\native
 
 @echo Copying sp_midi dll to the erlang bin directory...
 xcopy /Y /I /R /E external\build\sp_midi-prefix\src\sp_midi-build\Release\*.dll server\erlang\sonic_pi_server\priv\
+xcopy /Y /I /R /E external\build\sp_osc-prefix\src\sp_osc-build\Release\*.dll server\erlang\sonic_pi_server\priv\
 
 @echo Translating tutorial...
 server\native\ruby\bin\ruby server/ruby/bin/i18n-tool.rb -t